@@ -0,0 +1,800 @@
+// Benchmarks de las rutas críticas del parque
+//
+// Mide la carga del grafo (construirGrafo), la lectura y escritura de atracciones
+// (leerAtracciones, guardarTiempoEspera), dijkstra con varios tamaños y densidades, las
+// consultas punto a punto con cada motor (dijkstra, bidireccional, ALT, jerarquía de contracción y CRP,
+// con los nodos asentados, el tiempo de preproceso y el de personalizar una espera cambiada),
+// los mapas de distancias con delta-stepping (de 1 a 64 hilos y con varios anchos de cubeta),
+// la reparación de distancias al cambiar una espera (contra calcularlas de nuevo), las rutas que usan
+// la espera prevista a la hora de llegada (con perfiles y con esperas fijas), los planes con tiempo
+// disponible (con el plazo de búsqueda local incluido, junto con las paradas logradas),
+// las rutas de Pareto entre metros y minutos de fila (exactas y con tolerancia),
+// las rutas alternativas (Yen con desvíos en paralelo y penalización, en parques grandes),
+// y la lectura y el recorrido del árbol de decisiones. Los datos se generan con una semilla fija
+// en una carpeta temporal, así que dos versiones del programa miden exactamente lo mismo.
+//
+// Cada caso se calibra para que una muestra dure al menos 100 µs y se repite hasta cubrir
+// el tiempo mínimo; se informa el tiempo por llamada (mínimo, mediana, media y percentil 90).
+// La salida es JSON o CSV para comparar versiones y detectar regresiones.
+//
+// Uso:
+//   g++ -std=c++17 -O2 -pthread Benchmark.cpp -o Benchmark
+//   ./Benchmark [--formato json|csv] [--salida archivo] [--filtro texto] [--tiempo segundos]
+//               [--etiqueta texto] [--rapido] [--contadores]
+//
+// Con --contadores (solo Linux) se leen además los contadores de hardware con perf_event_open
+// durante las muestras: ciclos, instrucciones (IPC), referencias y fallos de caché, saltos y
+// fallos de predicción, por llamada. Si el kernel no los permite (perf_event_paranoid, máquinas
+// virtuales sin PMU) el caso se mide igual y los contadores quedan en null.
+
+#define PARQUE_SIN_MAIN
+#include "Main.cpp"
+
+#include <random>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef __VERSION__
+const char* const COMPILADOR = __VERSION__;
+#else
+const char* const COMPILADOR = "desconocido";
+#endif
+
+// Opciones de la corrida
+struct OpcionesBenchmark {
+    std::string formato = "json";
+    std::string salida = "-";
+    std::string filtro;
+    std::string etiqueta;
+    double tiempoMinimo = 0.3; // Segundos por caso
+    bool rapido = false;       // Solo los tamaños pequeños
+    bool contadores = false;   // Contadores de hardware con perf_event_open
+};
+
+// Resultado de un caso: tiempos por llamada en nanosegundos
+struct ResultadoBenchmark {
+    std::string caso;
+    json parametros;
+    std::size_t muestras = 0;
+    std::size_t llamadasPorMuestra = 0;
+    double nsMinimo = 0;
+    double nsMediana = 0;
+    double nsMedia = 0;
+    double nsP90 = 0;
+    json contadores; // Por llamada; null si no se pidieron o no están disponibles
+    json detalles;   // Cifras propias del caso, por ejemplo nodos asentados por búsqueda
+};
+
+// Evita que el compilador descarte el trabajo medido
+volatile std::size_t sumidero = 0;
+
+// El aviso de contadores no disponibles se da una sola vez en toda la corrida (medir es una plantilla,
+// así que una variable static dentro de ella existiría una vez por cada caso)
+bool avisoContadoresDado = false;
+
+//-----------------------------------------------------------
+
+// Contadores de hardware: un grupo de perf_event_open que se enciende y se apaga junto
+// Si el kernel reparte la PMU entre varios grupos, los valores se escalan por el tiempo que estuvo activo
+
+struct ContadorHardware {
+    const char* nombre;
+    std::uint32_t tipo;
+    std::uint64_t evento;
+};
+
+struct GrupoContadores {
+    std::vector<int> descriptores; // El primero es el líder del grupo
+    std::vector<const char*> nombres;
+};
+
+#ifdef __linux__
+const ContadorHardware CONTADORES_HARDWARE[] = {
+    {"ciclos", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instrucciones", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"referencias_cache", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"fallos_cache", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"saltos", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"fallos_salto", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+// Función para abrir el grupo; devuelve false si el sistema no da acceso a los contadores
+bool abrirContadores(GrupoContadores& grupo) {
+    for (const auto& contador : CONTADORES_HARDWARE) {
+        perf_event_attr atributos;
+        std::memset(&atributos, 0, sizeof(atributos));
+        atributos.size = sizeof(atributos);
+        atributos.type = contador.tipo;
+        atributos.config = contador.evento;
+        atributos.disabled = grupo.descriptores.empty() ? 1 : 0;
+        atributos.exclude_kernel = 1;
+        atributos.exclude_hv = 1;
+        atributos.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int lider = grupo.descriptores.empty() ? -1 : grupo.descriptores[0];
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &atributos, 0, -1, lider, 0));
+        if (fd < 0) {
+            // Un contador que falta (por ejemplo, sin caché en una VM) no invalida a los demás; sin líder no hay grupo
+            if (grupo.descriptores.empty()) return false;
+            continue;
+        }
+        grupo.descriptores.push_back(fd);
+        grupo.nombres.push_back(contador.nombre);
+    }
+    return true;
+}
+
+void cerrarContadores(GrupoContadores& grupo) {
+    for (int fd : grupo.descriptores) close(fd);
+    grupo.descriptores.clear();
+    grupo.nombres.clear();
+}
+
+void iniciarContadores(GrupoContadores& grupo) {
+    ioctl(grupo.descriptores[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(grupo.descriptores[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Detiene el grupo y devuelve cada contador dividido por el número de llamadas
+json detenerContadores(GrupoContadores& grupo, std::size_t llamadas) {
+    ioctl(grupo.descriptores[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    std::vector<std::uint64_t> lectura(3 + grupo.descriptores.size());
+    ssize_t leidos = read(grupo.descriptores[0], lectura.data(), lectura.size() * sizeof(std::uint64_t));
+    if (leidos < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || lectura[2] == 0) return nullptr;
+    double escala = static_cast<double>(lectura[1]) / static_cast<double>(lectura[2]);
+    json valores = json::object();
+    for (std::size_t i = 0; i < grupo.nombres.size() && i < lectura[0]; ++i) {
+        valores[grupo.nombres[i]] = lectura[3 + i] * escala / llamadas;
+    }
+    if (valores.contains("ciclos") && valores.contains("instrucciones") && valores["ciclos"].get<double>() > 0) {
+        valores["ipc"] = valores["instrucciones"].get<double>() / valores["ciclos"].get<double>();
+    }
+    return valores;
+}
+#else
+bool abrirContadores(GrupoContadores&) { return false; }
+void cerrarContadores(GrupoContadores&) {}
+void iniciarContadores(GrupoContadores&) {}
+json detenerContadores(GrupoContadores&, std::size_t) { return nullptr; }
+#endif
+
+//-----------------------------------------------------------
+
+// Función para medir una llamada repetida; funcion() devuelve un valor que se acumula en el sumidero
+template <typename Funcion>
+ResultadoBenchmark medir(const OpcionesBenchmark& opciones, const std::string& caso, const json& parametros, Funcion&& funcion) {
+    using Reloj = std::chrono::steady_clock;
+    auto duracionNs = [](Reloj::time_point desde, Reloj::time_point hasta) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(hasta - desde).count());
+    };
+
+    sumidero = sumidero + funcion(); // Calentamiento
+
+    // Calibración: se duplican las llamadas por muestra hasta que una muestra dure al menos 100 µs
+    std::size_t llamadas = 1;
+    while (llamadas < (1u << 20)) {
+        Reloj::time_point inicio = Reloj::now();
+        for (std::size_t i = 0; i < llamadas; ++i) sumidero = sumidero + funcion();
+        if (duracionNs(inicio, Reloj::now()) >= 100000.0) break;
+        llamadas *= 2;
+    }
+
+    // Los contadores cubren todas las muestras; abrirlos y leerlos queda fuera de los tiempos
+    GrupoContadores grupo;
+    bool conContadores = opciones.contadores && abrirContadores(grupo);
+    if (opciones.contadores && !conContadores && !avisoContadoresDado) {
+        std::cerr << "Aviso: Los contadores de hardware no estan disponibles; se informan como null." << std::endl;
+        avisoContadoresDado = true;
+    }
+    if (conContadores) iniciarContadores(grupo);
+
+    std::vector<double> tiempos;
+    double total = 0;
+    while ((total < opciones.tiempoMinimo * 1e9 || tiempos.size() < 5) && tiempos.size() < 100000) {
+        Reloj::time_point inicio = Reloj::now();
+        for (std::size_t i = 0; i < llamadas; ++i) sumidero = sumidero + funcion();
+        double transcurrido = duracionNs(inicio, Reloj::now());
+        tiempos.push_back(transcurrido / llamadas);
+        total += transcurrido;
+    }
+
+    json contadores = nullptr;
+    if (conContadores) {
+        contadores = detenerContadores(grupo, tiempos.size() * llamadas);
+        cerrarContadores(grupo);
+    }
+
+    std::sort(tiempos.begin(), tiempos.end());
+    ResultadoBenchmark resultado;
+    resultado.caso = caso;
+    resultado.parametros = parametros;
+    resultado.muestras = tiempos.size();
+    resultado.llamadasPorMuestra = llamadas;
+    resultado.nsMinimo = tiempos.front();
+    resultado.nsMediana = tiempos[tiempos.size() / 2];
+    resultado.nsP90 = tiempos[std::min(tiempos.size() - 1, tiempos.size() * 9 / 10)];
+    double suma = 0;
+    for (double t : tiempos) suma += t;
+    resultado.nsMedia = suma / tiempos.size();
+    resultado.contadores = contadores;
+
+    std::cerr << std::left << std::setw(22) << caso << std::setw(34) << parametros.dump() << std::right
+              << std::setw(14) << std::fixed << std::setprecision(0) << resultado.nsMediana << " ns";
+    if (contadores.contains("ipc")) {
+        std::cerr << std::setprecision(2) << "  IPC " << contadores["ipc"].get<double>();
+    }
+    std::cerr << std::endl;
+    return resultado;
+}
+
+//-----------------------------------------------------------
+
+// Función para generar un grafo conexo y simétrico: un anillo más aristas al azar con la densidad dada
+Grafo generarGrafo(int n, double densidad, std::mt19937& generador) {
+    Grafo grafo;
+    grafo.matrizAdyacencia.assign(n, std::vector<int>(n, 0));
+    std::uniform_int_distribution<int> metros(50, 500);
+    std::uniform_real_distribution<double> azar(0.0, 1.0);
+    for (int i = 0; i < n; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+            if (j == i + 1 || (i == 0 && j == n - 1) || azar(generador) < densidad) {
+                grafo.matrizAdyacencia[i][j] = grafo.matrizAdyacencia[j][i] = metros(generador);
+            }
+        }
+    }
+    construirAdyacencia(grafo);
+    return grafo;
+}
+
+void escribirGrafoCSV(const Grafo& grafo, const std::string& archivoCSV) {
+    std::ofstream archivo(archivoCSV);
+    for (const auto& fila : grafo.matrizAdyacencia) {
+        for (std::size_t j = 0; j < fila.size(); ++j) {
+            archivo << (j ? "," : "") << fila[j];
+        }
+        archivo << "\n";
+    }
+}
+
+// Cuadrícula de lado x lado con caminos de 80 a 120 metros y un 30% de los verticales quitados (como GeneradorParque)
+// Con diámetro grande, como un parque real, se nota cuánto del grafo recorre cada búsqueda punto a punto
+Grafo generarCuadricula(int lado, std::mt19937& generador) {
+    std::uniform_int_distribution<int> metros(80, 120);
+    std::uniform_real_distribution<double> azar(0.0, 1.0);
+    std::vector<std::array<int, 3>> aristas;
+    for (int u = 0; u < lado * lado; ++u) {
+        int columna = u % lado;
+        if (columna + 1 < lado) {
+            int m = metros(generador);
+            aristas.push_back({u, u + 1, m});
+            aristas.push_back({u + 1, u, m});
+        }
+        if (u + lado < lado * lado && (columna == 0 || azar(generador) < 0.7)) {
+            int m = metros(generador);
+            aristas.push_back({u, u + lado, m});
+            aristas.push_back({u + lado, u, m});
+        }
+    }
+    Grafo grafo;
+    adyacenciaDesdeAristas(grafo, lado * lado, aristas);
+    return grafo;
+}
+
+std::vector<Atraccion> generarAtracciones(int n, std::mt19937& generador) {
+    std::uniform_int_distribution<int> espera(0, 60);
+    std::vector<Atraccion> atracciones(n);
+    for (int i = 0; i < n; ++i) {
+        atracciones[i].identificador = i + 1;
+        atracciones[i].nombre = "Atraccion " + std::to_string(i + 1);
+        atracciones[i].tiempo_espera = espera(generador);
+    }
+    return atracciones;
+}
+
+// Árbol completo con la profundidad dada; cada hoja tiene identificadores distintos para que no se compartan nodos
+json generarArbolJSON(int profundidad, int& siguienteHoja) {
+    if (profundidad == 0) {
+        int hoja = siguienteHoja++;
+        return json{{"identificadores", {hoja + 1, hoja + 2, hoja + 3}}};
+    }
+    json nodo;
+    nodo["pregunta"] = "Pregunta de nivel " + std::to_string(profundidad) + "?";
+    nodo["izquierda"] = generarArbolJSON(profundidad - 1, siguienteHoja);
+    nodo["derecha"] = generarArbolJSON(profundidad - 1, siguienteHoja);
+    return nodo;
+}
+
+// Recorrido del árbol con las respuestas de un perfil (bit d = respuesta a la pregunta de profundidad d)
+const Nodo* clasificarPerfil(const Nodo* nodo, std::uint64_t perfil) {
+    for (int profundidad = 0; nodo->izquierda || nodo->derecha; ++profundidad) {
+        const Nodo* siguiente = (perfil >> profundidad) & 1 ? nodo->izquierda : nodo->derecha;
+        if (!siguiente) break;
+        nodo = siguiente;
+    }
+    return nodo;
+}
+
+//-----------------------------------------------------------
+
+bool casoIncluido(const OpcionesBenchmark& opciones, const std::string& caso) {
+    return opciones.filtro.empty() || caso.find(opciones.filtro) != std::string::npos;
+}
+
+void ejecutarBenchmarks(const OpcionesBenchmark& opciones, const std::string& carpeta, std::vector<ResultadoBenchmark>& resultados) {
+    // Cada sección tiene su propia semilla, así los datos no cambian al filtrar casos
+    const std::uint32_t semilla = 20240601;
+    std::vector<int> tamanos = opciones.rapido ? std::vector<int>{10, 100} : std::vector<int>{10, 100, 500, 1000};
+    std::vector<double> densidades = {0.05, 0.25, 1.0};
+
+    if (casoIncluido(opciones, "construirGrafo")) {
+        std::mt19937 generador(semilla);
+        for (int n : tamanos) {
+            std::string archivoCSV = carpeta + "/grafo_" + std::to_string(n) + ".csv";
+            escribirGrafoCSV(generarGrafo(n, 0.25, generador), archivoCSV);
+            json parametros = {{"nodos", n}, {"bytes", std::filesystem::file_size(archivoCSV)}};
+            resultados.push_back(medir(opciones, "construirGrafo", parametros, [&]() {
+                Grafo grafo;
+                construirGrafo(grafo, archivoCSV);
+                return static_cast<std::size_t>(grafo.numNodos);
+            }));
+        }
+    }
+
+    std::vector<int> cantidades = opciones.rapido ? std::vector<int>{10, 1000} : std::vector<int>{10, 1000, 10000};
+    std::mt19937 generadorAtracciones(semilla + 1);
+    for (int n : cantidades) {
+        std::string archivoJSON = carpeta + "/atracciones_" + std::to_string(n) + ".json";
+        std::vector<Atraccion> atracciones = generarAtracciones(n, generadorAtracciones);
+        guardarTiempoEspera(archivoJSON, atracciones);
+        json parametros = {{"atracciones", n}, {"bytes", std::filesystem::file_size(archivoJSON)}};
+        if (casoIncluido(opciones, "leerAtracciones")) {
+            resultados.push_back(medir(opciones, "leerAtracciones", parametros, [&]() {
+                return leerAtracciones(archivoJSON).size();
+            }));
+        }
+        if (casoIncluido(opciones, "guardarTiempoEspera")) {
+            resultados.push_back(medir(opciones, "guardarTiempoEspera", parametros, [&]() {
+                guardarTiempoEspera(archivoJSON, atracciones);
+                return atracciones.size();
+            }));
+        }
+    }
+
+    if (casoIncluido(opciones, "dijkstra")) {
+        std::mt19937 generador(semilla + 2);
+        for (int n : tamanos) {
+            for (double densidad : densidades) {
+                Grafo grafo = generarGrafo(n, densidad, generador);
+                std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+                std::vector<int> seleccionadas = {n / 2 + 1, n};
+                std::size_t aristas = grafo.vecinos.size();
+                json parametros = {{"nodos", n}, {"densidad", densidad}, {"aristas", aristas / 2}};
+                int inicio = 0;
+                resultados.push_back(medir(opciones, "dijkstra", parametros, [&]() {
+                    auto resultado = dijkstra(grafo, inicio, seleccionadas, atracciones);
+                    inicio = (inicio + 1) % n;
+                    return resultado.second.size();
+                }));
+            }
+        }
+    }
+
+    // Consultas punto a punto: los mismos pares de nodos con cada motor, para comparar tiempo y nodos asentados
+    if (casoIncluido(opciones, "puntoAPunto")) {
+        std::mt19937 generador(semilla + 4);
+        std::vector<int> lados = opciones.rapido ? std::vector<int>{100} : std::vector<int>{100, 316};
+        for (int lado : lados) {
+            int n = lado * lado;
+            Grafo grafo = generarCuadricula(lado, generador);
+            std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+            auto inicioMarcas = std::chrono::steady_clock::now();
+            calcularMarcas(grafo, MARCAS_POR_DEFECTO, hilosPorDefecto());
+            double msMarcas = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicioMarcas).count();
+            auto inicioJerarquia = std::chrono::steady_clock::now();
+            auto jerarquia = construirJerarquia(grafo, atracciones, hilosPorDefecto());
+            double msJerarquia = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicioJerarquia).count();
+            ModeloParque modelo;
+            modelo.grafo = std::make_shared<Grafo>(grafo);
+            modelo.atracciones = atracciones;
+            auto inicioParticion = std::chrono::steady_clock::now();
+            modelo.particion = particionarGrafo(*modelo.grafo);
+            modelo.metrica = personalizarMetrica(*modelo.grafo, *modelo.particion, atracciones, nullptr, {});
+            double msParticion = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicioParticion).count();
+            // Personalización incremental: cambia la espera de una sola atracción
+            std::vector<Atraccion> editadas = atracciones;
+            editadas[n / 2].tiempo_espera += 10;
+            auto inicioIncremental = std::chrono::steady_clock::now();
+            personalizarMetrica(*modelo.grafo, *modelo.particion, editadas, modelo.metrica.get(), {n / 2});
+            double msIncremental = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicioIncremental).count();
+            std::uniform_int_distribution<int> nodo(0, n - 1);
+            std::vector<std::pair<int, int>> pares(64);
+            for (auto& par : pares) par = {nodo(generador), nodo(generador)};
+
+            std::vector<std::pair<std::string, std::function<std::uint64_t(int, int)>>> motores = {
+                {"dijkstra", [&](int inicio, int destino) {
+                     auto resultado = dijkstra(grafo, inicio, {destino + 1}, atracciones);
+                     std::uint64_t alcanzados = 0;
+                     for (int distancia : resultado.first) alcanzados += distancia != std::numeric_limits<int>::max();
+                     return alcanzados;
+                 }},
+                {"bidireccional", [&](int inicio, int destino) { return dijkstraBidireccional(grafo, inicio, destino, atracciones).asentados; }},
+                {"alt", [&](int inicio, int destino) { return aEstrellaALT(grafo, inicio, destino, atracciones).asentados; }},
+                {"ch", [&](int inicio, int destino) { return consultarJerarquia(*jerarquia, inicio, destino, true).asentados; }},
+                {"crp", [&](int inicio, int destino) { return consultarCRP(modelo, inicio, destino, true).asentados; }},
+            };
+            for (const auto& motor : motores) {
+                std::uint64_t asentados = 0;
+                for (const auto& par : pares) asentados += motor.second(par.first, par.second);
+                json parametros = {{"nodos", n}, {"motor", motor.first}};
+                std::size_t siguiente = 0;
+                resultados.push_back(medir(opciones, "puntoAPunto", parametros, [&]() {
+                    const auto& par = pares[siguiente++ % pares.size()];
+                    return static_cast<std::size_t>(motor.second(par.first, par.second));
+                }));
+                resultados.back().detalles = {{"nodos_asentados", static_cast<double>(asentados) / pares.size()}};
+                if (motor.first == "alt") {
+                    resultados.back().detalles["marcas"] = grafo.numMarcas;
+                    resultados.back().detalles["preproceso_ms"] = msMarcas;
+                }
+                if (motor.first == "ch") {
+                    resultados.back().detalles["aristas_jerarquia"] = jerarquia->subida.size() + jerarquia->bajada.size();
+                    resultados.back().detalles["preproceso_ms"] = msJerarquia;
+                }
+                if (motor.first == "crp") {
+                    resultados.back().detalles["niveles"] = modelo.particion->numNiveles;
+                    resultados.back().detalles["preproceso_ms"] = msParticion;
+                    resultados.back().detalles["personalizacion_incremental_ms"] = msIncremental;
+                }
+            }
+        }
+    }
+
+    // Mapas de distancias: dijkstraDesde contra delta-stepping con 1 a 64 hilos y varios anchos de cubeta
+    if (casoIncluido(opciones, "deltaStepping")) {
+        std::mt19937 generador(semilla + 5);
+        int lado = opciones.rapido ? 316 : 1000;
+        int n = lado * lado;
+        Grafo grafo = generarCuadricula(lado, generador);
+        std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+        int deltaBase = deltaPorDefecto(grafo, atracciones);
+        std::vector<int> distancia;
+        std::vector<int> previo;
+        int inicio = 0;
+        resultados.push_back(medir(opciones, "deltaStepping", {{"nodos", n}, {"motor", "dijkstra"}}, [&]() {
+            dijkstraDesde(grafo, inicio, atracciones, distancia, previo);
+            inicio = (inicio + 7919) % n;
+            return static_cast<std::size_t>(distancia[n - 1]);
+        }));
+        std::vector<unsigned> hilos = opciones.rapido ? std::vector<unsigned>{1, 4} : std::vector<unsigned>{1, 2, 4, 8, 16, 32, 64};
+        std::vector<int> deltas = {deltaBase / 4, deltaBase, deltaBase * 4};
+        for (unsigned numHilos : hilos) {
+            PlanificadorTareas planificador;
+            iniciarPlanificador(planificador, numHilos);
+            for (int delta : deltas) {
+                // Los anchos distintos del promedio solo se miden con los hilos por defecto
+                if (delta != deltaBase && numHilos != std::min(hilos.back(), hilosPorDefecto())) continue;
+                json parametros = {{"nodos", n}, {"motor", "delta"}, {"hilos", numHilos}, {"delta", delta}};
+                resultados.push_back(medir(opciones, "deltaStepping", parametros, [&]() {
+                    deltaStepping(grafo, inicio, atracciones, delta, planificador, distancia, previo);
+                    inicio = (inicio + 7919) % n;
+                    return static_cast<std::size_t>(distancia[n - 1]);
+                }));
+            }
+            detenerPlanificador(planificador);
+        }
+    }
+
+    // Cambios de una espera con las distancias ya calculadas: reparación contra un dijkstraDesde completo
+    if (casoIncluido(opciones, "reparacionEspera")) {
+        std::mt19937 generador(semilla + 6);
+        std::vector<int> lados = opciones.rapido ? std::vector<int>{100} : std::vector<int>{100, 316};
+        for (int lado : lados) {
+            int n = lado * lado;
+            Grafo grafo = generarCuadricula(lado, generador);
+            std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+            std::uniform_int_distribution<int> nodo(0, n - 1);
+            std::uniform_int_distribution<int> espera(0, 60);
+            std::vector<int> distancia;
+            std::vector<int> previo;
+            int inicio = n / 2;
+            resultados.push_back(medir(opciones, "reparacionEspera", {{"nodos", n}, {"modo", "completo"}}, [&]() {
+                dijkstraDesde(grafo, inicio, atracciones, distancia, previo);
+                return static_cast<std::size_t>(distancia[n - 1]);
+            }));
+            // Cada llamada cambia la espera de una atracción al azar; las distancias siguen siendo las de las esperas actuales
+            dijkstraDesde(grafo, inicio, atracciones, distancia, previo);
+            std::uint64_t tocados = 0;
+            std::uint64_t cambios = 0;
+            resultados.push_back(medir(opciones, "reparacionEspera", {{"nodos", n}, {"modo", "reparacion"}}, [&]() {
+                int v = nodo(generador);
+                int anterior = atracciones[v].tiempo_espera;
+                atracciones[v].tiempo_espera = espera(generador);
+                tocados += repararPorCambioDeEspera(grafo, inicio, atracciones, v, anterior, distancia, previo);
+                ++cambios;
+                return static_cast<std::size_t>(distancia[n - 1]);
+            }));
+            resultados.back().detalles = {{"nodos_recalculados", static_cast<double>(tocados) / cambios}};
+        }
+    }
+
+    // Rutas dependientes de la hora: perfiles de espera cada media hora de 9:00 a 22:00 en todas las atracciones
+    if (casoIncluido(opciones, "horaLlegada")) {
+        std::mt19937 generador(semilla + 7);
+        int lado = 100;
+        int n = lado * lado;
+        Grafo grafo = generarCuadricula(lado, generador);
+        std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+        std::uniform_int_distribution<int> espera(0, 90);
+        PerfilesEspera perfiles;
+        perfiles.inicioPuntos.push_back(0);
+        for (int v = 0; v < n; ++v) {
+            for (int minuto = 9 * 60; minuto <= 22 * 60; minuto += 30) {
+                perfiles.puntos.push_back({static_cast<std::uint16_t>(minuto), static_cast<std::uint16_t>(espera(generador))});
+            }
+            perfiles.inicioPuntos.push_back(static_cast<int>(perfiles.puntos.size()));
+        }
+        std::uniform_int_distribution<int> nodo(0, n - 1);
+        std::uniform_int_distribution<int> segundo(9 * 3600, 22 * 3600);
+        std::vector<std::pair<int, int>> consultas(1024);
+        for (auto& consulta : consultas) consulta = {nodo(generador), segundo(generador)};
+        std::size_t siguiente = 0;
+        resultados.push_back(medir(opciones, "horaLlegada", {{"puntos_por_perfil", 27}, {"caso", "esperaEnSegundos"}}, [&]() {
+            const auto& consulta = consultas[siguiente++ % consultas.size()];
+            return static_cast<std::size_t>(esperaEnSegundos(&perfiles, atracciones, consulta.first, consulta.second));
+        }));
+        std::vector<std::pair<int, int>> pares(64);
+        for (auto& par : pares) par = {nodo(generador), nodo(generador)};
+        for (bool conPerfiles : {false, true}) {
+            json parametros = {{"nodos", n}, {"caso", conPerfiles ? "ruta_con_perfiles" : "ruta_esperas_fijas"}};
+            siguiente = 0;
+            resultados.push_back(medir(opciones, "horaLlegada", parametros, [&]() {
+                const auto& par = pares[siguiente++ % pares.size()];
+                auto ruta = rutaDependienteDeHora(grafo, atracciones, conPerfiles ? &perfiles : nullptr, par.first, par.second, 10 * 3600);
+                return ruta.asentados;
+            }));
+        }
+    }
+
+    // Planes con tiempo disponible: cada llamada incluye la búsqueda local, que se corta sin mejora o a PLAZO_PLAN_MS
+    if (casoIncluido(opciones, "planTiempo")) {
+        std::mt19937 generador(semilla + 8);
+        int lado = 100;
+        int n = lado * lado;
+        ModeloParque modelo;
+        modelo.grafo = std::make_shared<Grafo>(generarCuadricula(lado, generador));
+        modelo.atracciones = generarAtracciones(n, generador);
+        PlanificadorTareas planificador;
+        iniciarPlanificador(planificador, hilosPorDefecto());
+        std::uniform_int_distribution<int> nodo(1, n);
+        std::vector<int> inicios(16);
+        for (int& inicio : inicios) inicio = nodo(generador);
+        for (int minutos : {120, 480}) {
+            std::size_t siguiente = 0;
+            std::uint64_t paradas = 0;
+            std::uint64_t planes = 0;
+            resultados.push_back(medir(opciones, "planTiempo", {{"nodos", n}, {"minutos", minutos}}, [&]() {
+                PlanVisita plan = planificarVisita(modelo, inicios[siguiente++ % inicios.size()], minutos, PLAZO_PLAN_MS, planificador);
+                paradas += plan.orden.size();
+                ++planes;
+                return plan.orden.size();
+            }));
+            resultados.back().detalles = {{"paradas", static_cast<double>(paradas) / planes}, {"plazo_ms", PLAZO_PLAN_MS}};
+        }
+        detenerPlanificador(planificador);
+    }
+
+    // Rutas de Pareto: conjunto exacto contra la tolerancia por defecto, con las rutas y etiquetas de cada consulta
+    if (casoIncluido(opciones, "pareto")) {
+        std::mt19937 generador(semilla + 9);
+        int lado = opciones.rapido ? 50 : 100;
+        int n = lado * lado;
+        Grafo grafo = generarCuadricula(lado, generador);
+        std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+        std::uniform_int_distribution<int> nodo(0, n - 1);
+        std::vector<std::pair<int, int>> pares(64);
+        for (auto& par : pares) par = {nodo(generador), nodo(generador)};
+        for (int tolerancia : {0, TOLERANCIA_PARETO_POR_CIENTO}) {
+            std::size_t siguiente = 0;
+            std::uint64_t rutas = 0;
+            std::uint64_t etiquetas = 0;
+            std::uint64_t consultas = 0;
+            resultados.push_back(medir(opciones, "pareto", {{"nodos", n}, {"tolerancia", tolerancia}}, [&]() {
+                const auto& par = pares[siguiente++ % pares.size()];
+                ResultadoPareto pareto = rutasPareto(grafo, atracciones, par.first, par.second, tolerancia);
+                rutas += pareto.rutas.size();
+                etiquetas += pareto.etiquetas;
+                ++consultas;
+                return pareto.rutas.size();
+            }));
+            resultados.back().detalles = {{"rutas", static_cast<double>(rutas) / consultas}, {"etiquetas", static_cast<double>(etiquetas) / consultas}};
+        }
+    }
+
+    // Rutas alternativas: tres rutas por consulta con Yen (1 hilo y los hilos por defecto) y con penalización
+    if (casoIncluido(opciones, "alternativas")) {
+        std::mt19937 generador(semilla + 10);
+        std::vector<int> lados = opciones.rapido ? std::vector<int>{100, 316} : std::vector<int>{316, 1000};
+        std::vector<unsigned> hilos = {1};
+        if (hilosPorDefecto() > 1) hilos.push_back(hilosPorDefecto());
+        for (int lado : lados) {
+            int n = lado * lado;
+            Grafo grafo = generarCuadricula(lado, generador);
+            std::vector<Atraccion> atracciones = generarAtracciones(n, generador);
+            std::uniform_int_distribution<int> nodo(0, n - 1);
+            std::vector<std::pair<int, int>> pares(16);
+            for (auto& par : pares) par = {nodo(generador), nodo(generador)};
+            for (unsigned numHilos : hilos) {
+                PlanificadorTareas planificador;
+                iniciarPlanificador(planificador, numHilos);
+                for (bool penalizacion : {false, true}) {
+                    // La penalización no usa el planificador: se mide una sola vez
+                    if (penalizacion && numHilos != hilos.front()) continue;
+                    std::size_t siguiente = 0;
+                    std::uint64_t asentados = 0;
+                    std::uint64_t consultas = 0;
+                    json parametros = {{"nodos", n}, {"metodo", penalizacion ? "penalizacion" : "yen"}, {"k", 3}};
+                    if (!penalizacion) parametros["hilos"] = numHilos;
+                    resultados.push_back(medir(opciones, "alternativas", parametros, [&]() {
+                        const auto& par = pares[siguiente++ % pares.size()];
+                        std::vector<RutaAlternativa> rutas = penalizacion
+                            ? rutasAlternativasPenalizadas(grafo, atracciones, par.first, par.second, 3, asentados)
+                            : rutasAlternativasYen(grafo, atracciones, par.first, par.second, 3, planificador, asentados);
+                        ++consultas;
+                        return rutas.size();
+                    }));
+                    resultados.back().detalles = {{"nodos_asentados", static_cast<double>(asentados) / consultas}};
+                }
+                detenerPlanificador(planificador);
+            }
+        }
+    }
+
+    std::vector<int> profundidades = opciones.rapido ? std::vector<int>{4, 10} : std::vector<int>{4, 10, 16};
+    std::mt19937 generadorPerfiles(semilla + 3);
+    for (int profundidad : profundidades) {
+        int siguienteHoja = 0;
+        std::string archivoArbol = carpeta + "/arbol_" + std::to_string(profundidad) + ".json";
+        {
+            std::ofstream archivo(archivoArbol);
+            archivo << generarArbolJSON(profundidad, siguienteHoja).dump(2);
+        }
+        json parametros = {{"profundidad", profundidad}, {"hojas", siguienteHoja}};
+        if (casoIncluido(opciones, "leerArbolDecisiones")) {
+            resultados.push_back(medir(opciones, "leerArbolDecisiones", parametros, [&]() {
+                Nodo* raiz = leerArbolDecisiones(archivoArbol);
+                std::size_t leido = raiz ? 1 : 0;
+                liberarArbol(raiz);
+                return leido;
+            }));
+        }
+        if (casoIncluido(opciones, "recorrerArbol")) {
+            Nodo* raiz = leerArbolDecisiones(archivoArbol);
+            std::vector<std::uint64_t> perfiles(1024);
+            for (auto& perfil : perfiles) perfil = generadorPerfiles();
+            std::size_t siguientePerfil = 0;
+            resultados.push_back(medir(opciones, "recorrerArbol", parametros, [&]() {
+                const Nodo* hoja = clasificarPerfil(raiz, perfiles[siguientePerfil++ % perfiles.size()]);
+                return hoja->identificadores.size();
+            }));
+            liberarArbol(raiz);
+        }
+    }
+}
+
+//-----------------------------------------------------------
+
+// Función para escribir los resultados en JSON o CSV
+void escribirResultados(const OpcionesBenchmark& opciones, const std::vector<ResultadoBenchmark>& resultados, std::ostream& salida) {
+    if (opciones.formato == "csv") {
+        static const char* const columnasContadores[] = {"ciclos", "instrucciones", "ipc", "referencias_cache", "fallos_cache", "saltos", "fallos_salto"};
+        salida << "etiqueta,caso,parametros,muestras,llamadas_por_muestra,ns_min,ns_mediana,ns_media,ns_p90";
+        for (const char* columna : columnasContadores) salida << "," << columna;
+        salida << ",detalles\n";
+        // Los objetos de parámetros y detalles van en una sola columna como clave=valor;clave=valor
+        auto aplanar = [](const json& objeto) {
+            std::string texto;
+            if (!objeto.is_object()) return texto;
+            for (auto it = objeto.begin(); it != objeto.end(); ++it) {
+                texto += (texto.empty() ? "" : ";") + it.key() + "=" + (it.value().is_string() ? it.value().get<std::string>() : it.value().dump());
+            }
+            return texto;
+        };
+        for (const auto& resultado : resultados) {
+            salida << opciones.etiqueta << "," << resultado.caso << "," << aplanar(resultado.parametros) << "," << resultado.muestras << ","
+                   << resultado.llamadasPorMuestra << "," << std::fixed << std::setprecision(1) << resultado.nsMinimo << ","
+                   << resultado.nsMediana << "," << resultado.nsMedia << "," << resultado.nsP90;
+            // Las columnas de contadores quedan vacías si no se midieron
+            for (const char* columna : columnasContadores) {
+                salida << ",";
+                if (resultado.contadores.is_object() && resultado.contadores.contains(columna)) {
+                    salida << std::setprecision(3) << resultado.contadores[columna].get<double>();
+                }
+            }
+            salida << "," << aplanar(resultado.detalles) << std::setprecision(1) << "\n";
+        }
+        return;
+    }
+
+    json documento;
+    documento["etiqueta"] = opciones.etiqueta;
+    documento["compilador"] = COMPILADOR;
+    documento["compilado"] = std::string(__DATE__) + " " + __TIME__;
+    documento["resultados"] = json::array();
+    for (const auto& resultado : resultados) {
+        documento["resultados"].push_back({{"caso", resultado.caso},
+                                           {"parametros", resultado.parametros},
+                                           {"muestras", resultado.muestras},
+                                           {"llamadas_por_muestra", resultado.llamadasPorMuestra},
+                                           {"ns_min", resultado.nsMinimo},
+                                           {"ns_mediana", resultado.nsMediana},
+                                           {"ns_media", resultado.nsMedia},
+                                           {"ns_p90", resultado.nsP90},
+                                           {"contadores", resultado.contadores},
+                                           {"detalles", resultado.detalles}});
+    }
+    salida << documento.dump(2) << std::endl;
+}
+
+void mostrarUsoBenchmark() {
+    std::cout << "Uso: Benchmark [opciones]\n";
+    std::cout << "  --formato json|csv   Formato de los resultados (json por defecto)\n";
+    std::cout << "  --salida archivo     Archivo de resultados (salida estandar por defecto)\n";
+    std::cout << "  --filtro texto       Solo los casos cuyo nombre contiene el texto\n";
+    std::cout << "  --tiempo segundos    Tiempo minimo por caso (0.3 por defecto)\n";
+    std::cout << "  --etiqueta texto     Etiqueta de la version medida, se copia en los resultados\n";
+    std::cout << "  --rapido             Solo los tamanos pequenos\n";
+    std::cout << "  --contadores         Contadores de hardware por llamada (IPC, fallos de cache y de salto; solo Linux)\n";
+}
+
+//--------------------------------------------------------
+int main(int argc, char* argv[]) {
+    OpcionesBenchmark opciones;
+    for (int i = 1; i < argc; ++i) {
+        std::string opcion = argv[i];
+        if (opcion == "--formato" && i + 1 < argc) {
+            opciones.formato = argv[++i];
+        } else if (opcion == "--salida" && i + 1 < argc) {
+            opciones.salida = argv[++i];
+        } else if (opcion == "--filtro" && i + 1 < argc) {
+            opciones.filtro = argv[++i];
+        } else if (opcion == "--tiempo" && i + 1 < argc) {
+            opciones.tiempoMinimo = std::max(0.0, std::atof(argv[++i]));
+        } else if (opcion == "--etiqueta" && i + 1 < argc) {
+            opciones.etiqueta = argv[++i];
+        } else if (opcion == "--rapido") {
+            opciones.rapido = true;
+        } else if (opcion == "--contadores") {
+            opciones.contadores = true;
+        } else {
+            mostrarUsoBenchmark();
+            return opcion == "--ayuda" ? 0 : 1;
+        }
+    }
+    if (opciones.formato != "json" && opciones.formato != "csv") {
+        std::cerr << "Error: Formato desconocido " << opciones.formato << " (use json o csv)." << std::endl;
+        return 1;
+    }
+
+    std::string carpeta = (std::filesystem::temp_directory_path() / "benchmark_parque").string();
+    std::filesystem::create_directories(carpeta);
+
+    std::vector<ResultadoBenchmark> resultados;
+    ejecutarBenchmarks(opciones, carpeta, resultados);
+    std::filesystem::remove_all(carpeta);
+
+    if (opciones.salida == "-") {
+        escribirResultados(opciones, resultados, std::cout);
+        return 0;
+    }
+    std::ofstream archivo(opciones.salida);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << opciones.salida << " para escribir." << std::endl;
+        return 1;
+    }
+    escribirResultados(opciones, resultados, archivo);
+    return 0;
+}
@@ -0,0 +1,227 @@
+// Generador del clasificador compilado
+//
+// Convierte decisiones.json en un header con ramas constexpr anidadas y arreglos
+// constexpr para las hojas, de modo que el compilador pueda resolver la clasificacion
+// sin parsear el JSON al arrancar.
+//
+// Uso (paso previo a compilar Main.cpp con -DARBOL_COMPILADO):
+//   g++ -std=c++17 -O2 GeneradorClasificador.cpp -o GeneradorClasificador
+//   ./GeneradorClasificador decisiones.json ArbolCompilado.h
+//   g++ -std=c++17 -O2 -DARBOL_COMPILADO Main.cpp -o Main
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// Estado del generador: preguntas y hojas sin repetir
+struct Generador {
+    std::vector<std::string> preguntas;
+    std::map<std::string, int> indicePregunta;
+    std::vector<std::vector<int>> hojas;
+    std::map<std::vector<int>, int> indiceHoja;
+    int profundidadMaxima = 0;
+};
+
+//-----------------------------------------------------------
+
+// Función para escapar una cadena como literal de C++
+std::string escaparLiteral(const std::string& texto) {
+    std::string resultado = "\"";
+    for (char c : texto) {
+        switch (c) {
+            case '"': resultado += "\\\""; break;
+            case '\\': resultado += "\\\\"; break;
+            case '\n': resultado += "\\n"; break;
+            case '\t': resultado += "\\t"; break;
+            default: resultado += c; break;
+        }
+    }
+    resultado += "\"";
+    return resultado;
+}
+
+//-----------------------------------------------------------
+
+// Función para registrar las preguntas y hojas del árbol (las hojas iguales se guardan una sola vez)
+void recorrerArbol(Generador& gen, const json& j, int profundidad) {
+    bool tieneIzquierda = j.contains("izquierda") && j["izquierda"].is_object();
+    bool tieneDerecha = j.contains("derecha") && j["derecha"].is_object();
+
+    if (!tieneIzquierda && !tieneDerecha) {
+        std::vector<int> identificadores;
+        if (j.contains("identificadores") && j["identificadores"].is_array()) {
+            identificadores = j["identificadores"].get<std::vector<int>>();
+        }
+        if (gen.indiceHoja.find(identificadores) == gen.indiceHoja.end()) {
+            gen.indiceHoja[identificadores] = static_cast<int>(gen.hojas.size());
+            gen.hojas.push_back(identificadores);
+        }
+        if (profundidad > gen.profundidadMaxima) {
+            gen.profundidadMaxima = profundidad;
+        }
+        return;
+    }
+
+    std::string pregunta = j.contains("pregunta") ? j["pregunta"].get<std::string>() : "";
+    if (gen.indicePregunta.find(pregunta) == gen.indicePregunta.end()) {
+        gen.indicePregunta[pregunta] = static_cast<int>(gen.preguntas.size());
+        gen.preguntas.push_back(pregunta);
+    }
+
+    // Una rama ausente se trata como una hoja vacía
+    static const json hojaVacia = json::object();
+    recorrerArbol(gen, tieneIzquierda ? j["izquierda"] : hojaVacia, profundidad + 1);
+    recorrerArbol(gen, tieneDerecha ? j["derecha"] : hojaVacia, profundidad + 1);
+}
+
+//-----------------------------------------------------------
+
+// Función para emitir las ramas anidadas de un nodo
+// Con respuestasConocidas = true se consulta el bit de la profundidad actual; si no, se llama a preguntar(indice)
+void emitirRamas(const Generador& gen, const json& j, int profundidad, bool respuestasConocidas, std::ostream& salida) {
+    std::string sangria(4 * (profundidad + 1), ' ');
+    bool tieneIzquierda = j.contains("izquierda") && j["izquierda"].is_object();
+    bool tieneDerecha = j.contains("derecha") && j["derecha"].is_object();
+
+    if (!tieneIzquierda && !tieneDerecha) {
+        std::vector<int> identificadores;
+        if (j.contains("identificadores") && j["identificadores"].is_array()) {
+            identificadores = j["identificadores"].get<std::vector<int>>();
+        }
+        int indice = gen.indiceHoja.at(identificadores);
+        salida << sangria << "return hojas[" << indice << "];\n";
+        return;
+    }
+
+    std::string pregunta = j.contains("pregunta") ? j["pregunta"].get<std::string>() : "";
+    int indice = gen.indicePregunta.at(pregunta);
+    // La pregunta va en un comentario de línea: sin saltos de línea ni barras invertidas, porque una barra al final
+    // uniría la línea siguiente del código generado al comentario
+    std::string comentario = pregunta;
+    for (char& c : comentario) {
+        if (c == '\n' || c == '\r' || c == '\\') c = ' ';
+    }
+
+    static const json hojaVacia = json::object();
+    if (respuestasConocidas) {
+        salida << sangria << "if (respuestas & (1ULL << " << profundidad << ")) {  // " << comentario << "\n";
+    } else {
+        salida << sangria << "if (preguntar(" << indice << ")) {  // " << comentario << "\n";
+    }
+    emitirRamas(gen, tieneIzquierda ? j["izquierda"] : hojaVacia, profundidad + 1, respuestasConocidas, salida);
+    salida << sangria << "} else {\n";
+    emitirRamas(gen, tieneDerecha ? j["derecha"] : hojaVacia, profundidad + 1, respuestasConocidas, salida);
+    salida << sangria << "}\n";
+}
+
+//-----------------------------------------------------------
+
+// Función para escribir el header del clasificador compilado
+bool escribirClasificador(const json& arbol, const std::string& archivoOrigen, const std::string& archivoSalida) {
+    Generador gen;
+    recorrerArbol(gen, arbol, 0);
+
+    if (gen.profundidadMaxima >= 64) {
+        std::cerr << "Error: El arbol tiene " << gen.profundidadMaxima << " niveles; el clasificador admite hasta 63." << std::endl;
+        return false;
+    }
+
+    std::ostringstream salida;
+    salida << "// Archivo generado por GeneradorClasificador a partir de " << archivoOrigen << ". No editar a mano.\n";
+    salida << "#pragma once\n\n";
+    salida << "#include <cstddef>\n\n";
+    salida << "namespace arbol_compilado {\n\n";
+
+    salida << "// Hoja del árbol: lista de identificadores de atracciones sugeridas\n";
+    salida << "struct Hoja {\n";
+    salida << "    const int* identificadores;\n";
+    salida << "    std::size_t cantidad;\n";
+    salida << "};\n\n";
+
+    salida << "constexpr int profundidadMaxima = " << gen.profundidadMaxima << ";\n";
+    salida << "constexpr std::size_t numeroPreguntas = " << gen.preguntas.size() << ";\n";
+    salida << "constexpr std::size_t numeroHojas = " << gen.hojas.size() << ";\n\n";
+
+    salida << "constexpr const char* preguntas[] = {\n";
+    for (const auto& pregunta : gen.preguntas) {
+        salida << "    " << escaparLiteral(pregunta) << ",\n";
+    }
+    if (gen.preguntas.empty()) {
+        salida << "    \"\",\n";
+    }
+    salida << "};\n\n";
+
+    for (std::size_t i = 0; i < gen.hojas.size(); ++i) {
+        salida << "constexpr int hoja" << i << "[] = {";
+        for (std::size_t k = 0; k < gen.hojas[i].size(); ++k) {
+            salida << (k ? ", " : "") << gen.hojas[i][k];
+        }
+        // Un arreglo de C++ no puede tener tamaño cero
+        if (gen.hojas[i].empty()) {
+            salida << "0";
+        }
+        salida << "};\n";
+    }
+    salida << "\nconstexpr Hoja hojas[] = {\n";
+    for (std::size_t i = 0; i < gen.hojas.size(); ++i) {
+        salida << "    {hoja" << i << ", " << gen.hojas[i].size() << "},\n";
+    }
+    salida << "};\n\n";
+
+    salida << "// Clasificación con respuestas conocidas: el bit d indica la respuesta (1 = Si) a la pregunta de profundidad d\n";
+    salida << "constexpr Hoja clasificarRespuestas(unsigned long long respuestas) {\n";
+    emitirRamas(gen, arbol, 0, true, salida);
+    salida << "}\n\n";
+
+    salida << "// Clasificación interactiva: preguntar(indice) devuelve true si la respuesta a preguntas[indice] es Si\n";
+    salida << "template <typename Preguntar>\n";
+    salida << "inline Hoja clasificar(Preguntar&& preguntar) {\n";
+    emitirRamas(gen, arbol, 0, false, salida);
+    salida << "}\n\n";
+
+    salida << "} // namespace arbol_compilado\n";
+
+    std::ofstream archivo(archivoSalida);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoSalida << " para escribir." << std::endl;
+        return false;
+    }
+    archivo << salida.str();
+    return true;
+}
+
+//--------------------------------------------------------
+int main(int argc, char* argv[]) {
+    std::string archivoJSON = argc > 1 ? argv[1] : "decisiones.json";
+    std::string archivoSalida = argc > 2 ? argv[2] : "ArbolCompilado.h";
+
+    std::ifstream archivo(archivoJSON);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoJSON << std::endl;
+        return 1;
+    }
+
+    json j;
+    try {
+        archivo >> j;
+    } catch (const json::parse_error& e) {
+        std::cerr << "Error de parseo en el archivo " << archivoJSON << ": " << e.what() << std::endl;
+        return 1;
+    }
+    if (j.is_null() || j.empty() || !j.is_object()) {
+        std::cerr << "Error: El archivo " << archivoJSON << " contiene JSON inválido o vacío." << std::endl;
+        return 1;
+    }
+
+    if (!escribirClasificador(j, archivoJSON, archivoSalida)) {
+        return 1;
+    }
+    std::cout << "Clasificador generado en " << archivoSalida << "." << std::endl;
+    return 0;
+}
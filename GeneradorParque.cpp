@@ -0,0 +1,386 @@
+// Generador de parques sintéticos
+//
+// Crea los archivos de un parque de cualquier tamaño (de 10^2 a 10^7 nodos) para medir el
+// programa a escala:
+//   grafo.csv          matriz de adyacencia, el formato original (solo hasta --maximo-matriz nodos)
+//   grafo_aristas.csv  lista de aristas "origen,destino,metros", un camino de doble sentido por línea
+//   atracciones.json   una atracción por nodo, con tiempos de espera, abierta y accesible
+//   decisiones.json    árbol de decisiones al azar con la profundidad pedida
+//
+// El parque es una cuadrícula casi plana: caminos entre celdas vecinas (algunos se quitan),
+// unas pocas diagonales y zonas temáticas con caminos más cortos y esperas más largas cerca
+// del centro de cada zona. Las hojas del árbol recomiendan atracciones de una misma zona.
+//
+// Con la misma semilla se generan exactamente los mismos archivos en cualquier sistema: el
+// generador de números al azar y las distribuciones están escritos aquí y no dependen de la
+// biblioteca estándar.
+//
+// Uso:
+//   g++ -std=c++17 -O2 GeneradorParque.cpp -o GeneradorParque
+//   ./GeneradorParque --nodos 100000 --semilla 7 --profundidad 8 --carpeta parque_100k
+// Main lee grafo.csv y reconoce el formato por el encabezado, así que para un parque sin matriz
+// basta con copiar grafo_aristas.csv como grafo.csv.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// Opciones del parque a generar
+struct OpcionesParque {
+    long long nodos = 100;
+    std::uint64_t semilla = 1;
+    int profundidad = 6;
+    long long maximoMatriz = 5000; // La matriz crece con n^2: 5000 nodos ya son ~50 MB
+    std::string carpeta = ".";
+};
+
+// Generador splitmix64: rápido, con buena mezcla y con el mismo resultado en cualquier plataforma
+struct Azar {
+    std::uint64_t estado;
+};
+
+std::uint64_t siguienteAzar(Azar& azar) {
+    std::uint64_t z = (azar.estado += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Entero uniforme en [minimo, maximo]
+long long enteroAzar(Azar& azar, long long minimo, long long maximo) {
+    return minimo + static_cast<long long>(siguienteAzar(azar) % static_cast<std::uint64_t>(maximo - minimo + 1));
+}
+
+// Real uniforme en [0, 1)
+double realAzar(Azar& azar) {
+    return (siguienteAzar(azar) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Zona temática: un centro en la cuadrícula y una popularidad que sube las esperas cerca del centro
+struct Zona {
+    long long fila;
+    long long columna;
+    double radio;
+    int popularidad; // Espera máxima en el centro, en minutos
+};
+
+// Disposición del parque: nodo i en la celda (i / ancho, i % ancho)
+struct Parque {
+    long long nodos = 0;
+    long long ancho = 0;
+    std::vector<Zona> zonas;
+    std::vector<int> zonaDeNodo; // -1 fuera de toda zona
+};
+
+//-----------------------------------------------------------
+
+// Función para repartir las zonas y asignar cada nodo a la zona más cercana que lo cubra
+void disenarParque(Parque& parque, const OpcionesParque& opciones, Azar& azar) {
+    parque.nodos = opciones.nodos;
+    parque.ancho = std::max(1LL, static_cast<long long>(std::ceil(std::sqrt(static_cast<double>(opciones.nodos)))));
+    long long filas = (parque.nodos + parque.ancho - 1) / parque.ancho;
+
+    // Una zona por cada ~400 nodos, con un mínimo de 2
+    long long numZonas = std::max(2LL, parque.nodos / 400);
+    double radioBase = std::max(2.0, std::sqrt(400.0 / 3.14159) * 0.8);
+    for (long long z = 0; z < numZonas; ++z) {
+        Zona zona;
+        zona.fila = enteroAzar(azar, 0, filas - 1);
+        zona.columna = enteroAzar(azar, 0, parque.ancho - 1);
+        zona.radio = radioBase * (0.6 + 0.8 * realAzar(azar));
+        zona.popularidad = static_cast<int>(enteroAzar(azar, 20, 120));
+        parque.zonas.push_back(zona);
+    }
+
+    // Las zonas se ubican en una rejilla gruesa para asignar los nodos sin revisar todas las zonas
+    long long celda = static_cast<long long>(std::ceil(radioBase * 1.4)) + 1;
+    long long columnasRejilla = parque.ancho / celda + 1;
+    long long filasRejilla = filas / celda + 1;
+    std::vector<std::vector<int>> rejilla(columnasRejilla * filasRejilla);
+    for (std::size_t z = 0; z < parque.zonas.size(); ++z) {
+        rejilla[(parque.zonas[z].fila / celda) * columnasRejilla + parque.zonas[z].columna / celda].push_back(static_cast<int>(z));
+    }
+
+    parque.zonaDeNodo.assign(parque.nodos, -1);
+    for (long long i = 0; i < parque.nodos; ++i) {
+        long long fila = i / parque.ancho;
+        long long columna = i % parque.ancho;
+        double mejor = 1e18;
+        for (long long df = -1; df <= 1; ++df) {
+            for (long long dc = -1; dc <= 1; ++dc) {
+                long long fr = fila / celda + df;
+                long long cr = columna / celda + dc;
+                if (fr < 0 || cr < 0 || fr >= filasRejilla || cr >= columnasRejilla) continue;
+                for (int z : rejilla[fr * columnasRejilla + cr]) {
+                    double distancia = std::hypot(static_cast<double>(fila - parque.zonas[z].fila),
+                                                  static_cast<double>(columna - parque.zonas[z].columna));
+                    if (distancia <= parque.zonas[z].radio && distancia < mejor) {
+                        mejor = distancia;
+                        parque.zonaDeNodo[i] = z;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Distancia de un nodo al centro de su zona, relativa al radio (0 en el centro, 1 en el borde)
+double cercaniaAlCentro(const Parque& parque, long long nodo) {
+    const Zona& zona = parque.zonas[parque.zonaDeNodo[nodo]];
+    double distancia = std::hypot(static_cast<double>(nodo / parque.ancho - zona.fila),
+                                  static_cast<double>(nodo % parque.ancho - zona.columna));
+    return std::min(1.0, distancia / zona.radio);
+}
+
+//-----------------------------------------------------------
+
+// Función para recorrer los caminos del parque una sola vez, en orden; cada camino se entrega a visitar(u, v, metros)
+// Los caminos horizontales y la primera columna siempre existen, así el parque queda conexo
+template <typename Visitar>
+void generarCaminos(const Parque& parque, std::uint64_t semilla, Visitar&& visitar) {
+    Azar azar{semilla ^ 0xC0FFEEULL};
+    auto metrosEntre = [&](long long u, long long v, int base) {
+        int metros = static_cast<int>(enteroAzar(azar, base * 8 / 10, base * 12 / 10));
+        // Dentro de una misma zona los caminos son más cortos
+        if (parque.zonaDeNodo[u] >= 0 && parque.zonaDeNodo[u] == parque.zonaDeNodo[v]) metros = metros * 6 / 10;
+        return std::max(1, metros);
+    };
+    for (long long u = 0; u < parque.nodos; ++u) {
+        long long columna = u % parque.ancho;
+        long long derecha = u + 1;
+        long long abajo = u + parque.ancho;
+        long long diagonal = u + parque.ancho + 1;
+        if (columna + 1 < parque.ancho && derecha < parque.nodos) {
+            visitar(u, derecha, metrosEntre(u, derecha, 100));
+        }
+        if (abajo < parque.nodos && (columna == 0 || realAzar(azar) < 0.7)) {
+            visitar(u, abajo, metrosEntre(u, abajo, 100));
+        }
+        if (columna + 1 < parque.ancho && diagonal < parque.nodos && realAzar(azar) < 0.05) {
+            visitar(u, diagonal, metrosEntre(u, diagonal, 141));
+        }
+    }
+}
+
+bool escribirListaAristas(const Parque& parque, std::uint64_t semilla, const std::string& archivoCSV) {
+    std::ofstream archivo(archivoCSV);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoCSV << " para escribir." << std::endl;
+        return false;
+    }
+    archivo << "origen,destino,metros\n";
+    std::string buffer;
+    generarCaminos(parque, semilla, [&](long long u, long long v, int metros) {
+        buffer += std::to_string(u + 1);
+        buffer += ',';
+        buffer += std::to_string(v + 1);
+        buffer += ',';
+        buffer += std::to_string(metros);
+        buffer += '\n';
+        if (buffer.size() > (1 << 20)) {
+            archivo << buffer;
+            buffer.clear();
+        }
+    });
+    archivo << buffer;
+    return true;
+}
+
+bool escribirMatriz(const Parque& parque, std::uint64_t semilla, const std::string& archivoCSV) {
+    std::ofstream archivo(archivoCSV);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoCSV << " para escribir." << std::endl;
+        return false;
+    }
+    // Los caminos de cada nodo se guardan por fila (son pocos) y la fila se escribe completa
+    std::vector<std::vector<std::pair<long long, int>>> caminos(parque.nodos);
+    generarCaminos(parque, semilla, [&](long long u, long long v, int metros) {
+        caminos[u].push_back({v, metros});
+        caminos[v].push_back({u, metros});
+    });
+    std::string fila;
+    for (long long u = 0; u < parque.nodos; ++u) {
+        std::sort(caminos[u].begin(), caminos[u].end());
+        fila.clear();
+        std::size_t k = 0;
+        for (long long v = 0; v < parque.nodos; ++v) {
+            if (v) fila += ',';
+            if (k < caminos[u].size() && caminos[u][k].first == v) {
+                fila += std::to_string(caminos[u][k++].second);
+            } else {
+                fila += '0';
+            }
+        }
+        fila += '\n';
+        archivo << fila;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------
+
+// Función para escribir atracciones.json con el mismo formato que guardarTiempoEspera
+// Se escribe a mano en lugar de armar un json completo, que con millones de atracciones no cabría en memoria
+bool escribirAtracciones(const Parque& parque, std::uint64_t semilla, const std::string& archivoJSON) {
+    std::ofstream archivo(archivoJSON);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoJSON << " para escribir." << std::endl;
+        return false;
+    }
+    static const char* const tipos[] = {"Montana Rusa", "Carrusel", "Tunel", "Rueda", "Tazas", "Rio", "Torre", "Casa", "Simulador", "Teatro"};
+    Azar azar{semilla ^ 0xA77ACC10ULL};
+    std::string buffer = "[";
+    for (long long i = 0; i < parque.nodos; ++i) {
+        int espera;
+        std::string nombre = std::string(tipos[enteroAzar(azar, 0, 9)]) + " " + std::to_string(i + 1);
+        if (parque.zonaDeNodo[i] >= 0) {
+            const Zona& zona = parque.zonas[parque.zonaDeNodo[i]];
+            double factor = 1.0 - 0.7 * cercaniaAlCentro(parque, i);
+            espera = static_cast<int>(zona.popularidad * factor) + static_cast<int>(enteroAzar(azar, 0, 10));
+            nombre += " (Zona " + std::to_string(parque.zonaDeNodo[i] + 1) + ")";
+        } else {
+            espera = static_cast<int>(enteroAzar(azar, 0, 15));
+        }
+        bool abierta = realAzar(azar) >= 0.03;
+        bool accesible = realAzar(azar) >= 0.10;
+
+        buffer += i ? ",\n" : "\n";
+        buffer += "    {\n        \"abierta\": ";
+        buffer += abierta ? "true" : "false";
+        buffer += ",\n        \"accesible\": ";
+        buffer += accesible ? "true" : "false";
+        buffer += ",\n        \"identificador\": " + std::to_string(i + 1);
+        buffer += ",\n        \"nombre\": \"" + nombre + "\"";
+        buffer += ",\n        \"tiempo_espera\": " + std::to_string(espera) + "\n    }";
+        if (buffer.size() > (1 << 20)) {
+            archivo << buffer;
+            buffer.clear();
+        }
+    }
+    buffer += "\n]";
+    archivo << buffer;
+    return true;
+}
+
+//-----------------------------------------------------------
+
+// Función para generar un árbol de decisiones al azar; las hojas recomiendan atracciones de una zona
+json generarArbol(const Parque& parque, Azar& azar, int profundidad) {
+    static const char* const preguntas[] = {
+        "Eres menor de edad?",
+        "Vienes con un mayor de edad?",
+        "Te gustan las atracciones emocionantes?",
+        "Tu estatura es de mas de 1 metro y 30 centimetros?",
+        "Vienes en grupo?",
+        "Te mareas con facilidad?",
+        "Prefieres atracciones con agua?",
+        "Tienes poco tiempo disponible?",
+        "Vienes con ninos pequenos?",
+        "Te gustan los espectaculos?",
+        "Buscas atracciones tranquilas?",
+        "Usas silla de ruedas o coche de bebe?",
+    };
+    const int numPreguntas = sizeof(preguntas) / sizeof(preguntas[0]);
+
+    if (profundidad == 0) {
+        // Atracciones cercanas al centro de una zona elegida al azar
+        const Zona& zona = parque.zonas[enteroAzar(azar, 0, static_cast<long long>(parque.zonas.size()) - 1)];
+        long long cantidad = enteroAzar(azar, 3, 8);
+        std::vector<long long> identificadores;
+        for (long long k = 0; k < cantidad * 4 && static_cast<long long>(identificadores.size()) < cantidad; ++k) {
+            long long fila = zona.fila + enteroAzar(azar, -static_cast<long long>(zona.radio), static_cast<long long>(zona.radio));
+            long long columna = zona.columna + enteroAzar(azar, -static_cast<long long>(zona.radio), static_cast<long long>(zona.radio));
+            if (fila < 0 || columna < 0 || columna >= parque.ancho) continue;
+            long long nodo = fila * parque.ancho + columna;
+            if (nodo >= parque.nodos) continue;
+            identificadores.push_back(nodo + 1);
+        }
+        if (identificadores.empty()) identificadores.push_back(enteroAzar(azar, 1, parque.nodos));
+        std::sort(identificadores.begin(), identificadores.end());
+        identificadores.erase(std::unique(identificadores.begin(), identificadores.end()), identificadores.end());
+        return json{{"identificadores", identificadores}};
+    }
+    json nodo;
+    nodo["pregunta"] = preguntas[enteroAzar(azar, 0, numPreguntas - 1)];
+    nodo["izquierda"] = generarArbol(parque, azar, profundidad - 1);
+    nodo["derecha"] = generarArbol(parque, azar, profundidad - 1);
+    return nodo;
+}
+
+bool escribirArbol(const Parque& parque, std::uint64_t semilla, int profundidad, const std::string& archivoJSON) {
+    std::ofstream archivo(archivoJSON);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoJSON << " para escribir." << std::endl;
+        return false;
+    }
+    Azar azar{semilla ^ 0xDEC1510EULL};
+    archivo << generarArbol(parque, azar, profundidad).dump(2) << std::endl;
+    return true;
+}
+
+void mostrarUso() {
+    std::cout << "Uso: GeneradorParque [opciones]\n";
+    std::cout << "  --nodos N            Numero de nodos/atracciones (100 por defecto, hasta 10^7)\n";
+    std::cout << "  --semilla S          Semilla; la misma semilla genera los mismos archivos (1 por defecto)\n";
+    std::cout << "  --profundidad D      Profundidad del arbol de decisiones (6 por defecto, hasta 20)\n";
+    std::cout << "  --maximo-matriz N    Solo se escribe grafo.csv si hay a lo sumo N nodos (5000 por defecto)\n";
+    std::cout << "  --carpeta ruta       Carpeta de salida (la actual por defecto)\n";
+}
+
+//--------------------------------------------------------
+int main(int argc, char* argv[]) {
+    OpcionesParque opciones;
+    for (int i = 1; i < argc; ++i) {
+        std::string opcion = argv[i];
+        if (opcion == "--nodos" && i + 1 < argc) {
+            opciones.nodos = std::atoll(argv[++i]);
+        } else if (opcion == "--semilla" && i + 1 < argc) {
+            opciones.semilla = std::strtoull(argv[++i], nullptr, 10);
+        } else if (opcion == "--profundidad" && i + 1 < argc) {
+            opciones.profundidad = std::atoi(argv[++i]);
+        } else if (opcion == "--maximo-matriz" && i + 1 < argc) {
+            opciones.maximoMatriz = std::atoll(argv[++i]);
+        } else if (opcion == "--carpeta" && i + 1 < argc) {
+            opciones.carpeta = argv[++i];
+        } else {
+            mostrarUso();
+            return opcion == "--ayuda" ? 0 : 1;
+        }
+    }
+    if (opciones.nodos < 2 || opciones.nodos > 10000000) {
+        std::cerr << "Error: El numero de nodos debe estar entre 2 y 10000000." << std::endl;
+        return 1;
+    }
+    if (opciones.profundidad < 0 || opciones.profundidad > 20) {
+        std::cerr << "Error: La profundidad del arbol debe estar entre 0 y 20." << std::endl;
+        return 1;
+    }
+
+    std::filesystem::create_directories(opciones.carpeta);
+    Azar azar{opciones.semilla};
+    Parque parque;
+    disenarParque(parque, opciones, azar);
+
+    std::string carpeta = opciones.carpeta + "/";
+    if (!escribirListaAristas(parque, opciones.semilla, carpeta + "grafo_aristas.csv")) return 1;
+    if (opciones.nodos <= opciones.maximoMatriz) {
+        if (!escribirMatriz(parque, opciones.semilla, carpeta + "grafo.csv")) return 1;
+    } else {
+        std::cout << "Matriz omitida: " << opciones.nodos << " nodos superan --maximo-matriz " << opciones.maximoMatriz << "." << std::endl;
+    }
+    if (!escribirAtracciones(parque, opciones.semilla, carpeta + "atracciones.json")) return 1;
+    if (!escribirArbol(parque, opciones.semilla, opciones.profundidad, carpeta + "decisiones.json")) return 1;
+
+    std::cout << "Parque generado en " << opciones.carpeta << ": " << opciones.nodos << " nodos, " << parque.zonas.size()
+              << " zonas, arbol de profundidad " << opciones.profundidad << "." << std::endl;
+    return 0;
+}
@@ -8,15 +8,83 @@
 #include <sstream> 
 #include <queue>
 #include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <unordered_set>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <charconv>
+#include <future>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <list>
+#include <array>
+#include <random>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+#ifdef ARBOL_COMPILADO
+#include "ArbolCompilado.h"
+#endif
 
 using json = nlohmann::json;
 
+// Conjunto de atracciones como bitset denso sobre la posición en el vector de atracciones
+struct ConjuntoAtracciones {
+    std::vector<std::uint64_t> palabras;
+};
+
+struct Grafo;
+
+// Ruta calculada para una hoja, válida mientras no cambien el grafo ni la huella de tiempos de espera
+struct RutaHoja {
+    std::weak_ptr<const Grafo> grafo; // Grafo con el que se calculó; expira o difiere si una recarga lo cambia
+    std::uint64_t huellaEspera;
+    std::vector<int> seleccionadas;
+    int inicio_indice;
+    std::vector<int> distancias;
+    std::vector<int> previos;
+    std::vector<int> esperas; // Tiempos de espera con los que se calcularon las distancias
+    std::vector<int> ruta;
+};
+
 // Nodo del Árbol de Decisiones
+// Los subárboles idénticos se comparten (el árbol cargado es un DAG), por lo que la ruta
+// cacheada de una hoja sirve para todas sus apariciones
 struct Nodo {
     std::string pregunta;
     Nodo* izquierda;
     Nodo* derecha;
     std::vector<int> identificadores; // Solo en nodos hoja
+    ConjuntoAtracciones conjunto; // Solo en nodos hoja, se llena con indexarHojas al cargar (antes de publicar)
+    std::shared_ptr<const RutaHoja> rutaCacheada; // Solo en nodos hoja; acceso con std::atomic_load/store
+};
+
+// Tabla de nodos únicos usada al construir el árbol (hash-consing)
+struct TablaNodos {
+    std::unordered_map<std::string, Nodo*> unicos;
+    std::size_t nodosLeidos = 0;
+    std::size_t bytesLeidos = 0;
+    std::size_t bytesUnicos = 0;
 };
 
 // Estructura para la información de atracciones
@@ -24,15 +92,612 @@ struct Atraccion {
     int identificador;
     std::string nombre;
     int tiempo_espera;
+    bool abierta = true;
+    bool accesible = true;
+};
+
+// Perfiles de espera por hora del día: tramos lineales entre puntos (minuto del día, espera en minutos)
+// Los puntos de todas las atracciones van juntos en un arreglo plano de 4 bytes por punto, ordenados por
+// atracción y minuto; una atracción sin puntos usa su tiempo_espera fijo
+struct PuntoPerfil {
+    std::uint16_t minuto;
+    std::uint16_t espera;
+};
+
+struct PerfilesEspera {
+    std::vector<int> inicioPuntos; // Los puntos de la atracción i están en [inicioPuntos[i], inicioPuntos[i + 1])
+    std::vector<PuntoPerfil> puntos;
 };
 
 // Estructura para el Grafo
+// La matriz es el formato original de grafo.csv. Las búsquedas recorren la lista de adyacencia compacta
+// (CSR), que se arma con cualquiera de los dos formatos; un parque grande en lista de aristas no necesita
+// la matriz n x n.
 struct Grafo {
     std::vector<std::vector<int>> matrizAdyacencia;
+    int numNodos = 0;
+    std::vector<int> inicioVecinos; // Los vecinos de u están en las posiciones [inicioVecinos[u], inicioVecinos[u + 1])
+    std::vector<int> vecinos;
+    std::vector<int> metros;
+    // Grafo inverso: los nodos desde los que se llega a u, para las búsquedas hacia atrás desde el destino
+    std::vector<int> inicioEntrantes;
+    std::vector<int> entrantes;
+    std::vector<int> metrosEntrantes;
+    // Marcas (landmarks) de la búsqueda ALT, por nodo: [nodo * numMarcas + i]. Vacías si no se calcularon.
+    // Las distancias son solo en metros, así siguen siendo cotas válidas cuando cambian los tiempos de espera.
+    int numMarcas = 0;
+    std::vector<int> marcas;
+    std::vector<int> metrosDesdeMarca; // De la marca i al nodo
+    std::vector<int> metrosHaciaMarca; // Del nodo a la marca i; vacía si el grafo es simétrico (sería igual a la anterior)
+};
+
+//-----------------------------------------------------------
+
+// Funciones del conjunto de atracciones (bitset)
+
+ConjuntoAtracciones crearConjunto(std::size_t numAtracciones) {
+    ConjuntoAtracciones conjunto;
+    conjunto.palabras.assign((numAtracciones + 63) / 64, 0);
+    return conjunto;
+}
+
+void agregarAtraccion(ConjuntoAtracciones& conjunto, std::size_t indice) {
+    conjunto.palabras[indice / 64] |= std::uint64_t(1) << (indice % 64);
+}
+
+bool contieneAtraccion(const ConjuntoAtracciones& conjunto, std::size_t indice) {
+    return indice / 64 < conjunto.palabras.size() && (conjunto.palabras[indice / 64] >> (indice % 64)) & 1;
+}
+
+// Intersección en sitio: una operación AND por cada 64 atracciones
+void intersectar(ConjuntoAtracciones& conjunto, const ConjuntoAtracciones& mascara) {
+    std::size_t n = std::min(conjunto.palabras.size(), mascara.palabras.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        conjunto.palabras[i] &= mascara.palabras[i];
+    }
+    for (std::size_t i = n; i < conjunto.palabras.size(); ++i) {
+        conjunto.palabras[i] = 0;
+    }
+}
+
+std::size_t contarAtracciones(const ConjuntoAtracciones& conjunto) {
+    std::size_t total = 0;
+    for (std::uint64_t palabra : conjunto.palabras) {
+        total += __builtin_popcountll(palabra);
+    }
+    return total;
+}
+
+// Recorre solo los bits encendidos y devuelve los identificadores en orden de posición
+std::vector<int> identificadoresDelConjunto(const ConjuntoAtracciones& conjunto, const std::vector<Atraccion>& atracciones) {
+    std::vector<int> identificadores;
+    identificadores.reserve(contarAtracciones(conjunto));
+    for (std::size_t i = 0; i < conjunto.palabras.size(); ++i) {
+        std::uint64_t palabra = conjunto.palabras[i];
+        while (palabra) {
+            std::size_t indice = i * 64 + __builtin_ctzll(palabra);
+            if (indice < atracciones.size()) {
+                identificadores.push_back(atracciones[indice].identificador);
+            }
+            palabra &= palabra - 1;
+        }
+    }
+    return identificadores;
+}
+
+// Posición de cada atracción en el vector, por identificador
+std::unordered_map<int, std::size_t> indicePorIdentificador(const std::vector<Atraccion>& atracciones) {
+    std::unordered_map<int, std::size_t> indice;
+    for (std::size_t i = 0; i < atracciones.size(); ++i) {
+        indice[atracciones[i].identificador] = i;
+    }
+    return indice;
+}
+
+// Construye el conjunto a partir de una lista de identificadores; los desconocidos se ignoran
+ConjuntoAtracciones conjuntoDesdeIdentificadores(const std::vector<int>& identificadores, const std::unordered_map<int, std::size_t>& indice, std::size_t numAtracciones) {
+    ConjuntoAtracciones conjunto = crearConjunto(numAtracciones);
+    for (int identificador : identificadores) {
+        auto it = indice.find(identificador);
+        if (it != indice.end()) {
+            agregarAtraccion(conjunto, it->second);
+        }
+    }
+    return conjunto;
+}
+
+ConjuntoAtracciones conjuntoDesdeIdentificadores(const std::vector<int>& identificadores, const std::vector<Atraccion>& atracciones) {
+    return conjuntoDesdeIdentificadores(identificadores, indicePorIdentificador(atracciones), atracciones.size());
+}
+
+// Máscaras de filtrado sobre el mismo espacio de índices
+
+ConjuntoAtracciones mascaraAbiertas(const std::vector<Atraccion>& atracciones) {
+    ConjuntoAtracciones mascara = crearConjunto(atracciones.size());
+    for (std::size_t i = 0; i < atracciones.size(); ++i) {
+        if (atracciones[i].abierta) agregarAtraccion(mascara, i);
+    }
+    return mascara;
+}
+
+ConjuntoAtracciones mascaraAccesibles(const std::vector<Atraccion>& atracciones) {
+    ConjuntoAtracciones mascara = crearConjunto(atracciones.size());
+    for (std::size_t i = 0; i < atracciones.size(); ++i) {
+        if (atracciones[i].accesible) agregarAtraccion(mascara, i);
+    }
+    return mascara;
+}
+
+// El límite de espera cambia en cada consulta: en vez de armar una máscara de todo el parque,
+// se recorren solo las atracciones del conjunto y se quitan las que esperan demasiado
+void quitarEsperaDesde(ConjuntoAtracciones& conjunto, const std::vector<Atraccion>& atracciones, int limiteMinutos) {
+    for (std::size_t i = 0; i < conjunto.palabras.size(); ++i) {
+        std::uint64_t palabra = conjunto.palabras[i];
+        while (palabra) {
+            std::size_t indice = i * 64 + __builtin_ctzll(palabra);
+            if (indice < atracciones.size() && atracciones[indice].tiempo_espera >= limiteMinutos) {
+                conjunto.palabras[i] &= ~(std::uint64_t(1) << (indice % 64));
+            }
+            palabra &= palabra - 1;
+        }
+    }
+}
+
+//-----------------------------------------------------------
+
+// Histograma de latencias log-lineal: 16 subcubetas por potencia de 2 (error relativo < 6.25%)
+// Los contadores son atómicos, así que varios hilos pueden registrar sin bloquearse
+
+const int CUBETAS_HISTOGRAMA = 16 + 60 * 16;
+
+struct HistogramaLatencia {
+    std::atomic<std::uint64_t> cubetas[CUBETAS_HISTOGRAMA] = {};
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<std::uint64_t> maximo{0};
+};
+
+int cubetaDeValor(std::uint64_t valor) {
+    if (valor < 16) return static_cast<int>(valor);
+    int exponente = 63 - __builtin_clzll(valor);
+    int sub = static_cast<int>(valor >> (exponente - 4)) - 16;
+    return std::min(CUBETAS_HISTOGRAMA - 1, 16 + (exponente - 4) * 16 + sub);
+}
+
+std::uint64_t valorDeCubeta(int cubeta) {
+    if (cubeta < 16) return static_cast<std::uint64_t>(cubeta);
+    int exponente = (cubeta - 16) / 16 + 4;
+    int sub = (cubeta - 16) % 16;
+    // Punto medio del intervalo que cubre la cubeta
+    std::uint64_t inferior = std::uint64_t(16 + sub) << (exponente - 4);
+    return inferior + ((std::uint64_t(1) << (exponente - 4)) >> 1);
+}
+
+void registrarValor(HistogramaLatencia& histograma, std::uint64_t valor) {
+    histograma.cubetas[cubetaDeValor(valor)].fetch_add(1, std::memory_order_relaxed);
+    histograma.total.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t maximo = histograma.maximo.load(std::memory_order_relaxed);
+    while (valor > maximo && !histograma.maximo.compare_exchange_weak(maximo, valor, std::memory_order_relaxed)) {
+    }
+}
+
+// Valor aproximado del percentil (0 < fraccion <= 1)
+std::uint64_t percentil(const HistogramaLatencia& histograma, double fraccion) {
+    std::uint64_t total = histograma.total.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    std::uint64_t objetivo = static_cast<std::uint64_t>(fraccion * total + 0.5);
+    if (objetivo == 0) objetivo = 1;
+    std::uint64_t acumulado = 0;
+    for (int i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+        acumulado += histograma.cubetas[i].load(std::memory_order_relaxed);
+        if (acumulado >= objetivo) {
+            return std::min(valorDeCubeta(i), histograma.maximo.load(std::memory_order_relaxed));
+        }
+    }
+    return histograma.maximo.load(std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------
+
+// Traza de eventos en formato Chrome (chrome://tracing, Perfetto): un tramo por cada etapa medida y por petición
+// Cada hilo escribe solo en su propio buffer de tamaño fijo, sin bloqueos; el contador se publica con
+// release después de escribir el evento, así el volcado puede leer mientras los hilos siguen trabajando
+
+struct EventoTraza {
+    const char* nombre;
+    std::uint64_t inicioNs; // Desde el arranque de la traza
+    std::uint64_t duracionNs;
+    char detalle[48];       // Texto libre, por ejemplo la petición HTTP; vacío si no hay
+};
+
+struct BufferTraza {
+    int hilo;
+    std::string nombreHilo;
+    std::unique_ptr<EventoTraza[]> eventos;
+    std::atomic<std::size_t> cantidad{0};
+    std::atomic<std::uint64_t> descartados{0};
+};
+
+struct TrazaParque {
+    std::atomic<bool> activa{false};
+    std::string archivo;
+    std::size_t capacidadPorHilo = 1 << 18;
+    std::chrono::steady_clock::time_point inicio;
+    std::mutex mutex; // Solo para registrar buffers nuevos
+    std::vector<std::unique_ptr<BufferTraza>> buffers;
+};
+
+TrazaParque trazaParque;
+thread_local BufferTraza* bufferTrazaDelHilo = nullptr;
+
+bool trazaActiva() {
+    return trazaParque.activa.load(std::memory_order_relaxed);
+}
+
+// El buffer vive hasta el final del programa aunque el hilo termine antes
+BufferTraza* bufferTraza(const std::string& nombreHilo = "") {
+    if (!bufferTrazaDelHilo) {
+        auto buffer = std::make_unique<BufferTraza>();
+        buffer->eventos.reset(new EventoTraza[trazaParque.capacidadPorHilo]);
+        std::lock_guard<std::mutex> bloqueo(trazaParque.mutex);
+        buffer->hilo = static_cast<int>(trazaParque.buffers.size()) + 1;
+        buffer->nombreHilo = nombreHilo.empty() ? "hilo " + std::to_string(buffer->hilo) : nombreHilo;
+        bufferTrazaDelHilo = buffer.get();
+        trazaParque.buffers.push_back(std::move(buffer));
+    }
+    return bufferTrazaDelHilo;
+}
+
+// Da nombre al hilo actual en la traza (los trabajadores, el vigilante de archivos, el hilo principal)
+void nombrarHiloTraza(const std::string& nombre) {
+    if (trazaActiva()) bufferTraza(nombre);
+}
+
+void registrarTramo(const char* nombre, std::chrono::steady_clock::time_point inicio, std::chrono::steady_clock::time_point fin,
+                    const char* detalle = nullptr) {
+    BufferTraza* buffer = bufferTraza();
+    std::size_t posicion = buffer->cantidad.load(std::memory_order_relaxed);
+    if (posicion >= trazaParque.capacidadPorHilo) {
+        buffer->descartados.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    EventoTraza& evento = buffer->eventos[posicion];
+    evento.nombre = nombre;
+    evento.inicioNs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(inicio - trazaParque.inicio).count());
+    evento.duracionNs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(fin - inicio).count());
+    evento.detalle[0] = '\0';
+    if (detalle) {
+        std::strncpy(evento.detalle, detalle, sizeof(evento.detalle) - 1);
+        evento.detalle[sizeof(evento.detalle) - 1] = '\0';
+    }
+    buffer->cantidad.store(posicion + 1, std::memory_order_release);
+}
+
+// Escapa comillas, barras y caracteres de control para el JSON de la traza
+void escribirTextoTraza(std::ostream& salida, const std::string& texto) {
+    salida << '"';
+    for (unsigned char c : texto) {
+        if (c == '"' || c == '\\') salida << '\\' << c;
+        else if (c < 0x20) salida << ' ';
+        else salida << c;
+    }
+    salida << '"';
+}
+
+// Escribe todos los buffers como JSON de Chrome: eventos "X" (tramo completo) con tiempos en microsegundos
+void volcarTraza() {
+    std::ofstream salida(trazaParque.archivo);
+    if (!salida.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << trazaParque.archivo << " para escribir." << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> bloqueo(trazaParque.mutex);
+    std::uint64_t eventos = 0;
+    std::uint64_t descartados = 0;
+    char numero[64];
+    salida << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    salida << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Parque\"}}";
+    for (const auto& buffer : trazaParque.buffers) {
+        salida << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->hilo << ",\"args\":{\"name\":";
+        escribirTextoTraza(salida, buffer->nombreHilo);
+        salida << "}}";
+        std::size_t cantidad = buffer->cantidad.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < cantidad; ++i) {
+            const EventoTraza& evento = buffer->eventos[i];
+            std::snprintf(numero, sizeof(numero), "%.3f,\"dur\":%.3f", evento.inicioNs / 1000.0, evento.duracionNs / 1000.0);
+            salida << ",\n{\"name\":\"" << evento.nombre << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->hilo << ",\"ts\":" << numero;
+            if (evento.detalle[0]) {
+                salida << ",\"args\":{\"detalle\":";
+                escribirTextoTraza(salida, evento.detalle);
+                salida << "}";
+            }
+            salida << "}";
+        }
+        eventos += cantidad;
+        descartados += buffer->descartados.load(std::memory_order_relaxed);
+    }
+    salida << "\n]}\n";
+    std::cerr << "Traza: " << eventos << " eventos en " << trazaParque.archivo;
+    if (descartados > 0) std::cerr << " (" << descartados << " descartados por buffer lleno)";
+    std::cerr << std::endl;
+}
+
+void activarTraza(const std::string& archivo) {
+    trazaParque.archivo = archivo;
+    trazaParque.inicio = std::chrono::steady_clock::now();
+    trazaParque.activa = true;
+    std::atexit(volcarTraza);
+    nombrarHiloTraza("principal");
+}
+
+// Tramo de traza para un bloque que no es una etapa medida (una petición, un bloque del modo por lotes)
+struct TramoTraza {
+    const char* nombre;
+    bool activo;
+    std::chrono::steady_clock::time_point inicio;
+
+    explicit TramoTraza(const char* nombre) : nombre(nombre), activo(trazaActiva()) {
+        if (activo) inicio = std::chrono::steady_clock::now();
+    }
+    ~TramoTraza() {
+        if (activo) registrarTramo(nombre, inicio, std::chrono::steady_clock::now());
+    }
+    TramoTraza(const TramoTraza&) = delete;
+    TramoTraza& operator=(const TramoTraza&) = delete;
+};
+
+//-----------------------------------------------------------
+
+// Instrumentación por etapas: un histograma de duraciones (ns) por etapa y contadores de las búsquedas
+// Siempre viene compilada; mientras está apagada, cada medición cuesta una lectura atómica
+
+enum EtapaMedida {
+    ETAPA_CARGA_GRAFO,
+    ETAPA_CARGA_ATRACCIONES,
+    ETAPA_CARGA_ARBOL,
+    ETAPA_CARGA_MARCAS,
+    ETAPA_CARGA_JERARQUIA,
+    ETAPA_CARGA_PARTICION,
+    ETAPA_PERSONALIZACION,
+    ETAPA_INTERPRETAR,
+    ETAPA_CLASIFICAR,
+    ETAPA_DIJKSTRA,
+    ETAPA_DELTA_STEPPING,
+    ETAPA_REPARACION,
+    ETAPA_PUNTO_A_PUNTO,
+    ETAPA_RECONSTRUCCION,
+    ETAPA_RECORRIDO,
+    ETAPA_PLAN,
+    ETAPA_PARETO,
+    ETAPA_ALTERNATIVAS,
+    ETAPA_IMPRESION,
+    ETAPA_PERSISTENCIA,
+    NUM_ETAPAS
+};
+
+const char* const NOMBRES_ETAPAS[NUM_ETAPAS] = {
+    "carga_grafo", "carga_atracciones", "carga_arbol", "carga_marcas", "carga_jerarquia", "carga_particion", "personalizacion", "interpretar_consulta", "clasificar",
+    "dijkstra", "delta_stepping", "reparacion", "punto_a_punto", "reconstruccion_ruta", "recorrido", "plan", "pareto", "alternativas", "impresion_ruta", "persistencia",
+};
+
+struct Instrumentacion {
+    std::atomic<bool> activa{false};
+    std::atomic<bool> volcadoPedido{false}; // Lo enciende SIGUSR1; se atiende en el siguiente punto seguro
+    HistogramaLatencia etapas[NUM_ETAPAS];
+    std::atomic<std::uint64_t> nodosAsentados{0};
+    std::atomic<std::uint64_t> aristasRelajadas{0};
+    std::atomic<std::uint64_t> insercionesHeap{0};
+    std::atomic<std::uint64_t> extraccionesHeap{0};
+};
+
+Instrumentacion instrumentacion;
+
+bool instrumentacionActiva() {
+    return instrumentacion.activa.load(std::memory_order_relaxed);
+}
+
+// Mide el bloque en el que se declara: registra la duración en su etapa y, con la traza encendida, un tramo
+struct CronometroEtapa {
+    EtapaMedida etapa;
+    bool medir;
+    bool trazar;
+    std::chrono::steady_clock::time_point inicio;
+
+    explicit CronometroEtapa(EtapaMedida etapa) : etapa(etapa), medir(instrumentacionActiva()), trazar(trazaActiva()) {
+        if (medir || trazar) inicio = std::chrono::steady_clock::now();
+    }
+    ~CronometroEtapa() {
+        if (!medir && !trazar) return;
+        auto fin = std::chrono::steady_clock::now();
+        if (medir) {
+            auto duracion = std::chrono::duration_cast<std::chrono::nanoseconds>(fin - inicio);
+            registrarValor(instrumentacion.etapas[etapa], static_cast<std::uint64_t>(duracion.count()));
+        }
+        if (trazar) registrarTramo(NOMBRES_ETAPAS[etapa], inicio, fin);
+    }
+    CronometroEtapa(const CronometroEtapa&) = delete;
+    CronometroEtapa& operator=(const CronometroEtapa&) = delete;
 };
 
+// Las búsquedas cuentan en variables locales y suman una sola vez al terminar
+void sumarContadoresBusqueda(std::uint64_t asentados, std::uint64_t relajadas, std::uint64_t inserciones, std::uint64_t extracciones) {
+    if (!instrumentacionActiva()) return;
+    instrumentacion.nodosAsentados.fetch_add(asentados, std::memory_order_relaxed);
+    instrumentacion.aristasRelajadas.fetch_add(relajadas, std::memory_order_relaxed);
+    instrumentacion.insercionesHeap.fetch_add(inserciones, std::memory_order_relaxed);
+    instrumentacion.extraccionesHeap.fetch_add(extracciones, std::memory_order_relaxed);
+}
+
+// Tabla legible con las etapas medidas (en microsegundos) y los contadores
+void volcarInstrumentacion(std::ostream& salida) {
+    char linea[160];
+    salida << "Etapa                       llamadas        p50 us        p90 us        p99 us        max us\n";
+    for (int etapa = 0; etapa < NUM_ETAPAS; ++etapa) {
+        const HistogramaLatencia& histograma = instrumentacion.etapas[etapa];
+        std::uint64_t llamadas = histograma.total.load(std::memory_order_relaxed);
+        if (llamadas == 0) continue;
+        std::snprintf(linea, sizeof(linea), "%-24s %11llu %13.1f %13.1f %13.1f %13.1f\n", NOMBRES_ETAPAS[etapa],
+                      static_cast<unsigned long long>(llamadas), percentil(histograma, 0.50) / 1000.0, percentil(histograma, 0.90) / 1000.0,
+                      percentil(histograma, 0.99) / 1000.0, histograma.maximo.load(std::memory_order_relaxed) / 1000.0);
+        salida << linea;
+    }
+    salida << "Nodos asentados: " << instrumentacion.nodosAsentados.load() << ", aristas relajadas: " << instrumentacion.aristasRelajadas.load()
+           << ", inserciones en el heap: " << instrumentacion.insercionesHeap.load() << ", extracciones: " << instrumentacion.extraccionesHeap.load() << std::endl;
+}
+
+// Las mismas cifras en JSON, para /metricas
+std::string instrumentacionJSON() {
+    std::string salida = "{\"activa\":";
+    salida += instrumentacionActiva() ? "true" : "false";
+    salida += ",\"etapas\":{";
+    bool primera = true;
+    for (int etapa = 0; etapa < NUM_ETAPAS; ++etapa) {
+        const HistogramaLatencia& histograma = instrumentacion.etapas[etapa];
+        std::uint64_t llamadas = histograma.total.load(std::memory_order_relaxed);
+        if (llamadas == 0) continue;
+        if (!primera) salida += ',';
+        primera = false;
+        salida += "\"" + std::string(NOMBRES_ETAPAS[etapa]) + "\":{\"llamadas\":" + std::to_string(llamadas) +
+                  ",\"p50_us\":" + std::to_string(percentil(histograma, 0.50) / 1000.0) +
+                  ",\"p99_us\":" + std::to_string(percentil(histograma, 0.99) / 1000.0) +
+                  ",\"max_us\":" + std::to_string(histograma.maximo.load(std::memory_order_relaxed) / 1000.0) + "}";
+    }
+    salida += "},\"nodos_asentados\":" + std::to_string(instrumentacion.nodosAsentados.load()) +
+              ",\"aristas_relajadas\":" + std::to_string(instrumentacion.aristasRelajadas.load()) +
+              ",\"inserciones_heap\":" + std::to_string(instrumentacion.insercionesHeap.load()) +
+              ",\"extracciones_heap\":" + std::to_string(instrumentacion.extraccionesHeap.load()) + "}";
+    return salida;
+}
+
+// Vuelca la tabla si se pidió con SIGUSR1 desde el último punto seguro
+void atenderVolcadoPedido() {
+    if (instrumentacion.volcadoPedido.exchange(false, std::memory_order_relaxed)) {
+        volcarInstrumentacion(std::cerr);
+    }
+}
+
+void volcarInstrumentacionAlSalir() {
+    volcarInstrumentacion(std::cerr);
+}
+
+#ifdef __linux__
+void senalVolcarInstrumentacion(int) {
+    instrumentacion.volcadoPedido = true;
+}
+#endif
+
+// Enciende la instrumentación: la tabla se vuelca al salir y, en Linux, también con kill -USR1
+void activarInstrumentacion() {
+    instrumentacion.activa = true;
+    std::atexit(volcarInstrumentacionAlSalir);
+#ifdef __linux__
+    std::signal(SIGUSR1, senalVolcarInstrumentacion);
+#endif
+}
+
+//-----------------------------------------------------------
+
+// Función para llenar una lista CSR con las aristas agrupadas por la columna "desde" (0 = origen, 1 = destino)
+// Los vecinos de cada nodo quedan ordenados, en el mismo orden en que los recorre la matriz
+void llenarListaCSR(int numNodos, const std::vector<std::array<int, 3>>& aristas, int desde, std::vector<int>& inicio,
+                    std::vector<int>& vecinos, std::vector<int>& metros) {
+    int hacia = 1 - desde;
+    inicio.assign(numNodos + 1, 0);
+    for (const auto& arista : aristas) {
+        ++inicio[arista[desde] + 1];
+    }
+    for (int u = 0; u < numNodos; ++u) {
+        inicio[u + 1] += inicio[u];
+    }
+    vecinos.resize(aristas.size());
+    metros.resize(aristas.size());
+    std::vector<int> siguiente(inicio.begin(), inicio.end() - 1);
+    for (const auto& arista : aristas) {
+        int posicion = siguiente[arista[desde]]++;
+        vecinos[posicion] = arista[hacia];
+        metros[posicion] = arista[2];
+    }
+    std::vector<std::pair<int, int>> vecinosDeNodo;
+    for (int u = 0; u < numNodos; ++u) {
+        if (std::is_sorted(vecinos.begin() + inicio[u], vecinos.begin() + inicio[u + 1])) continue;
+        vecinosDeNodo.clear();
+        for (int k = inicio[u]; k < inicio[u + 1]; ++k) vecinosDeNodo.push_back({vecinos[k], metros[k]});
+        std::sort(vecinosDeNodo.begin(), vecinosDeNodo.end());
+        for (int k = inicio[u]; k < inicio[u + 1]; ++k) {
+            vecinos[k] = vecinosDeNodo[k - inicio[u]].first;
+            metros[k] = vecinosDeNodo[k - inicio[u]].second;
+        }
+    }
+}
+
+// Función para armar las listas de adyacencia (salientes y entrantes) a partir de aristas (origen, destino, metros)
+// con índices desde 0
+void adyacenciaDesdeAristas(Grafo& grafo, int numNodos, const std::vector<std::array<int, 3>>& aristas) {
+    grafo.numNodos = numNodos;
+    llenarListaCSR(numNodos, aristas, 0, grafo.inicioVecinos, grafo.vecinos, grafo.metros);
+    llenarListaCSR(numNodos, aristas, 1, grafo.inicioEntrantes, grafo.entrantes, grafo.metrosEntrantes);
+}
+
+// Función para armar la lista de adyacencia desde la matriz (un peso 0 significa que no hay camino)
+bool construirAdyacencia(Grafo& grafo) {
+    const auto& matriz = grafo.matrizAdyacencia;
+    for (const auto& fila : matriz) {
+        if (fila.size() != matriz.size()) return false;
+    }
+    std::vector<std::array<int, 3>> aristas;
+    for (std::size_t u = 0; u < matriz.size(); ++u) {
+        for (std::size_t v = 0; v < matriz.size(); ++v) {
+            if (matriz[u][v] > 0) {
+                aristas.push_back({static_cast<int>(u), static_cast<int>(v), matriz[u][v]});
+            }
+        }
+    }
+    adyacenciaDesdeAristas(grafo, static_cast<int>(matriz.size()), aristas);
+    return true;
+}
+
+// Función para leer el grafo como lista de aristas: encabezado "origen,destino,metros" y una línea por camino
+// Los identificadores son los de atracciones.json y los caminos son de doble sentido
+void leerListaAristas(Grafo& grafo, std::ifstream& archivo, const std::string& archivoCSV) {
+    std::vector<std::array<int, 3>> aristas;
+    int numNodos = 0;
+    std::string linea;
+    std::getline(archivo, linea); // Encabezado
+    long long fila_numero = 1;
+    while (std::getline(archivo, linea)) {
+        ++fila_numero;
+        if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+        if (linea.empty()) continue;
+        int valores[3];
+        const char* cursor = linea.data();
+        const char* fin = linea.data() + linea.size();
+        for (int k = 0; k < 3; ++k) {
+            auto leido = std::from_chars(cursor, fin, valores[k]);
+            if (leido.ec != std::errc() || (k < 2 && (leido.ptr == fin || *leido.ptr != ','))) {
+                std::cerr << "Error: Valor inválido en el archivo " << archivoCSV << " en la fila " << fila_numero
+                          << ", columna " << k + 1 << ". No es un entero." << std::endl;
+                return;
+            }
+            cursor = leido.ptr + (k < 2 ? 1 : 0);
+        }
+        if (valores[0] < 1 || valores[1] < 1 || valores[2] <= 0) {
+            std::cerr << "Error: Camino inválido en el archivo " << archivoCSV << " en la fila " << fila_numero
+                      << " (identificadores desde 1 y metros mayores que 0)." << std::endl;
+            return;
+        }
+        aristas.push_back({valores[0] - 1, valores[1] - 1, valores[2]});
+        aristas.push_back({valores[1] - 1, valores[0] - 1, valores[2]});
+        numNodos = std::max(numNodos, std::max(valores[0], valores[1]));
+    }
+    if (aristas.empty()) {
+        std::cerr << "Error: El archivo " << archivoCSV << " no tiene caminos." << std::endl;
+        return;
+    }
+    adyacenciaDesdeAristas(grafo, numNodos, aristas);
+}
+
 // Función para construir el Grafo 
 void construirGrafo(Grafo& grafo, const std::string& archivoCSV) {
+    CronometroEtapa cronometro(ETAPA_CARGA_GRAFO);
     std::ifstream archivo(archivoCSV);
     if (!archivo.is_open()) {
         std::cerr << "Error: No se pudo abrir el archivo " << archivoCSV << std::endl;
@@ -44,6 +709,12 @@ void construirGrafo(Grafo& grafo, const std::string& archivoCSV) {
         return;
     }
 
+    // Un encabezado de texto indica el formato de lista de aristas
+    if (!std::isdigit(archivo.peek()) && archivo.peek() != '-') {
+        leerListaAristas(grafo, archivo, archivoCSV);
+        return;
+    }
+
     std::string linea;
     int fila_numero = 0;
     while (std::getline(archivo, linea)) {
@@ -77,14 +748,133 @@ void construirGrafo(Grafo& grafo, const std::string& archivoCSV) {
             return;
         }
     }
+    if (!construirAdyacencia(grafo)) {
+        std::cerr << "Error: La matriz del archivo " << archivoCSV << " no es cuadrada." << std::endl;
+        return;
+    }
 
     //std::cout << "Grafo construido con éxito desde el archivo " << archivoCSV << "." << std::endl;
 }
 
 //-----------------------------------------------------------
 
+// Preproceso de la búsqueda ALT (A*, marcas y desigualdad triangular)
+// Se eligen marcas alejadas entre sí y se guardan las distancias en metros de cada marca a todos los nodos
+// (y de todos los nodos a cada marca si el grafo no es simétrico). Las tablas se calculan en paralelo.
+
+// Función para calcular las distancias en metros desde origen, por las aristas salientes o, haciaAtras, por las entrantes
+void metrosDesde(const Grafo& grafo, int origen, bool haciaAtras, std::vector<int>& distancia) {
+    const std::vector<int>& inicioLista = haciaAtras ? grafo.inicioEntrantes : grafo.inicioVecinos;
+    const std::vector<int>& lista = haciaAtras ? grafo.entrantes : grafo.vecinos;
+    const std::vector<int>& metros = haciaAtras ? grafo.metrosEntrantes : grafo.metros;
+    distancia.assign(grafo.numNodos, std::numeric_limits<int>::max());
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> pq;
+    distancia[origen] = 0;
+    pq.push({0, origen});
+    while (!pq.empty()) {
+        int d = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+        if (d > distancia[u]) continue;
+        for (int k = inicioLista[u]; k < inicioLista[u + 1]; ++k) {
+            int v = lista[k];
+            if (d + metros[k] < distancia[v]) {
+                distancia[v] = d + metros[k];
+                pq.push({distancia[v], v});
+            }
+        }
+    }
+}
+
+bool grafoSimetrico(const Grafo& grafo) {
+    return grafo.inicioVecinos == grafo.inicioEntrantes && grafo.vecinos == grafo.entrantes && grafo.metros == grafo.metrosEntrantes;
+}
+
+// Función para elegir marcas alejadas: cada marca nueva es el nodo con más saltos hasta las ya elegidas
+// Se cuentan saltos (BFS) en lugar de metros porque es mucho más barato y en un parque dan la misma idea de lejanía
+std::vector<int> elegirMarcas(const Grafo& grafo, int numMarcas) {
+    std::vector<int> marcas;
+    std::vector<int> saltos(grafo.numNodos, std::numeric_limits<int>::max());
+    std::vector<int> cola;
+    int siguiente = 0;
+    while (static_cast<int>(marcas.size()) < numMarcas) {
+        // BFS desde el último nodo agregado; saltos guarda la distancia al conjunto (la primera vez, al nodo 0)
+        cola.assign(1, siguiente);
+        saltos[siguiente] = 0;
+        for (std::size_t i = 0; i < cola.size(); ++i) {
+            int u = cola[i];
+            for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+                int v = grafo.vecinos[k];
+                if (saltos[u] + 1 < saltos[v]) {
+                    saltos[v] = saltos[u] + 1;
+                    cola.push_back(v);
+                }
+            }
+        }
+        int masLejano = 0;
+        for (int v = 1; v < grafo.numNodos; ++v) {
+            if (saltos[v] != std::numeric_limits<int>::max() && saltos[v] > saltos[masLejano]) masLejano = v;
+        }
+        if (saltos[masLejano] == 0) break; // No quedan nodos alcanzables sin marca
+        marcas.push_back(masLejano);
+        siguiente = masLejano;
+    }
+    return marcas;
+}
+
+// Función para calcular las marcas y sus tablas con numHilos hilos (cada hilo toma la siguiente búsqueda libre)
+void calcularMarcas(Grafo& grafo, int numMarcas, unsigned numHilos) {
+    if (grafo.numNodos == 0 || numMarcas <= 0) return;
+    CronometroEtapa cronometro(ETAPA_CARGA_MARCAS);
+    grafo.marcas = elegirMarcas(grafo, std::min(numMarcas, grafo.numNodos));
+    int k = static_cast<int>(grafo.marcas.size());
+    grafo.numMarcas = k;
+    bool simetrico = grafoSimetrico(grafo);
+    grafo.metrosDesdeMarca.assign(static_cast<std::size_t>(grafo.numNodos) * k, 0);
+    grafo.metrosHaciaMarca.assign(simetrico ? 0 : static_cast<std::size_t>(grafo.numNodos) * k, 0);
+
+    int busquedas = simetrico ? k : 2 * k;
+    std::atomic<int> siguiente{0};
+    auto trabajar = [&]() {
+        std::vector<int> distancia;
+        for (int b = siguiente++; b < busquedas; b = siguiente++) {
+            bool haciaAtras = b >= k;
+            int i = b % k;
+            // Hacia la marca = desde la marca por las aristas entrantes
+            metrosDesde(grafo, grafo.marcas[i], haciaAtras, distancia);
+            std::vector<int>& tabla = haciaAtras ? grafo.metrosHaciaMarca : grafo.metrosDesdeMarca;
+            for (int v = 0; v < grafo.numNodos; ++v) {
+                tabla[static_cast<std::size_t>(v) * k + i] = distancia[v];
+            }
+        }
+    };
+    std::vector<std::thread> hilos;
+    for (unsigned h = 1; h < std::min<unsigned>(numHilos, busquedas); ++h) {
+        hilos.emplace_back(trabajar);
+    }
+    trabajar();
+    for (auto& hilo : hilos) hilo.join();
+}
+
+//-----------------------------------------------------------
+
 // Función para construir el Árbol de Decisiones 
-Nodo* construirArbol(const json& j) {
+// Memoria aproximada que ocupa un nodo con sus cadenas y listas
+std::size_t bytesNodo(const Nodo* nodo) {
+    return sizeof(Nodo) + nodo->pregunta.capacity() + nodo->identificadores.capacity() * sizeof(int);
+}
+
+// Los hijos ya están internados, así que basta comparar sus direcciones
+std::string claveNodo(const Nodo* nodo) {
+    std::string clave = nodo->pregunta;
+    clave.push_back('\0');
+    clave.append(reinterpret_cast<const char*>(&nodo->izquierda), sizeof(Nodo*));
+    clave.append(reinterpret_cast<const char*>(&nodo->derecha), sizeof(Nodo*));
+    clave.append(reinterpret_cast<const char*>(nodo->identificadores.data()), nodo->identificadores.size() * sizeof(int));
+    return clave;
+}
+
+Nodo* construirArbol(const json& j, TablaNodos& tabla) {
     Nodo* nodo = new Nodo();
 
     // Verificar pregunta
@@ -97,13 +887,13 @@ Nodo* construirArbol(const json& j) {
 
 // Verificar izquierda
     if (j.contains("izquierda") && j["izquierda"].is_object()) {
-        nodo->izquierda = construirArbol(j["izquierda"]);
+        nodo->izquierda = construirArbol(j["izquierda"], tabla);
     } else {
         nodo->izquierda = nullptr;
     }
 // Verificar derecho 
     if (j.contains("derecha") && j["derecha"].is_object()) {
-        nodo->derecha = construirArbol(j["derecha"]);
+        nodo->derecha = construirArbol(j["derecha"], tabla);
     } else {
         nodo->derecha = nullptr;
     }
@@ -114,13 +904,29 @@ Nodo* construirArbol(const json& j) {
         nodo->identificadores = {}; 
     }
 
+// Reutilizar un nodo idéntico si ya existe
+    std::size_t bytes = bytesNodo(nodo);
+    ++tabla.nodosLeidos;
+    tabla.bytesLeidos += bytes;
+    auto insercion = tabla.unicos.emplace(claveNodo(nodo), nodo);
+    if (!insercion.second) {
+        delete nodo;
+        return insercion.first->second;
+    }
+    tabla.bytesUnicos += bytes;
     return nodo;
 }
 
+Nodo* construirArbol(const json& j) {
+    TablaNodos tabla;
+    return construirArbol(j, tabla);
+}
+
 //-----------------------------------------------------------
 
 // Función para leer el Árbol de Decisiones 
 Nodo* leerArbolDecisiones(const std::string& archivoJSON) {
+    CronometroEtapa cronometro(ETAPA_CARGA_ARBOL);
     // Intentamos abrir el archivo
     std::ifstream archivo(archivoJSON);
     if (!archivo.is_open()) {
@@ -141,8 +947,14 @@ Nodo* leerArbolDecisiones(const std::string& archivoJSON) {
             std::cerr << "Error: El archivo " << archivoJSON << " contiene JSON inválido o vacío." << std::endl;
             return nullptr;
         }
-// Construimos el árbol a partir del JSON
-        return construirArbol(j);
+// Construimos el árbol a partir del JSON, compartiendo los subárboles repetidos
+        TablaNodos tabla;
+        Nodo* raiz = construirArbol(j, tabla);
+        if (tabla.unicos.size() < tabla.nodosLeidos) {
+            std::cerr << "Arbol de decisiones: " << tabla.nodosLeidos << " nodos leidos, " << tabla.unicos.size()
+                      << " unicos (" << tabla.bytesUnicos << " bytes en lugar de " << tabla.bytesLeidos << ")." << std::endl;
+        }
+        return raiz;
 
     } catch (const json::parse_error& e) {
         // Capturamos errores de parseo del JSON y mostramos un mensaje de error detallado
@@ -154,12 +966,31 @@ Nodo* leerArbolDecisiones(const std::string& archivoJSON) {
         return nullptr;
     }
 }
+// Función para recolectar los nodos distintos del árbol (cada nodo compartido una sola vez)
+void recolectarNodos(Nodo* nodo, std::unordered_set<Nodo*>& nodos) {
+    if (!nodo || !nodos.insert(nodo).second) return;
+    recolectarNodos(nodo->izquierda, nodos);
+    recolectarNodos(nodo->derecha, nodos);
+}
+
+// Función para convertir las listas de las hojas en bitsets sobre el vector de atracciones
+void indexarHojas(Nodo* nodo, const std::vector<Atraccion>& atracciones) {
+    std::unordered_set<Nodo*> nodos;
+    recolectarNodos(nodo, nodos);
+    std::unordered_map<int, std::size_t> indice = indicePorIdentificador(atracciones);
+    for (Nodo* actual : nodos) {
+        if (!actual->izquierda && !actual->derecha) {
+            actual->conjunto = conjuntoDesdeIdentificadores(actual->identificadores, indice, atracciones.size());
+        }
+    }
+}
+
 // Función auxiliar para liberar la memoria del árbol de decisiones
 void liberarArbol(Nodo* nodo) {
-    if (nodo) {
-        liberarArbol(nodo->izquierda);
-        liberarArbol(nodo->derecha);
-        delete nodo;
+    std::unordered_set<Nodo*> nodos;
+    recolectarNodos(nodo, nodos);
+    for (Nodo* actual : nodos) {
+        delete actual;
     }
 }
 
@@ -168,6 +999,7 @@ void liberarArbol(Nodo* nodo) {
 // Función para leer Atracciones
 
 std::vector<Atraccion> leerAtracciones(const std::string& archivoJSON) {
+    CronometroEtapa cronometro(ETAPA_CARGA_ATRACCIONES);
     std::vector<Atraccion> atracciones;
     std::ifstream archivo(archivoJSON);
     if (!archivo.is_open()) {
@@ -192,6 +1024,12 @@ std::vector<Atraccion> leerAtracciones(const std::string& archivoJSON) {
             atraccion.identificador = entrada["identificador"];
             atraccion.tiempo_espera = entrada["tiempo_espera"];
             atraccion.nombre = entrada["nombre"];
+            if (entrada.contains("abierta")) {
+                atraccion.abierta = entrada["abierta"];
+            }
+            if (entrada.contains("accesible")) {
+                atraccion.accesible = entrada["accesible"];
+            }
             atracciones.push_back(atraccion);
         }
     } catch (const json::parse_error& e) {
@@ -203,30 +1041,84 @@ std::vector<Atraccion> leerAtracciones(const std::string& archivoJSON) {
 
 //--------------------------------------------------------
 
-// Función editarTiempoEspera
-void editarTiempoEspera(std::vector<Atraccion>& atracciones) {
-    std::cout << "Ingrese el identificador de la atraccion a editar: ";
-    int identificador;
-    std::cin >> identificador;
-    
-    std::cout << "Ingrese el nuevo tiempo de espera: ";
-    int nuevoTiempo;
-    std::cin >> nuevoTiempo;
-    
+// Función para cambiar el tiempo de espera de una atracción; devuelve false si no existe
+bool actualizarTiempoEspera(std::vector<Atraccion>& atracciones, int identificador, int nuevoTiempo) {
     for (auto& atraccion : atracciones) {
         if (atraccion.identificador == identificador) {
             atraccion.tiempo_espera = nuevoTiempo;
-            std::cout << "Tiempo de espera actualizado.\n";
-            return;
+            return true;
         }
     }
-    std::cout << "Identificador de atraccion no encontrado.\n";
+    return false;
+}
+
+const int MAX_TIEMPO_ESPERA = 24 * 60; // Minutos
+
+// Función editarTiempoEspera
+// Solo lee y valida la edición; quien llama la aplica sobre una copia del modelo, así no se espera al usuario
+// con mutexEdicionModelo tomado. Devuelve false si la entrada no es válida.
+bool editarTiempoEspera(const std::vector<Atraccion>& atracciones, int& identificador, int& nuevoTiempo) {
+    auto leerEntero = [](int& valor) {
+        if (std::cin >> valor) return true;
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return false;
+    };
+    std::cout << "Ingrese el identificador de la atraccion a editar: ";
+    if (!leerEntero(identificador)) {
+        std::cout << "Identificador no valido.\n";
+        return false;
+    }
+    bool existe = false;
+    for (const auto& atraccion : atracciones) {
+        existe |= atraccion.identificador == identificador;
+    }
+    if (!existe) {
+        std::cout << "Identificador de atraccion no encontrado.\n";
+        return false;
+    }
+
+    std::cout << "Ingrese el nuevo tiempo de espera: ";
+    if (!leerEntero(nuevoTiempo) || nuevoTiempo < 0 || nuevoTiempo > MAX_TIEMPO_ESPERA) {
+        std::cout << "Tiempo de espera no valido (0 a " << MAX_TIEMPO_ESPERA << " minutos).\n";
+        return false;
+    }
+    return true;
 }
 
 //--------------------------------------------------------
 
+// Escrituras propias de archivos del parque: fecha de modificación y tamaño que dejó la última,
+// para que la recarga en caliente no vuelva a cargar lo que el programa acaba de guardar
+struct EscrituraPropia {
+    std::filesystem::file_time_type fecha;
+    std::uintmax_t tamano;
+};
+std::mutex mutexEscriturasPropias;
+std::unordered_map<std::string, EscrituraPropia> escriturasPropias;
+
+void registrarEscrituraPropia(const std::string& ruta) {
+    std::error_code error;
+    EscrituraPropia escritura{std::filesystem::last_write_time(ruta, error), std::filesystem::file_size(ruta, error)};
+    if (error) return;
+    std::lock_guard<std::mutex> bloqueo(mutexEscriturasPropias);
+    escriturasPropias[ruta] = escritura;
+}
+
+// true si el archivo sigue tal como lo dejó nuestra última escritura
+bool esEscrituraPropia(const std::string& ruta) {
+    std::error_code error;
+    auto fecha = std::filesystem::last_write_time(ruta, error);
+    auto tamano = std::filesystem::file_size(ruta, error);
+    if (error) return false;
+    std::lock_guard<std::mutex> bloqueo(mutexEscriturasPropias);
+    auto it = escriturasPropias.find(ruta);
+    return it != escriturasPropias.end() && it->second.fecha == fecha && it->second.tamano == tamano;
+}
+
 // Función guardarTiempoEspera
 void guardarTiempoEspera(const std::string& archivoJSON, const std::vector<Atraccion>& atracciones) {
+    CronometroEtapa cronometro(ETAPA_PERSISTENCIA);
     std::ofstream archivo(archivoJSON);
     if (!archivo.is_open()) {
         std::cerr << "Error: No se pudo abrir el archivo " << archivoJSON << " para escribir." << std::endl;
@@ -238,243 +1130,4791 @@ void guardarTiempoEspera(const std::string& archivoJSON, const std::vector<Atrac
         j.push_back({
             {"identificador", atraccion.identificador},
             {"nombre", atraccion.nombre},
-            {"tiempo_espera", atraccion.tiempo_espera}
+            {"tiempo_espera", atraccion.tiempo_espera},
+            {"abierta", atraccion.abierta},
+            {"accesible", atraccion.accesible}
         });
     }
     archivo << j.dump(4);
+    archivo.close();
+    registrarEscrituraPropia(archivoJSON);
 }
-//-----------------------------------------------------------
 
-// Función para realizar el algoritmo de Dijkstra 
-std::pair<std::vector<int>, std::vector<int>> dijkstra(const Grafo& grafo, int inicio, const std::vector<int>& seleccionadas, const std::vector<Atraccion>& atracciones) {
-    int n = grafo.matrizAdyacencia.size();
-    std::vector<int> distancia(n, std::numeric_limits<int>::max());
-    std::vector<int> previo(n, -1);
+//--------------------------------------------------------
+
+// Función para leer los perfiles de espera (CSV identificador,minuto,espera); nullptr si el archivo no existe
+// Al cargar se corrige cada perfil para que llegar más tarde nunca deje terminar antes: la espera no puede bajar
+// más rápido que el tiempo que pasa (siempre se puede esperar afuera de la fila)
+std::shared_ptr<const PerfilesEspera> leerPerfilesEspera(const std::string& archivoCSV, const std::vector<Atraccion>& atracciones) {
+    std::ifstream archivo(archivoCSV);
+    if (!archivo.is_open()) {
+        return nullptr;
+    }
+    CronometroEtapa cronometro(ETAPA_CARGA_ATRACCIONES);
+    auto indice = indicePorIdentificador(atracciones);
+    std::vector<std::array<int, 3>> filas; // (posición de la atracción, minuto, espera)
+    std::string linea;
+    std::getline(archivo, linea); // Encabezado
+    long long fila_numero = 1;
+    while (std::getline(archivo, linea)) {
+        ++fila_numero;
+        if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+        if (linea.empty()) continue;
+        int valores[3];
+        const char* cursor = linea.data();
+        const char* fin = linea.data() + linea.size();
+        for (int k = 0; k < 3; ++k) {
+            auto leido = std::from_chars(cursor, fin, valores[k]);
+            if (leido.ec != std::errc() || (k < 2 && (leido.ptr == fin || *leido.ptr != ','))) {
+                std::cerr << "Error: Valor inválido en el archivo " << archivoCSV << " en la fila " << fila_numero
+                          << ", columna " << k + 1 << ". No es un entero." << std::endl;
+                return nullptr;
+            }
+            cursor = leido.ptr + (k < 2 ? 1 : 0);
+        }
+        auto posicion = indice.find(valores[0]);
+        if (posicion == indice.end()) {
+            std::cerr << "Error: Atracción " << valores[0] << " desconocida en el archivo " << archivoCSV << " en la fila " << fila_numero << "." << std::endl;
+            return nullptr;
+        }
+        if (valores[1] < 0 || valores[1] > 24 * 60 || valores[2] < 0 || valores[2] > 0xffff) {
+            std::cerr << "Error: Punto inválido en el archivo " << archivoCSV << " en la fila " << fila_numero
+                      << " (minuto del día entre 0 y 1440 y espera no negativa)." << std::endl;
+            return nullptr;
+        }
+        filas.push_back({static_cast<int>(posicion->second), valores[1], valores[2]});
+    }
+    std::sort(filas.begin(), filas.end());
+
+    auto perfiles = std::make_shared<PerfilesEspera>();
+    perfiles->inicioPuntos.assign(atracciones.size() + 1, 0);
+    for (std::size_t i = 0; i < filas.size(); ++i) {
+        // Un minuto repetido para la misma atracción se queda con el primer valor
+        if (i > 0 && filas[i][0] == filas[i - 1][0] && filas[i][1] == filas[i - 1][1]) continue;
+        ++perfiles->inicioPuntos[filas[i][0] + 1];
+        perfiles->puntos.push_back({static_cast<std::uint16_t>(filas[i][1]), static_cast<std::uint16_t>(filas[i][2])});
+    }
+    for (std::size_t i = 0; i < atracciones.size(); ++i) {
+        perfiles->inicioPuntos[i + 1] += perfiles->inicioPuntos[i];
+        for (int k = perfiles->inicioPuntos[i + 1] - 2; k >= perfiles->inicioPuntos[i]; --k) {
+            PuntoPerfil& punto = perfiles->puntos[k];
+            const PuntoPerfil& siguiente = perfiles->puntos[k + 1];
+            punto.espera = static_cast<std::uint16_t>(std::min<int>(punto.espera, siguiente.espera + (siguiente.minuto - punto.minuto)));
+        }
+    }
+    return perfiles;
+}
+
+// Espera (en segundos) de la atracción en la posición v para quien llega en el segundo dado del día
+// Sin perfil es el tiempo_espera fijo; antes del primer punto y después del último, la espera de ese punto
+int esperaEnSegundos(const PerfilesEspera* perfiles, const std::vector<Atraccion>& atracciones, int v, int segundo) {
+    if (!perfiles || perfiles->inicioPuntos[v] == perfiles->inicioPuntos[v + 1]) return atracciones[v].tiempo_espera * 60;
+    const PuntoPerfil* primero = perfiles->puntos.data() + perfiles->inicioPuntos[v];
+    const PuntoPerfil* ultimo = perfiles->puntos.data() + perfiles->inicioPuntos[v + 1] - 1;
+    if (segundo <= primero->minuto * 60) return primero->espera * 60;
+    if (segundo >= ultimo->minuto * 60) return ultimo->espera * 60;
+    const PuntoPerfil* siguiente = std::upper_bound(primero, ultimo + 1, segundo, [](int s, const PuntoPerfil& punto) { return s < punto.minuto * 60; });
+    const PuntoPerfil* anterior = siguiente - 1;
+    long long transcurrido = segundo - anterior->minuto * 60;
+    long long tramo = (siguiente->minuto - anterior->minuto) * 60;
+    return anterior->espera * 60 + static_cast<int>((siguiente->espera - anterior->espera) * 60LL * transcurrido / tramo);
+}
+//-----------------------------------------------------------
+
+// Modelo del parque: una versión inmutable de grafo, atracciones y árbol
+// Las consultas toman una copia del shared_ptr y terminan sobre esa versión aunque se publique otra;
+// la versión vieja se libera cuando la suelta la última consulta (estilo RCU)
+
+struct JerarquiaContraccion;
+struct ParticionCRP;
+struct MetricaCRP;
+
+struct ModeloParque {
+    std::shared_ptr<const Grafo> grafo;
+    std::vector<Atraccion> atracciones;
+    std::shared_ptr<Nodo> arbol; // Se comparte entre versiones mientras no cambien decisiones.json ni las posiciones de las atracciones
+    std::shared_ptr<const JerarquiaContraccion> jerarquia; // Solo con --motor ch; nula mientras se reconstruye tras editar esperas
+    std::shared_ptr<const ParticionCRP> particion;         // Solo con --motor crp; se comparte mientras no cambie el grafo
+    std::shared_ptr<const MetricaCRP> metrica;             // Costos por celda de la partición con los tiempos de espera de esta versión
+    std::shared_ptr<const PerfilesEspera> perfiles;        // Esperas por hora del día; nula si no hay archivo de perfiles
+    ConjuntoAtracciones abiertas;   // Máscaras de filtrado de esta versión, calculadas al publicarla
+    ConjuntoAtracciones accesibles;
+    std::uint64_t epoca = 0;     // Cambia con cada versión publicada (recarga o edición de tiempos de espera)
+};
+
+struct ArchivosParque {
+    std::string grafo = "grafo.csv";
+    std::string arbol = "decisiones.json";
+    std::string atracciones = "atracciones.json";
+    std::string perfiles = "perfiles_espera.csv"; // Opcional
+};
+
+std::shared_ptr<const ModeloParque> modeloPublicado;
+std::atomic<std::uint64_t> ultimaEpoca{0};
+std::mutex mutexEdicionModelo; // Serializa a quienes copian, modifican y publican (no lo toman las consultas)
+
+// Obtener la versión vigente del modelo (no bloquea a quien publica)
+std::shared_ptr<const ModeloParque> modeloActual() {
+    return std::atomic_load(&modeloPublicado);
+}
+
+// Publicar una nueva versión con un intercambio atómico del puntero
+// Desde aquí el modelo y su árbol son de solo lectura (salvo las rutas cacheadas de las hojas, que son atómicas)
+void publicarModelo(std::shared_ptr<ModeloParque> modelo) {
+    modelo->abiertas = mascaraAbiertas(modelo->atracciones);
+    modelo->accesibles = mascaraAccesibles(modelo->atracciones);
+    modelo->epoca = ++ultimaEpoca;
+    std::atomic_store(&modeloPublicado, std::shared_ptr<const ModeloParque>(std::move(modelo)));
+}
+
+// Funciones de carga de cada parte del modelo
+
+// Marcas ALT que se calculan al cargar el grafo (0 o menos = ninguna; con --motor alt y sin --marcas se usa MARCAS_POR_DEFECTO)
+const int MARCAS_POR_DEFECTO = 16;
+int marcasAlCargar = -1;
+
+// Jerarquía de contracción del modelo (--motor ch); con --jerarquia archivo se guarda y se reutiliza entre arranques
+bool jerarquiaAlCargar = false;
+std::string archivoJerarquia;
+std::shared_ptr<const JerarquiaContraccion> prepararJerarquia(const Grafo& grafo, const std::vector<Atraccion>& atracciones);
+void pedirJerarquia();
+
+// Partición y métrica CRP del modelo (--motor crp); al editar esperas solo se vuelven a personalizar las celdas afectadas
+bool crpAlCargar = false;
+void prepararCRP(ModeloParque& modelo, const ModeloParque* anterior);
+
+std::shared_ptr<const Grafo> cargarGrafo(const std::string& archivoCSV) {
+    auto grafo = std::make_shared<Grafo>();
+    construirGrafo(*grafo, archivoCSV);
+    calcularMarcas(*grafo, marcasAlCargar, std::max(1u, std::thread::hardware_concurrency()));
+    return grafo;
+}
+
+std::shared_ptr<Nodo> cargarArbol(const std::string& archivoJSON, const std::vector<Atraccion>& atracciones) {
+#ifdef ARBOL_COMPILADO
+    // El árbol ya viene compilado; no hace falta parsear decisiones.json
+    (void)archivoJSON;
+    (void)atracciones;
+    return nullptr;
+#else
+    std::shared_ptr<Nodo> arbol(leerArbolDecisiones(archivoJSON), liberarArbol);
+    indexarHojas(arbol.get(), atracciones);
+    return arbol;
+#endif
+}
+
+std::shared_ptr<ModeloParque> cargarModelo(const ArchivosParque& archivos) {
+    auto modelo = std::make_shared<ModeloParque>();
+    modelo->grafo = cargarGrafo(archivos.grafo);
+    modelo->atracciones = leerAtracciones(archivos.atracciones);
+    modelo->perfiles = leerPerfilesEspera(archivos.perfiles, modelo->atracciones);
+    modelo->arbol = cargarArbol(archivos.arbol, modelo->atracciones);
+    if (jerarquiaAlCargar) {
+        modelo->jerarquia = prepararJerarquia(*modelo->grafo, modelo->atracciones);
+    }
+    prepararCRP(*modelo, nullptr);
+    return modelo;
+}
+
+// Una recarga solo se publica si los archivos nuevos son coherentes; si no, se conserva la versión anterior
+bool modeloValido(const ModeloParque& modelo) {
+    int numNodos = modelo.grafo->numNodos;
+    if (numNodos == 0) return false;
+    if (modelo.atracciones.size() < static_cast<std::size_t>(numNodos)) return false;
+#ifndef ARBOL_COMPILADO
+    if (!modelo.arbol) return false;
+#endif
+    return true;
+}
+
+//-----------------------------------------------------------
+
+// Recarga en caliente de los archivos del parque
+// Un hilo vigila los archivos (inotify en Linux, fecha de modificación en otros sistemas),
+// construye la versión nueva en segundo plano y la publica con publicarModelo
+
+struct RecargaParque {
+    ArchivosParque archivos;
+    std::atomic<bool> detener{false};
+    std::thread hilo;
+};
+
+// Reconstruye solo las partes que cambiaron y comparte el resto con la versión vigente
+void recargarModelo(const ArchivosParque& archivos, bool cambioGrafo, bool cambioArbol, bool cambioAtracciones, bool cambioPerfiles) {
+    std::lock_guard<std::mutex> bloqueo(mutexEdicionModelo);
+    // Las esperas editadas desde el menú o /espera ya están publicadas; el aviso de su escritura se ignora
+    if (cambioAtracciones && esEscrituraPropia(archivos.atracciones)) {
+        cambioAtracciones = false;
+        if (!cambioGrafo && !cambioArbol && !cambioPerfiles) return;
+    }
+    auto actual = modeloActual();
+    auto nuevo = std::make_shared<ModeloParque>(*actual);
+    if (cambioGrafo) {
+        nuevo->grafo = cargarGrafo(archivos.grafo);
+    }
+    // Si solo cambiaron datos de las atracciones (esperas, abierta, ...) y no cuáles hay ni en qué posición,
+    // el árbol se conserva; sus rutas en caché se descartan al usarlas si cambió el grafo o las esperas
+    bool cambioPosiciones = false;
+    if (cambioAtracciones) {
+        nuevo->atracciones = leerAtracciones(archivos.atracciones);
+        cambioPosiciones = nuevo->atracciones.size() != actual->atracciones.size();
+        for (std::size_t i = 0; !cambioPosiciones && i < nuevo->atracciones.size(); ++i) {
+            cambioPosiciones = nuevo->atracciones[i].identificador != actual->atracciones[i].identificador;
+        }
+    }
+    // Los perfiles se guardan por posición de atracción
+    if (cambioPerfiles || cambioAtracciones) {
+        nuevo->perfiles = leerPerfilesEspera(archivos.perfiles, nuevo->atracciones);
+    }
+    // Los bitsets de las hojas dependen de las posiciones de las atracciones, así que entonces el árbol se vuelve a cargar
+    if (cambioArbol || cambioPosiciones) {
+        nuevo->arbol = cargarArbol(archivos.arbol, nuevo->atracciones);
+    }
+    // La jerarquía se reconstruye en segundo plano, como al editar una espera, para no retener mutexEdicionModelo
+    bool pedirNuevaJerarquia = jerarquiaAlCargar && (cambioGrafo || cambioAtracciones);
+    if (pedirNuevaJerarquia) {
+        nuevo->jerarquia = nullptr;
+    }
+    if (cambioGrafo || cambioAtracciones) {
+        prepararCRP(*nuevo, actual.get());
+    }
+
+    if (!modeloValido(*nuevo)) {
+        std::cerr << "Error: Los archivos del parque modificados no son validos; se conserva la version anterior." << std::endl;
+        return;
+    }
+    publicarModelo(nuevo);
+    if (pedirNuevaJerarquia) pedirJerarquia();
+    std::cout << "\n[Datos del parque recargados]" << std::endl;
+}
+
+std::string nombreArchivo(const std::string& ruta) {
+    return std::filesystem::path(ruta).filename().string();
+}
+
+std::string carpetaArchivo(const std::string& ruta) {
+    std::string carpeta = std::filesystem::path(ruta).parent_path().string();
+    return carpeta.empty() ? "." : carpeta;
+}
+
+void vigilarArchivos(RecargaParque& recarga) {
+    nombrarHiloTraza("recarga");
+    const ArchivosParque& archivos = recarga.archivos;
+    // Se espera a que los cambios se calmen antes de recargar (los editores suelen escribir varias veces)
+    const auto pausa = std::chrono::milliseconds(200);
+    bool cambioGrafo = false, cambioArbol = false, cambioAtracciones = false, cambioPerfiles = false;
+    auto ultimoCambio = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Error: No se pudo iniciar la recarga en caliente (inotify)." << std::endl;
+        return;
+    }
+    std::unordered_set<std::string> carpetas = {carpetaArchivo(archivos.grafo), carpetaArchivo(archivos.arbol), carpetaArchivo(archivos.atracciones),
+                                                carpetaArchivo(archivos.perfiles)};
+    for (const auto& carpeta : carpetas) {
+        inotify_add_watch(fd, carpeta.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+    while (!recarga.detener) {
+        pollfd espera = {fd, POLLIN, 0};
+        if (poll(&espera, 1, static_cast<int>(pausa.count())) > 0) {
+            ssize_t leidos;
+            while ((leidos = read(fd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + leidos;) {
+                    const inotify_event* evento = reinterpret_cast<const inotify_event*>(p);
+                    if (evento->len > 0) {
+                        std::string nombre = evento->name;
+                        cambioGrafo |= nombre == nombreArchivo(archivos.grafo);
+                        cambioArbol |= nombre == nombreArchivo(archivos.arbol);
+                        cambioAtracciones |= nombre == nombreArchivo(archivos.atracciones);
+                        cambioPerfiles |= nombre == nombreArchivo(archivos.perfiles);
+                    }
+                    p += sizeof(inotify_event) + evento->len;
+                }
+                ultimoCambio = std::chrono::steady_clock::now();
+            }
+        }
+        if ((cambioGrafo || cambioArbol || cambioAtracciones || cambioPerfiles) && std::chrono::steady_clock::now() - ultimoCambio >= pausa) {
+            recargarModelo(archivos, cambioGrafo, cambioArbol, cambioAtracciones, cambioPerfiles);
+            cambioGrafo = cambioArbol = cambioAtracciones = cambioPerfiles = false;
+        }
+    }
+    close(fd);
+#else
+    auto fecha = [](const std::string& ruta) {
+        std::error_code error;
+        return std::filesystem::last_write_time(ruta, error);
+    };
+    auto fechaGrafo = fecha(archivos.grafo), fechaArbol = fecha(archivos.arbol), fechaAtracciones = fecha(archivos.atracciones);
+    auto fechaPerfiles = fecha(archivos.perfiles);
+    while (!recarga.detener) {
+        std::this_thread::sleep_for(pausa);
+        auto nuevaGrafo = fecha(archivos.grafo), nuevaArbol = fecha(archivos.arbol), nuevaAtracciones = fecha(archivos.atracciones);
+        auto nuevaPerfiles = fecha(archivos.perfiles);
+        if (nuevaGrafo != fechaGrafo || nuevaArbol != fechaArbol || nuevaAtracciones != fechaAtracciones || nuevaPerfiles != fechaPerfiles) {
+            cambioGrafo |= nuevaGrafo != fechaGrafo;
+            cambioArbol |= nuevaArbol != fechaArbol;
+            cambioAtracciones |= nuevaAtracciones != fechaAtracciones;
+            cambioPerfiles |= nuevaPerfiles != fechaPerfiles;
+            fechaGrafo = nuevaGrafo, fechaArbol = nuevaArbol, fechaAtracciones = nuevaAtracciones, fechaPerfiles = nuevaPerfiles;
+            ultimoCambio = std::chrono::steady_clock::now();
+        } else if ((cambioGrafo || cambioArbol || cambioAtracciones || cambioPerfiles) && std::chrono::steady_clock::now() - ultimoCambio >= pausa) {
+            recargarModelo(archivos, cambioGrafo, cambioArbol, cambioAtracciones, cambioPerfiles);
+            cambioGrafo = cambioArbol = cambioAtracciones = cambioPerfiles = false;
+        }
+    }
+#endif
+}
+
+void iniciarRecarga(RecargaParque& recarga, const ArchivosParque& archivos) {
+    recarga.archivos = archivos;
+    recarga.detener = false;
+    recarga.hilo = std::thread(vigilarArchivos, std::ref(recarga));
+}
+
+void detenerRecarga(RecargaParque& recarga) {
+    recarga.detener = true;
+    if (recarga.hilo.joinable()) {
+        recarga.hilo.join();
+    }
+}
+
+//-----------------------------------------------------------
+
+// Planificador de tareas con robo de trabajo
+// Cada hilo tiene su propia cola doble: toma sus tareas por el final (la más reciente, aún caliente en caché)
+// y, si se queda sin trabajo, roba por el frente de la cola de otro hilo. Así una consulta cara
+// (un recorrido de "todos") no bloquea a las baratas que llegaron detrás, y una tarea puede
+// dividirse en subtareas (GrupoTareas) que otros hilos ociosos ejecutan.
+
+struct ColaTrabajador {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tareas;
+};
+
+struct PlanificadorTareas {
+    std::vector<std::unique_ptr<ColaTrabajador>> colas;
+    std::vector<std::thread> hilos;
+    std::atomic<long long> pendientes{0};      // Tareas encoladas que nadie ha tomado
+    std::atomic<unsigned> siguienteCola{0};    // Reparto de las tareas que llegan desde fuera del planificador
+    std::mutex mutexEspera;
+    std::condition_variable hayTareas;
+    bool detener = false;
+};
+
+// Cola propia del hilo actual (-1 si el hilo no es trabajador del planificador)
+thread_local PlanificadorTareas* planificadorDelHilo = nullptr;
+thread_local int colaDelHilo = -1;
+
+bool tomarTarea(PlanificadorTareas& planificador, int propia, std::function<void()>& tarea) {
+    int numColas = static_cast<int>(planificador.colas.size());
+    if (propia >= 0) {
+        ColaTrabajador& cola = *planificador.colas[propia];
+        std::lock_guard<std::mutex> bloqueo(cola.mutex);
+        if (!cola.tareas.empty()) {
+            tarea = std::move(cola.tareas.back());
+            cola.tareas.pop_back();
+            planificador.pendientes.fetch_sub(1);
+            return true;
+        }
+    }
+    int desde = propia >= 0 ? propia + 1 : static_cast<int>(planificador.siguienteCola.load(std::memory_order_relaxed));
+    for (int k = 0; k < numColas; ++k) {
+        int victima = (desde + k) % numColas;
+        if (victima == propia) continue;
+        ColaTrabajador& cola = *planificador.colas[victima];
+        std::lock_guard<std::mutex> bloqueo(cola.mutex);
+        if (!cola.tareas.empty()) {
+            tarea = std::move(cola.tareas.front());
+            cola.tareas.pop_front();
+            planificador.pendientes.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void trabajarEnPlanificador(PlanificadorTareas& planificador, int indice) {
+    planificadorDelHilo = &planificador;
+    colaDelHilo = indice;
+    nombrarHiloTraza("trabajador " + std::to_string(indice));
+    while (true) {
+        std::function<void()> tarea;
+        if (tomarTarea(planificador, indice, tarea)) {
+            tarea();
+            continue;
+        }
+        std::unique_lock<std::mutex> bloqueo(planificador.mutexEspera);
+        planificador.hayTareas.wait(bloqueo, [&planificador]() { return planificador.detener || planificador.pendientes.load() > 0; });
+        if (planificador.detener && planificador.pendientes.load() == 0) return;
+    }
+}
+
+void iniciarPlanificador(PlanificadorTareas& planificador, unsigned numHilos) {
+    numHilos = std::max(1u, numHilos);
+    planificador.detener = false;
+    for (unsigned i = 0; i < numHilos; ++i) {
+        planificador.colas.push_back(std::make_unique<ColaTrabajador>());
+    }
+    for (unsigned i = 0; i < numHilos; ++i) {
+        planificador.hilos.emplace_back(trabajarEnPlanificador, std::ref(planificador), static_cast<int>(i));
+    }
+}
+
+// Desde un trabajador la tarea va a su propia cola; desde fuera se reparte entre las colas
+void enviarTarea(PlanificadorTareas& planificador, std::function<void()> tarea) {
+    int cola = planificadorDelHilo == &planificador ? colaDelHilo
+                                                    : static_cast<int>(planificador.siguienteCola.fetch_add(1, std::memory_order_relaxed) % planificador.colas.size());
+    {
+        std::lock_guard<std::mutex> bloqueo(planificador.colas[cola]->mutex);
+        planificador.colas[cola]->tareas.push_back(std::move(tarea));
+    }
+    planificador.pendientes.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> bloqueo(planificador.mutexEspera);
+    }
+    planificador.hayTareas.notify_one();
+}
+
+// Termina las tareas pendientes y espera a los hilos
+void detenerPlanificador(PlanificadorTareas& planificador) {
+    {
+        std::lock_guard<std::mutex> bloqueo(planificador.mutexEspera);
+        planificador.detener = true;
+    }
+    planificador.hayTareas.notify_all();
+    for (auto& hilo : planificador.hilos) {
+        hilo.join();
+    }
+    planificador.hilos.clear();
+    planificador.colas.clear();
+}
+
+// Grupo de subtareas para dividir un trabajo y esperar a que termine (fork/join)
+// El grupo guarda sus propias subtareas y al planificador solo va un aviso por cada una. Quien espera
+// ejecuta únicamente subtareas de su grupo: si tomara una tarea ajena, esta podría quedarse esperando
+// (por ejemplo, una consulta coalescida) algo que está más abajo en la misma pila.
+struct EstadoGrupo {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tareas; // Subtareas que nadie ha empezado
+    std::atomic<int> pendientes{0};           // Subtareas sin terminar
+    std::condition_variable terminado;        // Se avisa cuando pendientes llega a 0
+};
+
+struct GrupoTareas {
+    std::shared_ptr<EstadoGrupo> estado = std::make_shared<EstadoGrupo>();
+};
+
+bool ejecutarSubtarea(EstadoGrupo& estado) {
+    std::function<void()> tarea;
+    {
+        std::lock_guard<std::mutex> bloqueo(estado.mutex);
+        if (estado.tareas.empty()) return false;
+        tarea = std::move(estado.tareas.front());
+        estado.tareas.pop_front();
+    }
+    tarea();
+    if (estado.pendientes.fetch_sub(1) == 1) {
+        // Con el mutex tomado, quien espera no puede perder el aviso entre mirar pendientes y dormirse
+        std::lock_guard<std::mutex> bloqueo(estado.mutex);
+        estado.terminado.notify_all();
+    }
+    return true;
+}
+
+void lanzarEnGrupo(PlanificadorTareas& planificador, GrupoTareas& grupo, std::function<void()> tarea) {
+    grupo.estado->pendientes.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> bloqueo(grupo.estado->mutex);
+        grupo.estado->tareas.push_back(std::move(tarea));
+    }
+    // Si quien espera ya ejecutó la subtarea, el aviso no hace nada
+    enviarTarea(planificador, [estado = grupo.estado]() { ejecutarSubtarea(*estado); });
+}
+
+// Mientras espera, el hilo ejecuta las subtareas del grupo que nadie ha tomado; cuando ya no quedan,
+// se duerme hasta que terminen las que están corriendo en otros hilos
+void esperarGrupo(PlanificadorTareas& planificador, GrupoTareas& grupo) {
+    (void)planificador;
+    EstadoGrupo& estado = *grupo.estado;
+    while (ejecutarSubtarea(estado)) {
+    }
+    std::unique_lock<std::mutex> bloqueo(estado.mutex);
+    estado.terminado.wait(bloqueo, [&estado]() { return estado.pendientes.load() == 0; });
+}
+
+unsigned hilosPorDefecto() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//-----------------------------------------------------------
+
+// Función para calcular las distancias y los predecesores desde inicio hacia todos los nodos
+void dijkstraDesde(const Grafo& grafo, int inicio, const std::vector<Atraccion>& atracciones, std::vector<int>& distancia, std::vector<int>& previo) {
+    CronometroEtapa cronometro(ETAPA_DIJKSTRA);
+    int n = grafo.numNodos;
+    distancia.assign(n, std::numeric_limits<int>::max());
+    previo.assign(n, -1);
     std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> pq;
+    std::uint64_t asentados = 0;
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 1;
+
+    distancia[inicio] = 0;
+    pq.push({0, inicio});
+
+    while (!pq.empty()) {
+        int peso_actual = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+
+        if (peso_actual > distancia[u]) continue;
+        ++asentados;
+        relajadas += grafo.inicioVecinos[u + 1] - grafo.inicioVecinos[u];
+
+        for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            // Sumamos el tiempo de espera de la atracción actual al peso de la ruta
+            int peso_ruta = distancia[u] + grafo.metros[k] + atracciones[v].tiempo_espera;
+            if (peso_ruta < distancia[v]) {
+                distancia[v] = peso_ruta;
+                previo[v] = u;
+                pq.push({peso_ruta, v});
+                ++inserciones;
+            }
+        }
+    }
+    // La cola se vacía por completo, así que cada inserción tuvo su extracción
+    sumarContadoresBusqueda(asentados, relajadas, inserciones, inserciones);
+}
+
+// Función para reconstruir el camino más corto en términos de nodos visitados
+std::vector<int> rutaDesdePrevios(const std::vector<int>& previo, const std::vector<int>& seleccionadas) {
+    CronometroEtapa cronometro(ETAPA_RECONSTRUCCION);
+    std::vector<int> ruta_optima;
+    int destino;
+    for (int atraccion : seleccionadas) {
+        destino = atraccion - 1; 
+        while (destino != -1) {
+            ruta_optima.push_back(destino + 1); 
+            destino = previo[destino];
+        }
+        std::reverse(ruta_optima.begin(), ruta_optima.end());
+    }
+    return ruta_optima;
+}
+
+// Función para realizar el algoritmo de Dijkstra 
+std::pair<std::vector<int>, std::vector<int>> dijkstra(const Grafo& grafo, int inicio, const std::vector<int>& seleccionadas, const std::vector<Atraccion>& atracciones) {
+    std::vector<int> distancia;
+    std::vector<int> previo;
+    dijkstraDesde(grafo, inicio, atracciones, distancia, previo);
+    return {distancia, rutaDesdePrevios(previo, seleccionadas)};
+}
+
+//-------------------------------------------------------------
+
+// Delta-stepping: distancias desde un nodo a todo el parque repartidas entre los hilos del planificador (mismo costo que dijkstra)
+// La cubeta i guarda los nodos con distancia tentativa en [i*delta, (i+1)*delta). Las aristas ligeras (costo <= delta)
+// pueden volver a llenar la cubeta actual, así que se relajan por fases hasta vaciarla; las pesadas solo llegan a cubetas
+// posteriores y se relajan una sola vez, con los nodos que se asentaron en la cubeta. La distancia y el previo de cada
+// nodo van juntos en una palabra atómica, de modo que el previo que queda es el de la distancia final.
+
+const std::size_t MIN_NODOS_FASE_PARALELA = 1024; // Con menos nodos la fase se relaja en el hilo que llama
+const std::size_t MIN_NODOS_TAREA_DELTA = 256;
+
+// Ancho de cubeta por defecto: el costo promedio de una arista (metros más espera del destino)
+int deltaPorDefecto(const Grafo& grafo, const std::vector<Atraccion>& atracciones) {
+    if (grafo.vecinos.empty()) return 1;
+    long long total = 0;
+    for (std::size_t k = 0; k < grafo.vecinos.size(); ++k) {
+        total += grafo.metros[k] + atracciones[grafo.vecinos[k]].tiempo_espera;
+    }
+    return static_cast<int>(std::max(1LL, total / static_cast<long long>(grafo.vecinos.size())));
+}
+
+std::uint64_t empacarEtiqueta(int distancia, int previo) {
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(distancia)) << 32 | static_cast<std::uint32_t>(previo + 1);
+}
+
+// Función para calcular las distancias y los predecesores desde inicio con cubetas de ancho delta
+void deltaStepping(const Grafo& grafo, int inicio, const std::vector<Atraccion>& atracciones, int delta, PlanificadorTareas& planificador,
+                   std::vector<int>& distancia, std::vector<int>& previo) {
+    CronometroEtapa cronometro(ETAPA_DELTA_STEPPING);
+    int n = grafo.numNodos;
+    delta = std::max(1, delta);
+    std::vector<std::atomic<std::uint64_t>> etiqueta(n);
+    for (auto& valor : etiqueta) valor.store(empacarEtiqueta(std::numeric_limits<int>::max(), -1), std::memory_order_relaxed);
+    auto distanciaDe = [&etiqueta](int v) { return static_cast<int>(etiqueta[v].load(std::memory_order_relaxed) >> 32); };
+    std::vector<int> relajadoCon(n, -1); // Distancia con la que el nodo relajó por última vez sus aristas ligeras
+    std::vector<int> cubetaAsentado(n, -1);
+    std::vector<std::vector<int>> cubetas(1, std::vector<int>{inicio});
+    etiqueta[inicio].store(empacarEtiqueta(0, -1), std::memory_order_relaxed);
+
+    // Cada tarea anota (cubeta, nodo) por cada mejora; al terminar la fase se pasan a las cubetas en un solo hilo
+    std::size_t maxTareas = 4 * std::max<std::size_t>(1, planificador.colas.size());
+    std::vector<std::vector<std::pair<std::size_t, int>>> mejoras(maxTareas);
+    std::vector<std::uint64_t> relajadasPorTarea(maxTareas);
+    std::uint64_t asentados = 0;
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 1;
+    std::uint64_t extracciones = 0;
+
+    auto relajarTramo = [&](const std::vector<int>& nodos, std::size_t desde, std::size_t hasta, bool ligeras, std::size_t tarea) {
+        auto& propias = mejoras[tarea];
+        std::uint64_t cuenta = 0;
+        for (std::size_t i = desde; i < hasta; ++i) {
+            int u = nodos[i];
+            int distanciaU = distanciaDe(u);
+            for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+                int v = grafo.vecinos[k];
+                int costo = grafo.metros[k] + atracciones[v].tiempo_espera;
+                if ((costo <= delta) != ligeras) continue;
+                ++cuenta;
+                int nueva = distanciaU + costo;
+                std::uint64_t actual = etiqueta[v].load(std::memory_order_relaxed);
+                while (static_cast<int>(actual >> 32) > nueva) {
+                    if (etiqueta[v].compare_exchange_weak(actual, empacarEtiqueta(nueva, u), std::memory_order_relaxed)) {
+                        propias.push_back({static_cast<std::size_t>(nueva / delta), v});
+                        break;
+                    }
+                }
+            }
+        }
+        relajadasPorTarea[tarea] = cuenta;
+    };
+
+    auto ejecutarFase = [&](const std::vector<int>& nodos, bool ligeras) {
+        std::size_t numTareas = 1;
+        if (nodos.size() >= MIN_NODOS_FASE_PARALELA) {
+            numTareas = std::min(maxTareas, nodos.size() / MIN_NODOS_TAREA_DELTA);
+        }
+        std::size_t porTarea = (nodos.size() + numTareas - 1) / numTareas;
+        if (numTareas == 1) {
+            relajarTramo(nodos, 0, nodos.size(), ligeras, 0);
+        } else {
+            GrupoTareas grupo;
+            for (std::size_t t = 0; t < numTareas; ++t) {
+                lanzarEnGrupo(planificador, grupo, [&, t, porTarea]() {
+                    relajarTramo(nodos, t * porTarea, std::min(nodos.size(), (t + 1) * porTarea), ligeras, t);
+                });
+            }
+            esperarGrupo(planificador, grupo);
+        }
+        for (std::size_t t = 0; t < numTareas; ++t) {
+            relajadas += relajadasPorTarea[t];
+            inserciones += mejoras[t].size();
+            for (const auto& mejora : mejoras[t]) {
+                if (mejora.first >= cubetas.size()) cubetas.resize(mejora.first + 1);
+                cubetas[mejora.first].push_back(mejora.second);
+            }
+            mejoras[t].clear();
+        }
+    };
+
+    std::vector<int> frontera;
+    std::vector<int> asentadosCubeta;
+    for (std::size_t i = 0; i < cubetas.size(); ++i) {
+        while (!cubetas[i].empty()) {
+            frontera.clear();
+            extracciones += cubetas[i].size();
+            for (int v : cubetas[i]) {
+                int distanciaV = distanciaDe(v);
+                if (static_cast<std::size_t>(distanciaV / delta) != i || relajadoCon[v] == distanciaV) continue;
+                relajadoCon[v] = distanciaV;
+                frontera.push_back(v);
+                // Un nodo que bajó de distancia dentro de la cubeta vuelve a la frontera, pero se asienta una vez
+                if (cubetaAsentado[v] != static_cast<int>(i)) {
+                    cubetaAsentado[v] = static_cast<int>(i);
+                    asentadosCubeta.push_back(v);
+                }
+            }
+            cubetas[i].clear();
+            ejecutarFase(frontera, true);
+        }
+        std::vector<int>().swap(cubetas[i]);
+        asentados += asentadosCubeta.size();
+        ejecutarFase(asentadosCubeta, false);
+        asentadosCubeta.clear();
+    }
+    sumarContadoresBusqueda(asentados, relajadas, inserciones, extracciones);
+
+    distancia.resize(n);
+    previo.resize(n);
+    for (int v = 0; v < n; ++v) {
+        std::uint64_t valor = etiqueta[v].load(std::memory_order_relaxed);
+        distancia[v] = static_cast<int>(valor >> 32);
+        previo[v] = static_cast<int>(valor & 0xffffffffu) - 1;
+    }
+}
+
+//-------------------------------------------------------------
+
+// Reparación de distancias ya calculadas cuando cambia un tiempo de espera (al estilo de Ramalingam y Reps)
+// La espera de un nodo x está en el costo de todas las aristas que llegan a x. Si baja, la mejora se propaga desde x
+// con un Dijkstra que solo toca los nodos cuya distancia mejora. Si sube, solo pueden empeorar los nodos del subárbol
+// de x en el árbol de previos: se recalculan desde sus vecinos de afuera del subárbol y con un Dijkstra dentro de él.
+// Las distancias quedan iguales a las de un dijkstraDesde nuevo; entre caminos empatados el previo puede ser otro.
+
+const std::size_t MAX_ESPERAS_REPARADAS = 32; // Con más cambios se calcula todo de nuevo
+
+// Función para reparar distancia y previo (desde inicio) después de cambiar la espera de nodo; atracciones ya tiene la espera nueva
+// Devuelve la cantidad de nodos cuya distancia se recalculó
+std::size_t repararPorCambioDeEspera(const Grafo& grafo, int inicio, const std::vector<Atraccion>& atracciones, int nodo, int esperaAnterior,
+                                     std::vector<int>& distancia, std::vector<int>& previo) {
+    CronometroEtapa cronometro(ETAPA_REPARACION);
+    const int infinito = std::numeric_limits<int>::max();
+    int esperaNueva = atracciones[nodo].tiempo_espera;
+    if (esperaNueva == esperaAnterior || nodo == inicio) return 0;
+
+    typedef std::pair<int, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+    std::uint64_t relajadas = 0;
+    std::size_t tocados = 0;
+    // Mejor arista de entrada de v entre los vecinos con distancia conocida
+    auto mejorEntrada = [&](int v) {
+        bool mejoro = false;
+        for (int k = grafo.inicioEntrantes[v]; k < grafo.inicioEntrantes[v + 1]; ++k) {
+            int u = grafo.entrantes[k];
+            if (distancia[u] == infinito) continue;
+            ++relajadas;
+            int candidata = distancia[u] + grafo.metrosEntrantes[k] + atracciones[v].tiempo_espera;
+            if (candidata < distancia[v]) {
+                distancia[v] = candidata;
+                previo[v] = u;
+                mejoro = true;
+            }
+        }
+        return mejoro;
+    };
+
+    if (esperaNueva < esperaAnterior) {
+        if (mejorEntrada(nodo)) cola.push({distancia[nodo], nodo});
+    } else {
+        if (distancia[nodo] == infinito) return 0;
+        // Los hijos de u en el árbol son sus vecinos v con previo[v] == u
+        std::vector<int> subarbol = {nodo};
+        for (std::size_t i = 0; i < subarbol.size(); ++i) {
+            int u = subarbol[i];
+            for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+                if (previo[grafo.vecinos[k]] == u) subarbol.push_back(grafo.vecinos[k]);
+            }
+        }
+        for (int v : subarbol) {
+            distancia[v] = infinito;
+            previo[v] = -1;
+        }
+        for (int v : subarbol) {
+            if (mejorEntrada(v)) cola.push({distancia[v], v});
+        }
+        tocados = subarbol.size();
+    }
+
+    std::uint64_t asentados = 0;
+    std::uint64_t inserciones = cola.size();
+    std::uint64_t extracciones = 0;
+    while (!cola.empty()) {
+        int distanciaU = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        if (distanciaU > distancia[u]) continue;
+        ++asentados;
+        for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            ++relajadas;
+            int candidata = distanciaU + grafo.metros[k] + atracciones[v].tiempo_espera;
+            if (candidata < distancia[v]) {
+                distancia[v] = candidata;
+                previo[v] = u;
+                cola.push({candidata, v});
+                ++inserciones;
+            }
+        }
+    }
+    sumarContadoresBusqueda(asentados, relajadas, inserciones, extracciones);
+    return std::max<std::size_t>(tocados, asentados);
+}
+
+//-------------------------------------------------------------
+
+// Rutas punto a punto ("de donde estoy a la atracción X"): búsquedas que se detienen al encontrar el destino
+// en lugar de calcular las distancias a todo el parque
+
+struct RutaPuntoAPunto {
+    int distancia = std::numeric_limits<int>::max(); // max si el destino es inalcanzable
+    std::vector<int> ruta;                           // Identificadores desde el inicio hasta el destino; vacía si es inalcanzable
+    std::uint64_t asentados = 0;                     // Nodos asentados entre todas las direcciones de búsqueda
+};
+
+// Etiquetas de una dirección de búsqueda, reutilizadas entre consultas del mismo hilo
+// Una etiqueta solo vale si su marca coincide con la ronda actual, así no hay que limpiar n posiciones por consulta
+struct EtiquetasBusqueda {
+    std::vector<int> distancia;
+    std::vector<int> previo;
+    std::vector<std::uint32_t> marca;
+    std::uint32_t ronda = 0;
+};
+
+void nuevaRonda(EtiquetasBusqueda& etiquetas, int numNodos) {
+    if (etiquetas.marca.size() != static_cast<std::size_t>(numNodos)) {
+        etiquetas.distancia.assign(numNodos, 0);
+        etiquetas.previo.assign(numNodos, -1);
+        etiquetas.marca.assign(numNodos, 0);
+        etiquetas.ronda = 0;
+    }
+    if (++etiquetas.ronda == 0) {
+        std::fill(etiquetas.marca.begin(), etiquetas.marca.end(), 0);
+        etiquetas.ronda = 1;
+    }
+}
+
+int distanciaEtiqueta(const EtiquetasBusqueda& etiquetas, int nodo) {
+    return etiquetas.marca[nodo] == etiquetas.ronda ? etiquetas.distancia[nodo] : std::numeric_limits<int>::max();
+}
+
+void etiquetar(EtiquetasBusqueda& etiquetas, int nodo, int distancia, int previo) {
+    etiquetas.marca[nodo] = etiquetas.ronda;
+    etiquetas.distancia[nodo] = distancia;
+    etiquetas.previo[nodo] = previo;
+}
+
+thread_local EtiquetasBusqueda etiquetasHaciaAdelante;
+thread_local EtiquetasBusqueda etiquetasHaciaAtras;
+
+// Ruta inicio -> u, luego v -> destino siguiendo la búsqueda hacia atrás (u == v si se encuentran en un nodo)
+std::vector<int> unirRutas(const EtiquetasBusqueda& adelante, const EtiquetasBusqueda& atras, int u, int v) {
+    std::vector<int> ruta;
+    for (int nodo = u; nodo != -1; nodo = adelante.previo[nodo]) {
+        ruta.push_back(nodo + 1);
+    }
+    std::reverse(ruta.begin(), ruta.end());
+    for (int nodo = (u == v ? atras.previo[v] : v); nodo != -1; nodo = atras.previo[nodo]) {
+        ruta.push_back(nodo + 1);
+    }
+    return ruta;
+}
+
+// Función para buscar la ruta más corta entre dos nodos con Dijkstra bidireccional
+// Costo de la arista u -> v: metros más la espera de v. Hacia adelante se recorren las aristas salientes;
+// hacia atrás, las entrantes del grafo inverso, sumando la espera del nodo del que se viene (la cabeza de la arista).
+// Criterio de parada: con mu = mejor costo de un camino que une ambas búsquedas, se termina cuando
+// min(adelante) + min(atrás) >= mu, porque ningún camino que falte por ver puede costar menos.
+RutaPuntoAPunto dijkstraBidireccional(const Grafo& grafo, int inicio, int destino, const std::vector<Atraccion>& atracciones) {
+    CronometroEtapa cronometro(ETAPA_PUNTO_A_PUNTO);
+    RutaPuntoAPunto resultado;
+    if (inicio == destino) {
+        resultado.distancia = 0;
+        resultado.ruta = {inicio + 1};
+        return resultado;
+    }
+
+    typedef std::pair<int, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> colaAdelante;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> colaAtras;
+    EtiquetasBusqueda& adelante = etiquetasHaciaAdelante;
+    EtiquetasBusqueda& atras = etiquetasHaciaAtras;
+    nuevaRonda(adelante, grafo.numNodos);
+    nuevaRonda(atras, grafo.numNodos);
+    etiquetar(adelante, inicio, 0, -1);
+    etiquetar(atras, destino, 0, -1);
+    colaAdelante.push({0, inicio});
+    colaAtras.push({0, destino});
+
+    long long mejor = std::numeric_limits<long long>::max();
+    int encuentroU = -1;
+    int encuentroV = -1;
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 2;
+    std::uint64_t extracciones = 0;
+
+    while (!colaAdelante.empty() && !colaAtras.empty()) {
+        if (static_cast<long long>(colaAdelante.top().first) + colaAtras.top().first >= mejor) break;
+
+        // Se avanza por el lado con el mínimo más chico, así ambas búsquedas crecen parejas
+        bool haciaAdelante = colaAdelante.top().first <= colaAtras.top().first;
+        auto& cola = haciaAdelante ? colaAdelante : colaAtras;
+        EtiquetasBusqueda& propias = haciaAdelante ? adelante : atras;
+        EtiquetasBusqueda& otras = haciaAdelante ? atras : adelante;
+        int distanciaU = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        if (distanciaU > distanciaEtiqueta(propias, u)) continue;
+        ++resultado.asentados;
+
+        const std::vector<int>& inicioLista = haciaAdelante ? grafo.inicioVecinos : grafo.inicioEntrantes;
+        const std::vector<int>& lista = haciaAdelante ? grafo.vecinos : grafo.entrantes;
+        const std::vector<int>& metros = haciaAdelante ? grafo.metros : grafo.metrosEntrantes;
+        relajadas += inicioLista[u + 1] - inicioLista[u];
+        for (int k = inicioLista[u]; k < inicioLista[u + 1]; ++k) {
+            int v = lista[k];
+            // Hacia adelante la arista es u -> v y se espera en v; hacia atrás es v -> u y se espera en u
+            int peso = metros[k] + atracciones[haciaAdelante ? v : u].tiempo_espera;
+            int distanciaV = distanciaU + peso;
+            if (distanciaV < distanciaEtiqueta(propias, v)) {
+                etiquetar(propias, v, distanciaV, u);
+                cola.push({distanciaV, v});
+                ++inserciones;
+            }
+            int distanciaOtra = distanciaEtiqueta(otras, v);
+            if (distanciaOtra != std::numeric_limits<int>::max() && static_cast<long long>(distanciaV) + distanciaOtra < mejor) {
+                mejor = static_cast<long long>(distanciaV) + distanciaOtra;
+                encuentroU = haciaAdelante ? u : v;
+                encuentroV = haciaAdelante ? v : u;
+            }
+        }
+    }
+    sumarContadoresBusqueda(resultado.asentados, relajadas, inserciones, extracciones);
+
+    if (encuentroU == -1) return resultado;
+    resultado.distancia = static_cast<int>(mejor);
+    resultado.ruta = unirRutas(adelante, atras, encuentroU, encuentroV);
+    return resultado;
+}
+
+// Marcas usadas en una consulta ALT: se eligen las que dan la mejor cota entre inicio y destino
+const int MARCAS_ACTIVAS_ALT = 4;
+
+// Cota inferior en metros de nodo a destino con la marca i (desigualdad triangular); 0 si no aporta
+int cotaMarca(const Grafo& grafo, int i, int nodo, int destino) {
+    const int infinito = std::numeric_limits<int>::max();
+    const std::vector<int>& hacia = grafo.metrosHaciaMarca.empty() ? grafo.metrosDesdeMarca : grafo.metrosHaciaMarca;
+    std::size_t posNodo = static_cast<std::size_t>(nodo) * grafo.numMarcas + i;
+    std::size_t posDestino = static_cast<std::size_t>(destino) * grafo.numMarcas + i;
+    int cota = 0;
+    // d(L, destino) - d(L, nodo) <= d(nodo, destino)
+    int desdeNodo = grafo.metrosDesdeMarca[posNodo];
+    int desdeDestino = grafo.metrosDesdeMarca[posDestino];
+    if (desdeNodo != infinito && desdeDestino != infinito) cota = std::max(cota, desdeDestino - desdeNodo);
+    // d(nodo, L) - d(destino, L) <= d(nodo, destino)
+    int haciaNodo = hacia[posNodo];
+    int haciaDestino = hacia[posDestino];
+    if (haciaNodo != infinito && haciaDestino != infinito) cota = std::max(cota, haciaNodo - haciaDestino);
+    return cota;
+}
+
+// Función para buscar la ruta más corta entre dos nodos con A* guiado por marcas (ALT)
+// Mismo costo que dijkstra. El potencial de un nodo es la mejor cota en metros de las marcas activas más la espera
+// del destino (toda ruta termina entrando a él); como cada arista cuesta al menos sus metros, nunca sobreestima.
+// Requiere que el grafo tenga marcas calculadas (calcularMarcas); si no, equivale a dijkstra con parada temprana.
+RutaPuntoAPunto aEstrellaALT(const Grafo& grafo, int inicio, int destino, const std::vector<Atraccion>& atracciones) {
+    CronometroEtapa cronometro(ETAPA_PUNTO_A_PUNTO);
+    RutaPuntoAPunto resultado;
+    if (inicio == destino) {
+        resultado.distancia = 0;
+        resultado.ruta = {inicio + 1};
+        return resultado;
+    }
+
+    // Marcas activas: las de mejor cota para el par (inicio, destino)
+    std::vector<std::pair<int, int>> candidatas;
+    for (int i = 0; i < grafo.numMarcas; ++i) {
+        candidatas.push_back({cotaMarca(grafo, i, inicio, destino), i});
+    }
+    int numActivas = std::min(MARCAS_ACTIVAS_ALT, static_cast<int>(candidatas.size()));
+    std::partial_sort(candidatas.begin(), candidatas.begin() + numActivas, candidatas.end(), std::greater<std::pair<int, int>>());
+    int esperaDestino = std::max(0, atracciones[destino].tiempo_espera);
+    auto potencial = [&](int nodo) {
+        if (nodo == destino) return 0;
+        int cota = 0;
+        for (int a = 0; a < numActivas; ++a) {
+            cota = std::max(cota, cotaMarca(grafo, candidatas[a].second, nodo, destino));
+        }
+        return cota + esperaDestino;
+    };
+
+    typedef std::pair<int, int> Entrada; // (distancia + potencial, nodo)
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+    EtiquetasBusqueda& etiquetas = etiquetasHaciaAdelante;
+    nuevaRonda(etiquetas, grafo.numNodos);
+    etiquetar(etiquetas, inicio, 0, -1);
+    cola.push({potencial(inicio), inicio});
+
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 1;
+    std::uint64_t extracciones = 0;
+    bool encontrado = false;
+
+    while (!cola.empty()) {
+        int clave = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        int distanciaU = distanciaEtiqueta(etiquetas, u);
+        if (clave > distanciaU + potencial(u)) continue;
+        ++resultado.asentados;
+        if (u == destino) {
+            encontrado = true;
+            break;
+        }
+
+        relajadas += grafo.inicioVecinos[u + 1] - grafo.inicioVecinos[u];
+        for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            int distanciaV = distanciaU + grafo.metros[k] + atracciones[v].tiempo_espera;
+            if (distanciaV < distanciaEtiqueta(etiquetas, v)) {
+                etiquetar(etiquetas, v, distanciaV, u);
+                cola.push({distanciaV + potencial(v), v});
+                ++inserciones;
+            }
+        }
+    }
+    sumarContadoresBusqueda(resultado.asentados, relajadas, inserciones, extracciones);
+
+    if (!encontrado) return resultado;
+    resultado.distancia = distanciaEtiqueta(etiquetas, destino);
+    for (int nodo = destino; nodo != -1; nodo = etiquetas.previo[nodo]) {
+        resultado.ruta.push_back(nodo + 1);
+    }
+    std::reverse(resultado.ruta.begin(), resultado.ruta.end());
+    return resultado;
+}
+
+//-------------------------------------------------------------
+
+// Jerarquía de contracción (contraction hierarchies) para parques con millones de tramos
+// Preproceso: los nodos se contraen por rondas, de menos a más importantes. Al quitar un nodo se agrega un atajo
+// entre cada par de vecinos, salvo que una búsqueda de testigos encuentre un camino igual o más corto que no pase por él.
+// Consulta: Dijkstra bidireccional que solo sube de rango; después los atajos se despliegan hasta los nodos del Grafo.
+// Los pesos son los de dijkstra (metros más la espera del nodo de llegada), así que la jerarquía depende de los tiempos
+// de espera: cuando cambian se reconstruye en segundo plano y mientras tanto se usa la búsqueda bidireccional.
+
+struct AristaJerarquia {
+    int nodo;  // Vecino de mayor rango
+    int peso;
+    int medio; // Nodo contraído al que reemplaza el atajo; -1 si es una arista del Grafo
+};
+
+struct JerarquiaContraccion {
+    int numNodos = 0;
+    std::uint64_t firma = 0;      // Huella del grafo y de los tiempos de espera con los que se construyó
+    std::vector<int> rango;        // Orden de contracción de cada nodo
+    std::vector<int> inicioSubida; // Aristas u -> v con rango[v] > rango[u], guardadas en u
+    std::vector<AristaJerarquia> subida;
+    std::vector<int> inicioBajada; // Aristas v -> u con rango[v] > rango[u], guardadas en u (nodo = v)
+    std::vector<AristaJerarquia> bajada;
+};
+
+// Función para calcular la huella (FNV-1a) del grafo y los tiempos de espera; una jerarquía guardada solo sirve si coincide
+std::uint64_t firmaJerarquia(const Grafo& grafo, const std::vector<Atraccion>& atracciones) {
+    std::uint64_t firma = 1469598103934665603ULL;
+    auto mezclar = [&](std::int64_t valor) {
+        firma ^= static_cast<std::uint64_t>(valor);
+        firma *= 1099511628211ULL;
+    };
+    mezclar(grafo.numNodos);
+    for (int valor : grafo.inicioVecinos) mezclar(valor);
+    for (int valor : grafo.vecinos) mezclar(valor);
+    for (int valor : grafo.metros) mezclar(valor);
+    for (int v = 0; v < grafo.numNodos; ++v) mezclar(atracciones[v].tiempo_espera);
+    return firma;
+}
+
+// Función para repartir cantidad índices entre numHilos hilos, en bloques que cada hilo toma de un contador común
+void paraCadaEnParalelo(std::size_t cantidad, unsigned numHilos, const std::function<void(std::size_t)>& funcion) {
+    const std::size_t bloque = 64;
+    std::atomic<std::size_t> siguiente{0};
+    auto trabajar = [&]() {
+        for (std::size_t desde = siguiente.fetch_add(bloque); desde < cantidad; desde = siguiente.fetch_add(bloque)) {
+            for (std::size_t i = desde; i < std::min(cantidad, desde + bloque); ++i) funcion(i);
+        }
+    };
+    std::vector<std::thread> hilos;
+    for (unsigned h = 1; h < numHilos && h * bloque < cantidad; ++h) {
+        hilos.emplace_back(trabajar);
+    }
+    trabajar();
+    for (auto& hilo : hilos) hilo.join();
+}
+
+// Grafo de trabajo durante la contracción: solo aristas entre nodos que todavía no se contrajeron
+struct EstadoContraccion {
+    int numNodos = 0;
+    std::vector<std::vector<AristaJerarquia>> salientes;
+    std::vector<std::vector<AristaJerarquia>> entrantes;
+    std::vector<char> contraido;
+    std::vector<char> enRonda;        // Nodos que se contraen en la ronda actual; las búsquedas de testigos no pasan por ellos
+    std::vector<int> vecinosContraidos;
+    std::vector<int> prioridad;
+};
+
+// Nodos asentados como máximo por búsqueda de testigos; si no alcanza, se agrega el atajo (de más, nunca de menos)
+const int LIMITE_TESTIGOS = 500;
+
+thread_local EtiquetasBusqueda etiquetasTestigos;
+thread_local EtiquetasBusqueda objetivosTestigos; // Vecinos salientes del nodo que se contrae (etiqueta = peso de v a él)
+thread_local std::vector<std::pair<int, int>> colaTestigos;
+
+// Agrega la arista u -> nodo o la acorta si ya existía (entre dos nodos se guarda solo la más corta)
+void agregarAristaJerarquia(std::vector<AristaJerarquia>& lista, int nodo, int peso, int medio) {
+    for (auto& arista : lista) {
+        if (arista.nodo == nodo) {
+            if (peso < arista.peso) {
+                arista.peso = peso;
+                arista.medio = medio;
+            }
+            return;
+        }
+    }
+    lista.push_back({nodo, peso, medio});
+}
+
+void quitarAristaJerarquia(std::vector<AristaJerarquia>& lista, int nodo) {
+    lista.erase(std::remove_if(lista.begin(), lista.end(), [nodo](const AristaJerarquia& arista) { return arista.nodo == nodo; }), lista.end());
+}
+
+// Función para calcular los atajos {desde, hasta, peso} que hacen falta al contraer v, sin modificar el estado
+// Una búsqueda de testigos por vecino entrante u; termina al asentar todos los vecinos salientes o al pasar el límite
+void atajosNecesarios(const EstadoContraccion& estado, int v, std::vector<std::array<int, 3>>& atajos) {
+    atajos.clear();
+    const auto& entrantes = estado.entrantes[v];
+    const auto& salientes = estado.salientes[v];
+    if (entrantes.empty() || salientes.empty()) return;
+    int maximoSaliente = 0;
+    EtiquetasBusqueda& objetivos = objetivosTestigos;
+    nuevaRonda(objetivos, estado.numNodos);
+    for (const auto& arista : salientes) {
+        maximoSaliente = std::max(maximoSaliente, arista.peso);
+        etiquetar(objetivos, arista.nodo, arista.peso, -1);
+    }
+
+    typedef std::pair<int, int> Entrada;
+    EtiquetasBusqueda& etiquetas = etiquetasTestigos;
+    std::vector<Entrada>& cola = colaTestigos;
+    std::greater<Entrada> mayor;
+    for (const auto& entrada : entrantes) {
+        int u = entrada.nodo;
+        long long limite = static_cast<long long>(entrada.peso) + maximoSaliente;
+        int pendientes = static_cast<int>(salientes.size()) - (distanciaEtiqueta(objetivos, u) != std::numeric_limits<int>::max());
+        nuevaRonda(etiquetas, estado.numNodos);
+        etiquetar(etiquetas, u, 0, -1);
+        cola.assign(1, {0, u});
+        int asentados = 0;
+        while (!cola.empty() && pendientes > 0) {
+            std::pop_heap(cola.begin(), cola.end(), mayor);
+            int distanciaX = cola.back().first;
+            int x = cola.back().second;
+            cola.pop_back();
+            if (distanciaX > distanciaEtiqueta(etiquetas, x)) continue;
+            if (distanciaX > limite || ++asentados > LIMITE_TESTIGOS) break;
+            if (x != u && distanciaEtiqueta(objetivos, x) != std::numeric_limits<int>::max()) --pendientes;
+            for (const auto& arista : estado.salientes[x]) {
+                if (estado.enRonda[arista.nodo]) continue;
+                int distanciaY = distanciaX + arista.peso;
+                if (distanciaY < distanciaEtiqueta(etiquetas, arista.nodo)) {
+                    etiquetar(etiquetas, arista.nodo, distanciaY, x);
+                    cola.push_back({distanciaY, arista.nodo});
+                    std::push_heap(cola.begin(), cola.end(), mayor);
+                }
+            }
+        }
+        for (const auto& salida : salientes) {
+            if (salida.nodo == u) continue;
+            int porV = entrada.peso + salida.peso;
+            if (distanciaEtiqueta(etiquetas, salida.nodo) > porV) atajos.push_back({u, salida.nodo, porV});
+        }
+    }
+}
+
+// Prioridad de contracción: atajos posibles menos aristas quitadas, más los vecinos ya contraídos (reparte la contracción)
+// Se cuentan todos los pares de vecinos como atajos sin buscar testigos: en los parques, donde cada nodo suma su espera,
+// casi no hay testigos y esta cota da un orden mejor (menos atajos en total) que simular la contracción, y es mucho más barata
+int prioridadContraccion(const EstadoContraccion& estado, int v) {
+    long long entrantes = static_cast<long long>(estado.entrantes[v].size());
+    long long salientes = static_cast<long long>(estado.salientes[v].size());
+    long long ida_y_vuelta = 0;
+    for (const auto& entrada : estado.entrantes[v]) {
+        for (const auto& salida : estado.salientes[v]) ida_y_vuelta += salida.nodo == entrada.nodo;
+    }
+    long long diferencia = entrantes * salientes - ida_y_vuelta - entrantes - salientes;
+    return static_cast<int>(std::min<long long>(2 * diferencia + estado.vecinosContraidos[v], std::numeric_limits<int>::max()));
+}
+
+// Función para construir la jerarquía con numHilos hilos
+// En cada ronda se contraen a la vez los nodos cuya prioridad es menor que la de todos sus vecinos (un conjunto independiente)
+std::shared_ptr<JerarquiaContraccion> construirJerarquia(const Grafo& grafo, const std::vector<Atraccion>& atracciones, unsigned numHilos) {
+    int n = grafo.numNodos;
+    EstadoContraccion estado;
+    estado.numNodos = n;
+    estado.salientes.resize(n);
+    estado.entrantes.resize(n);
+    estado.contraido.assign(n, 0);
+    estado.enRonda.assign(n, 0);
+    estado.vecinosContraidos.assign(n, 0);
+    estado.prioridad.assign(n, 0);
+    for (int u = 0; u < n; ++u) {
+        for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            if (v == u) continue;
+            int peso = grafo.metros[k] + atracciones[v].tiempo_espera;
+            agregarAristaJerarquia(estado.salientes[u], v, peso, -1);
+            agregarAristaJerarquia(estado.entrantes[v], u, peso, -1);
+        }
+    }
+
+    auto jerarquia = std::make_shared<JerarquiaContraccion>();
+    jerarquia->numNodos = n;
+    jerarquia->firma = firmaJerarquia(grafo, atracciones);
+    jerarquia->rango.assign(n, 0);
+    std::vector<std::vector<AristaJerarquia>> subida(n), bajada(n);
+
+    std::vector<int> restantes(n);
+    for (int v = 0; v < n; ++v) restantes[v] = v;
+    paraCadaEnParalelo(restantes.size(), numHilos, [&](std::size_t i) { estado.prioridad[restantes[i]] = prioridadContraccion(estado, restantes[i]); });
+
+    int siguienteRango = 0;
+    std::vector<char> elegido;
+    std::vector<int> ronda;
+    std::vector<std::vector<std::array<int, 3>>> atajosRonda;
+    std::vector<int> afectados;
+    while (!restantes.empty()) {
+        // Nodos de la ronda: mínimos locales de (prioridad, índice) entre los vecinos sin contraer
+        elegido.assign(restantes.size(), 0);
+        paraCadaEnParalelo(restantes.size(), numHilos, [&](std::size_t i) {
+            int v = restantes[i];
+            auto menor = [&](int otro) {
+                return estado.prioridad[v] < estado.prioridad[otro] || (estado.prioridad[v] == estado.prioridad[otro] && v < otro);
+            };
+            for (const auto& arista : estado.salientes[v]) if (!menor(arista.nodo)) return;
+            for (const auto& arista : estado.entrantes[v]) if (!menor(arista.nodo)) return;
+            elegido[i] = 1;
+        });
+        ronda.clear();
+        for (std::size_t i = 0; i < restantes.size(); ++i) {
+            if (elegido[i]) ronda.push_back(restantes[i]);
+        }
+        for (int v : ronda) estado.enRonda[v] = 1;
+
+        // Atajos de cada nodo de la ronda, en paralelo sobre el grafo sin modificar
+        atajosRonda.resize(ronda.size());
+        paraCadaEnParalelo(ronda.size(), numHilos, [&](std::size_t i) { atajosNecesarios(estado, ronda[i], atajosRonda[i]); });
+
+        // Contracción: las aristas que le quedan a v van a nodos de mayor rango y pasan a la jerarquía
+        afectados.clear();
+        for (std::size_t i = 0; i < ronda.size(); ++i) {
+            int v = ronda[i];
+            jerarquia->rango[v] = siguienteRango++;
+            estado.contraido[v] = 1;
+            for (const auto& arista : estado.salientes[v]) {
+                quitarAristaJerarquia(estado.entrantes[arista.nodo], v);
+                ++estado.vecinosContraidos[arista.nodo];
+                afectados.push_back(arista.nodo);
+            }
+            for (const auto& arista : estado.entrantes[v]) {
+                quitarAristaJerarquia(estado.salientes[arista.nodo], v);
+                ++estado.vecinosContraidos[arista.nodo];
+                afectados.push_back(arista.nodo);
+            }
+            for (const auto& atajo : atajosRonda[i]) {
+                agregarAristaJerarquia(estado.salientes[atajo[0]], atajo[1], atajo[2], v);
+                agregarAristaJerarquia(estado.entrantes[atajo[1]], atajo[0], atajo[2], v);
+            }
+            subida[v] = std::move(estado.salientes[v]);
+            bajada[v] = std::move(estado.entrantes[v]);
+            estado.salientes[v].clear();
+            estado.entrantes[v].clear();
+            estado.enRonda[v] = 0;
+        }
+
+        // Solo cambia la prioridad de los vecinos de los nodos contraídos
+        std::sort(afectados.begin(), afectados.end());
+        afectados.erase(std::unique(afectados.begin(), afectados.end()), afectados.end());
+        paraCadaEnParalelo(afectados.size(), numHilos, [&](std::size_t i) { estado.prioridad[afectados[i]] = prioridadContraccion(estado, afectados[i]); });
+        restantes.erase(std::remove_if(restantes.begin(), restantes.end(), [&](int v) { return estado.contraido[v] != 0; }), restantes.end());
+    }
+
+    // Listas de cada nodo en formato CSR
+    jerarquia->inicioSubida.assign(n + 1, 0);
+    jerarquia->inicioBajada.assign(n + 1, 0);
+    for (int v = 0; v < n; ++v) {
+        jerarquia->inicioSubida[v + 1] = jerarquia->inicioSubida[v] + static_cast<int>(subida[v].size());
+        jerarquia->inicioBajada[v + 1] = jerarquia->inicioBajada[v] + static_cast<int>(bajada[v].size());
+    }
+    jerarquia->subida.reserve(jerarquia->inicioSubida[n]);
+    jerarquia->bajada.reserve(jerarquia->inicioBajada[n]);
+    for (int v = 0; v < n; ++v) {
+        jerarquia->subida.insert(jerarquia->subida.end(), subida[v].begin(), subida[v].end());
+        jerarquia->bajada.insert(jerarquia->bajada.end(), bajada[v].begin(), bajada[v].end());
+    }
+    return jerarquia;
+}
+
+// Persistencia: encabezado, número de nodos, firma y cada arreglo con su tamaño
+const char MAGIA_JERARQUIA[8] = {'P', 'A', 'R', 'Q', 'U', 'E', 'C', '1'};
+
+template <typename T>
+void escribirArreglo(std::ofstream& archivo, const std::vector<T>& arreglo) {
+    std::uint64_t tamano = arreglo.size();
+    archivo.write(reinterpret_cast<const char*>(&tamano), sizeof(tamano));
+    archivo.write(reinterpret_cast<const char*>(arreglo.data()), static_cast<std::streamsize>(tamano * sizeof(T)));
+}
+
+template <typename T>
+bool leerArreglo(std::ifstream& archivo, std::vector<T>& arreglo, std::uint64_t maximo) {
+    std::uint64_t tamano = 0;
+    if (!archivo.read(reinterpret_cast<char*>(&tamano), sizeof(tamano)) || tamano > maximo) return false;
+    arreglo.resize(tamano);
+    return static_cast<bool>(archivo.read(reinterpret_cast<char*>(arreglo.data()), static_cast<std::streamsize>(tamano * sizeof(T))));
+}
+
+bool guardarJerarquia(const JerarquiaContraccion& jerarquia, const std::string& archivoSalida) {
+    std::ofstream archivo(archivoSalida, std::ios::binary);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoSalida << " para guardar la jerarquia." << std::endl;
+        return false;
+    }
+    archivo.write(MAGIA_JERARQUIA, sizeof(MAGIA_JERARQUIA));
+    archivo.write(reinterpret_cast<const char*>(&jerarquia.numNodos), sizeof(jerarquia.numNodos));
+    archivo.write(reinterpret_cast<const char*>(&jerarquia.firma), sizeof(jerarquia.firma));
+    escribirArreglo(archivo, jerarquia.rango);
+    escribirArreglo(archivo, jerarquia.inicioSubida);
+    escribirArreglo(archivo, jerarquia.subida);
+    escribirArreglo(archivo, jerarquia.inicioBajada);
+    escribirArreglo(archivo, jerarquia.bajada);
+    return static_cast<bool>(archivo);
+}
+
+// Devuelve nullptr si el archivo no existe, está dañado o se construyó con otro grafo u otros tiempos de espera
+std::shared_ptr<JerarquiaContraccion> leerJerarquia(const std::string& archivoEntrada, std::uint64_t firma) {
+    std::ifstream archivo(archivoEntrada, std::ios::binary);
+    if (!archivo.is_open()) return nullptr;
+    char magia[sizeof(MAGIA_JERARQUIA)];
+    auto jerarquia = std::make_shared<JerarquiaContraccion>();
+    if (!archivo.read(magia, sizeof(magia)) || std::memcmp(magia, MAGIA_JERARQUIA, sizeof(magia)) != 0) return nullptr;
+    if (!archivo.read(reinterpret_cast<char*>(&jerarquia->numNodos), sizeof(jerarquia->numNodos))) return nullptr;
+    if (!archivo.read(reinterpret_cast<char*>(&jerarquia->firma), sizeof(jerarquia->firma)) || jerarquia->firma != firma) return nullptr;
+    const std::uint64_t n = static_cast<std::uint64_t>(jerarquia->numNodos);
+    const std::uint64_t maximoAristas = std::numeric_limits<int>::max();
+    if (!leerArreglo(archivo, jerarquia->rango, n) || jerarquia->rango.size() != n) return nullptr;
+    if (!leerArreglo(archivo, jerarquia->inicioSubida, n + 1) || jerarquia->inicioSubida.size() != n + 1) return nullptr;
+    if (!leerArreglo(archivo, jerarquia->subida, maximoAristas)) return nullptr;
+    if (!leerArreglo(archivo, jerarquia->inicioBajada, n + 1) || jerarquia->inicioBajada.size() != n + 1) return nullptr;
+    if (!leerArreglo(archivo, jerarquia->bajada, maximoAristas)) return nullptr;
+    if (jerarquia->inicioSubida[n] != static_cast<int>(jerarquia->subida.size()) ||
+        jerarquia->inicioBajada[n] != static_cast<int>(jerarquia->bajada.size())) return nullptr;
+    return jerarquia;
+}
+
+// Función para obtener la jerarquía del modelo: se lee de archivoJerarquia si corresponde al parque; si no, se construye y se guarda
+std::shared_ptr<const JerarquiaContraccion> prepararJerarquia(const Grafo& grafo, const std::vector<Atraccion>& atracciones) {
+    if (grafo.numNodos == 0 || atracciones.size() < static_cast<std::size_t>(grafo.numNodos)) return nullptr;
+    CronometroEtapa cronometro(ETAPA_CARGA_JERARQUIA);
+    std::uint64_t firma = firmaJerarquia(grafo, atracciones);
+    if (!archivoJerarquia.empty()) {
+        auto guardada = leerJerarquia(archivoJerarquia, firma);
+        if (guardada) return guardada;
+    }
+    auto jerarquia = construirJerarquia(grafo, atracciones, std::max(1u, std::thread::hardware_concurrency()));
+    if (!archivoJerarquia.empty()) {
+        guardarJerarquia(*jerarquia, archivoJerarquia);
+    }
+    return jerarquia;
+}
+
+// Reconstrucción en segundo plano después de editar tiempos de espera o recargar el parque
+// (un solo hilo a la vez; los pedidos se juntan). El hilo se une antes de salir con esperarJerarquia.
+std::atomic<bool> jerarquiaPedida{false};
+std::atomic<bool> jerarquiaEnCurso{false};
+std::mutex mutexHiloJerarquia;
+std::thread hiloJerarquia;
+
+void reconstruirJerarquias() {
+    do {
+        while (jerarquiaPedida.exchange(false)) {
+            auto base = modeloActual();
+            auto jerarquia = prepararJerarquia(*base->grafo, base->atracciones);
+            if (!jerarquia) continue;
+            std::lock_guard<std::mutex> bloqueo(mutexEdicionModelo);
+            auto actual = modeloActual();
+            // Si el modelo cambió mientras tanto, quien lo cambió ya pidió otra reconstrucción
+            if (actual->jerarquia || jerarquia->firma != firmaJerarquia(*actual->grafo, actual->atracciones)) continue;
+            auto nuevo = std::make_shared<ModeloParque>(*actual);
+            nuevo->jerarquia = jerarquia;
+            publicarModelo(nuevo);
+        }
+        jerarquiaEnCurso = false;
+    } while (jerarquiaPedida && !jerarquiaEnCurso.exchange(true));
+}
+
+void pedirJerarquia() {
+    if (!jerarquiaAlCargar) return;
+    jerarquiaPedida = true;
+    if (!jerarquiaEnCurso.exchange(true)) {
+        std::lock_guard<std::mutex> bloqueo(mutexHiloJerarquia);
+        // El hilo anterior ya dejó de tomar mutexEdicionModelo (bajó jerarquiaEnCurso), así que unirlo es inmediato
+        if (hiloJerarquia.joinable()) hiloJerarquia.join();
+        hiloJerarquia = std::thread(reconstruirJerarquias);
+    }
+}
+
+// Espera a que termine la reconstrucción en curso; se llama al salir, cuando ya nadie puede pedir otra
+void esperarJerarquia() {
+    std::lock_guard<std::mutex> bloqueo(mutexHiloJerarquia);
+    if (hiloJerarquia.joinable()) hiloJerarquia.join();
+}
+
+// Busca la arista desde -> hasta entre las guardadas en el nodo (existe siempre que la pida el despliegue de un atajo)
+const AristaJerarquia& aristaGuardada(const std::vector<int>& inicioLista, const std::vector<AristaJerarquia>& lista, int nodo, int vecino) {
+    for (int k = inicioLista[nodo]; k < inicioLista[nodo + 1]; ++k) {
+        if (lista[k].nodo == vecino) return lista[k];
+    }
+    return lista[inicioLista[nodo]];
+}
+
+// Función para agregar a ruta los nodos del Grafo de la arista desde -> hasta (sin desde), desplegando los atajos
+void desplegarArista(const JerarquiaContraccion& jerarquia, int desde, int hasta, int medio, std::vector<int>& ruta) {
+    std::vector<std::array<int, 3>> pendientes = {{desde, hasta, medio}};
+    while (!pendientes.empty()) {
+        std::array<int, 3> tramo = pendientes.back();
+        pendientes.pop_back();
+        if (tramo[2] == -1) {
+            ruta.push_back(tramo[1] + 1);
+            continue;
+        }
+        // desde -> medio baja de rango (se guarda en medio, del lado de bajada); medio -> hasta sube
+        int m = tramo[2];
+        const AristaJerarquia& segunda = aristaGuardada(jerarquia.inicioSubida, jerarquia.subida, m, tramo[1]);
+        const AristaJerarquia& primera = aristaGuardada(jerarquia.inicioBajada, jerarquia.bajada, m, tramo[0]);
+        pendientes.push_back({m, tramo[1], segunda.medio});
+        pendientes.push_back({tramo[0], m, primera.medio});
+    }
+}
+
+// Función para buscar la ruta más corta entre dos nodos en la jerarquía (mismo costo que dijkstra)
+// Cada búsqueda solo sube de rango y sigue hasta que su mínimo alcanza al mejor encuentro. Un nodo al que se llega más
+// barato bajando desde un vecino de mayor rango ya etiquetado no puede estar en el camino óptimo y no se expande
+// (stall-on-demand). Con desplegar = false se calcula solo la distancia.
+RutaPuntoAPunto consultarJerarquia(const JerarquiaContraccion& jerarquia, int inicio, int destino, bool desplegar) {
+    CronometroEtapa cronometro(ETAPA_PUNTO_A_PUNTO);
+    RutaPuntoAPunto resultado;
+    if (inicio == destino) {
+        resultado.distancia = 0;
+        resultado.ruta = {inicio + 1};
+        return resultado;
+    }
+
+    typedef std::pair<int, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> colaAdelante;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> colaAtras;
+    EtiquetasBusqueda& adelante = etiquetasHaciaAdelante;
+    EtiquetasBusqueda& atras = etiquetasHaciaAtras;
+    nuevaRonda(adelante, jerarquia.numNodos);
+    nuevaRonda(atras, jerarquia.numNodos);
+    etiquetar(adelante, inicio, 0, -1);
+    etiquetar(atras, destino, 0, -1);
+    colaAdelante.push({0, inicio});
+    colaAtras.push({0, destino});
+
+    long long mejor = std::numeric_limits<long long>::max();
+    int encuentro = -1;
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 2;
+    std::uint64_t extracciones = 0;
+
+    while (true) {
+        bool puedeAdelante = !colaAdelante.empty() && colaAdelante.top().first < mejor;
+        bool puedeAtras = !colaAtras.empty() && colaAtras.top().first < mejor;
+        if (!puedeAdelante && !puedeAtras) break;
+        bool haciaAdelante = puedeAdelante && (!puedeAtras || colaAdelante.top().first <= colaAtras.top().first);
+        auto& cola = haciaAdelante ? colaAdelante : colaAtras;
+        EtiquetasBusqueda& propias = haciaAdelante ? adelante : atras;
+        EtiquetasBusqueda& otras = haciaAdelante ? atras : adelante;
+        int distanciaU = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        if (distanciaU > distanciaEtiqueta(propias, u)) continue;
+        ++resultado.asentados;
+
+        int distanciaOtra = distanciaEtiqueta(otras, u);
+        if (distanciaOtra != std::numeric_limits<int>::max() && static_cast<long long>(distanciaU) + distanciaOtra < mejor) {
+            mejor = static_cast<long long>(distanciaU) + distanciaOtra;
+            encuentro = u;
+        }
+
+        // Hacia adelante se sube por las aristas salientes; hacia atrás, por las entrantes desde nodos de mayor rango
+        const std::vector<int>& inicioLista = haciaAdelante ? jerarquia.inicioSubida : jerarquia.inicioBajada;
+        const std::vector<AristaJerarquia>& lista = haciaAdelante ? jerarquia.subida : jerarquia.bajada;
+        const std::vector<int>& inicioOpuesta = haciaAdelante ? jerarquia.inicioBajada : jerarquia.inicioSubida;
+        const std::vector<AristaJerarquia>& opuesta = haciaAdelante ? jerarquia.bajada : jerarquia.subida;
+        bool estancado = false;
+        for (int k = inicioOpuesta[u]; k < inicioOpuesta[u + 1] && !estancado; ++k) {
+            int distanciaV = distanciaEtiqueta(propias, opuesta[k].nodo);
+            estancado = distanciaV != std::numeric_limits<int>::max() && distanciaV + opuesta[k].peso < distanciaU;
+        }
+        if (estancado) continue;
+
+        relajadas += inicioLista[u + 1] - inicioLista[u];
+        for (int k = inicioLista[u]; k < inicioLista[u + 1]; ++k) {
+            int v = lista[k].nodo;
+            int distanciaV = distanciaU + lista[k].peso;
+            if (distanciaV < distanciaEtiqueta(propias, v)) {
+                etiquetar(propias, v, distanciaV, u);
+                cola.push({distanciaV, v});
+                ++inserciones;
+            }
+        }
+    }
+    sumarContadoresBusqueda(resultado.asentados, relajadas, inserciones, extracciones);
+
+    if (encuentro == -1) return resultado;
+    resultado.distancia = static_cast<int>(mejor);
+    if (!desplegar) return resultado;
+
+    // Subida inicio -> encuentro y bajada encuentro -> destino, desplegando cada arista
+    std::vector<int> subida;
+    for (int nodo = encuentro; nodo != -1; nodo = adelante.previo[nodo]) subida.push_back(nodo);
+    std::reverse(subida.begin(), subida.end());
+    resultado.ruta.push_back(inicio + 1);
+    for (std::size_t i = 1; i < subida.size(); ++i) {
+        const AristaJerarquia& arista = aristaGuardada(jerarquia.inicioSubida, jerarquia.subida, subida[i - 1], subida[i]);
+        desplegarArista(jerarquia, subida[i - 1], subida[i], arista.medio, resultado.ruta);
+    }
+    for (int nodo = encuentro; atras.previo[nodo] != -1; nodo = atras.previo[nodo]) {
+        int siguiente = atras.previo[nodo];
+        const AristaJerarquia& arista = aristaGuardada(jerarquia.inicioBajada, jerarquia.bajada, siguiente, nodo);
+        desplegarArista(jerarquia, nodo, siguiente, arista.medio, resultado.ruta);
+    }
+    return resultado;
+}
+
+//-------------------------------------------------------------
+
+// Planificación de rutas personalizable (CRP): partición multinivel del grafo más una métrica por celda
+// Topología (una vez por grafo): el parque se divide en celdas de hasta TAMANO_CELDA_CRP nodos, que se agrupan en celdas
+// FACTOR_NIVEL_CRP veces más grandes en cada nivel. Los nodos de frontera de una celda son los que tienen aristas hacia
+// afuera de ella. Métrica (personalización): por cada celda, la matriz de costos entre sus fronteras sin salir de la celda,
+// calculada en el nivel de abajo. Al cambiar la espera de un nodo solo se recalculan las celdas que lo contienen.
+// Consulta: Dijkstra bidireccional que usa el grafo original cerca del inicio y el destino y las matrices del nivel más
+// alto posible lejos de ellos; después cada tramo de matriz se despliega nivel por nivel hasta los nodos del Grafo.
+
+const int TAMANO_CELDA_CRP = 256;
+const int FACTOR_NIVEL_CRP = 16;
+const int MAX_NIVELES_CRP = 4;
+const int MIN_CELDAS_NIVEL_CRP = 8; // Un nivel con menos celdas casi nunca evita al inicio y al destino y es caro de personalizar
+
+struct CeldaCRP {
+    std::vector<int> frontera; // Nodos de la celda con aristas hacia o desde otras celdas del mismo nivel
+};
+
+// Los arreglos por nivel se indexan de 1 a numNiveles (el nivel 0 es el grafo original)
+struct ParticionCRP {
+    int numNiveles = 0;
+    std::vector<std::vector<int>> celdaDe;          // [nivel][nodo] -> celda que lo contiene
+    std::vector<std::vector<int>> posicionFrontera; // [nivel][nodo] -> índice en la frontera de su celda, o -1
+    std::vector<std::vector<CeldaCRP>> celdas;      // [nivel][celda]
+};
+
+// Matrices de cada celda, fila = frontera de salida. Se comparten entre versiones: solo se copian las celdas que cambian
+struct MetricaCRP {
+    std::vector<std::vector<std::shared_ptr<const std::vector<int>>>> matrices; // [nivel][celda], tamaño frontera²
+};
+
+// Función para agrupar los elementos de un grafo en regiones conexas de peso total hasta limite, creciendo por BFS
+// Las semillas se toman en orden BFS desde el elemento 0 para que regiones vecinas queden cerca entre sí
+template <typename Vecinos>
+std::vector<int> crecerRegiones(int numElementos, const std::vector<int>& peso, int limite, Vecinos&& vecinos, int& numRegiones) {
+    std::vector<int> region(numElementos, -1);
+    std::vector<char> visto(numElementos, 0);
+    std::vector<int> orden;
+    orden.reserve(numElementos);
+    for (int raiz = 0; raiz < numElementos; ++raiz) {
+        if (visto[raiz]) continue;
+        visto[raiz] = 1;
+        orden.push_back(raiz);
+        for (std::size_t i = orden.size() - 1; i < orden.size(); ++i) {
+            vecinos(orden[i], [&](int otro) {
+                if (!visto[otro]) {
+                    visto[otro] = 1;
+                    orden.push_back(otro);
+                }
+            });
+        }
+    }
+
+    numRegiones = 0;
+    std::vector<int> cola;
+    for (int semilla : orden) {
+        if (region[semilla] != -1) continue;
+        region[semilla] = numRegiones;
+        int total = peso[semilla];
+        cola.assign(1, semilla);
+        for (std::size_t i = 0; i < cola.size() && total < limite; ++i) {
+            vecinos(cola[i], [&](int otro) {
+                if (region[otro] == -1 && total + peso[otro] <= limite) {
+                    region[otro] = numRegiones;
+                    total += peso[otro];
+                    cola.push_back(otro);
+                }
+            });
+        }
+        ++numRegiones;
+    }
+    return region;
+}
+
+// Función para particionar el grafo en niveles (solo depende de la topología, no de los tiempos de espera)
+std::shared_ptr<ParticionCRP> particionarGrafo(const Grafo& grafo) {
+    CronometroEtapa cronometro(ETAPA_CARGA_PARTICION);
+    int n = grafo.numNodos;
+    auto particion = std::make_shared<ParticionCRP>();
+    particion->celdaDe.emplace_back();
+    particion->posicionFrontera.emplace_back();
+    particion->celdas.emplace_back();
+
+    // Elementos del nivel anterior (nodos en el nivel 0) y la celda de cada nodo en ese nivel
+    std::vector<int> elementoDe(n);
+    for (int v = 0; v < n; ++v) elementoDe[v] = v;
+    int numElementos = n;
+    std::vector<int> peso(n, 1);
+    long long limite = TAMANO_CELDA_CRP;
+
+    while (particion->numNiveles < MAX_NIVELES_CRP) {
+        // Adyacencia entre elementos (sin direcciones: una arista en cualquier sentido los une)
+        std::vector<std::vector<int>> adyacencia;
+        if (particion->numNiveles > 0) {
+            adyacencia.resize(numElementos);
+            for (int u = 0; u < n; ++u) {
+                for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+                    int a = elementoDe[u], b = elementoDe[grafo.vecinos[k]];
+                    if (a != b) {
+                        adyacencia[a].push_back(b);
+                        adyacencia[b].push_back(a);
+                    }
+                }
+            }
+            for (auto& lista : adyacencia) {
+                std::sort(lista.begin(), lista.end());
+                lista.erase(std::unique(lista.begin(), lista.end()), lista.end());
+            }
+        }
+        auto vecinos = [&](int elemento, const std::function<void(int)>& visitar) {
+            if (particion->numNiveles > 0) {
+                for (int otro : adyacencia[elemento]) visitar(otro);
+                return;
+            }
+            for (int k = grafo.inicioVecinos[elemento]; k < grafo.inicioVecinos[elemento + 1]; ++k) visitar(grafo.vecinos[k]);
+            for (int k = grafo.inicioEntrantes[elemento]; k < grafo.inicioEntrantes[elemento + 1]; ++k) visitar(grafo.entrantes[k]);
+        };
+        int numCeldas = 0;
+        std::vector<int> regionDe = crecerRegiones(numElementos, peso, static_cast<int>(std::min<long long>(limite, n)), vecinos, numCeldas);
+        if (numCeldas < MIN_CELDAS_NIVEL_CRP || numCeldas == numElementos) break;
+
+        int nivel = ++particion->numNiveles;
+        particion->celdaDe.emplace_back(n);
+        particion->posicionFrontera.emplace_back(n, -1);
+        particion->celdas.emplace_back(numCeldas);
+        std::vector<int>& celdaDe = particion->celdaDe[nivel];
+        for (int v = 0; v < n; ++v) celdaDe[v] = regionDe[elementoDe[v]];
+        for (int u = 0; u < n; ++u) {
+            bool esFrontera = false;
+            for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1] && !esFrontera; ++k) esFrontera = celdaDe[grafo.vecinos[k]] != celdaDe[u];
+            for (int k = grafo.inicioEntrantes[u]; k < grafo.inicioEntrantes[u + 1] && !esFrontera; ++k) esFrontera = celdaDe[grafo.entrantes[k]] != celdaDe[u];
+            if (!esFrontera) continue;
+            auto& frontera = particion->celdas[nivel][celdaDe[u]].frontera;
+            particion->posicionFrontera[nivel][u] = static_cast<int>(frontera.size());
+            frontera.push_back(u);
+        }
+
+        std::vector<int> pesoCeldas(numCeldas, 0);
+        for (int e = 0; e < numElementos; ++e) pesoCeldas[regionDe[e]] += peso[e];
+        for (int v = 0; v < n; ++v) elementoDe[v] = celdaDe[v];
+        numElementos = numCeldas;
+        peso = std::move(pesoCeldas);
+        limite *= FACTOR_NIVEL_CRP;
+    }
+    return particion;
+}
+
+// Vista de lo que necesita una búsqueda CRP (las partes viven en el modelo o en la métrica que se está personalizando)
+struct VistaCRP {
+    const Grafo& grafo;
+    const std::vector<Atraccion>& atracciones;
+    const ParticionCRP& particion;
+    const MetricaCRP& metrica;
+};
+
+// Función para visitar los arcos de u en el nivel dado: en el nivel 0, las aristas del Grafo; en los demás, la matriz de
+// su celda hacia las otras fronteras más las aristas que salen de la celda. haciaAtras recorre los arcos invertidos.
+template <typename Visitar>
+void arcosEnNivel(const VistaCRP& vista, int u, int nivel, bool haciaAtras, Visitar&& visitar) {
+    const Grafo& grafo = vista.grafo;
+    int i = nivel > 0 ? vista.particion.posicionFrontera[nivel][u] : -1;
+    if (i != -1) {
+        int celda = vista.particion.celdaDe[nivel][u];
+        const std::vector<int>& frontera = vista.particion.celdas[nivel][celda].frontera;
+        const std::vector<int>& matriz = *vista.metrica.matrices[nivel][celda];
+        std::size_t b = frontera.size();
+        for (std::size_t j = 0; j < b; ++j) {
+            int costo = haciaAtras ? matriz[j * b + i] : matriz[i * b + j];
+            if (static_cast<int>(j) != i && costo != std::numeric_limits<int>::max()) visitar(frontera[j], costo);
+        }
+    }
+    const std::vector<int>& inicioLista = haciaAtras ? grafo.inicioEntrantes : grafo.inicioVecinos;
+    const std::vector<int>& lista = haciaAtras ? grafo.entrantes : grafo.vecinos;
+    const std::vector<int>& metros = haciaAtras ? grafo.metrosEntrantes : grafo.metros;
+    for (int k = inicioLista[u]; k < inicioLista[u + 1]; ++k) {
+        int w = lista[k];
+        if (nivel > 0 && vista.particion.celdaDe[nivel][w] == vista.particion.celdaDe[nivel][u]) continue;
+        visitar(w, metros[k] + vista.atracciones[haciaAtras ? u : w].tiempo_espera);
+    }
+}
+
+// Etiquetas de las búsquedas dentro de una celda, una por nivel para poder desplegar tramos de forma recursiva
+thread_local EtiquetasBusqueda etiquetasCeldaCRP[MAX_NIVELES_CRP];
+
+// Función para buscar desde origen en el nivel dado sin salir de la celda `celda` del nivel + 1
+// Termina al asentar destino o, si destino es -1, al asentar todas las fronteras de la celda
+void dijkstraEnCelda(const VistaCRP& vista, int nivel, int celda, int origen, int destino, EtiquetasBusqueda& etiquetas) {
+    const ParticionCRP& particion = vista.particion;
+    const std::vector<int>& celdaDe = particion.celdaDe[nivel + 1];
+    int pendientes = destino == -1 ? static_cast<int>(particion.celdas[nivel + 1][celda].frontera.size()) : 1;
+    typedef std::pair<int, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+    nuevaRonda(etiquetas, vista.grafo.numNodos);
+    etiquetar(etiquetas, origen, 0, -1);
+    cola.push({0, origen});
+    while (!cola.empty() && pendientes > 0) {
+        int distanciaU = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        if (distanciaU > distanciaEtiqueta(etiquetas, u)) continue;
+        if (destino == -1 ? particion.posicionFrontera[nivel + 1][u] != -1 : u == destino) --pendientes;
+        arcosEnNivel(vista, u, nivel, false, [&](int w, int costo) {
+            if (celdaDe[w] != celda) return;
+            int distanciaW = distanciaU + costo;
+            if (distanciaW < distanciaEtiqueta(etiquetas, w)) {
+                etiquetar(etiquetas, w, distanciaW, u);
+                cola.push({distanciaW, w});
+            }
+        });
+    }
+}
+
+// Función para personalizar la métrica con los tiempos de espera actuales
+// Sin anterior se calculan todas las celdas; con anterior solo las que contienen algún nodo de cambiados, y el resto se comparte.
+// Cada nivel usa las matrices ya actualizadas del nivel de abajo; dentro de un nivel, cada fila de cada celda es independiente.
+std::shared_ptr<const MetricaCRP> personalizarMetrica(const Grafo& grafo, const ParticionCRP& particion, const std::vector<Atraccion>& atracciones,
+                                                      const MetricaCRP* anterior, const std::vector<int>& cambiados) {
+    CronometroEtapa cronometro(ETAPA_PERSONALIZACION);
+    auto metrica = std::make_shared<MetricaCRP>();
+    if (anterior) {
+        metrica->matrices = anterior->matrices;
+    } else {
+        metrica->matrices.resize(particion.numNiveles + 1);
+        for (int nivel = 1; nivel <= particion.numNiveles; ++nivel) metrica->matrices[nivel].resize(particion.celdas[nivel].size());
+    }
+    VistaCRP vista{grafo, atracciones, particion, *metrica};
+    unsigned numHilos = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int nivel = 1; nivel <= particion.numNiveles; ++nivel) {
+        std::vector<int> celdas;
+        if (anterior) {
+            for (int v : cambiados) celdas.push_back(particion.celdaDe[nivel][v]);
+            std::sort(celdas.begin(), celdas.end());
+            celdas.erase(std::unique(celdas.begin(), celdas.end()), celdas.end());
+        } else {
+            for (int c = 0; c < static_cast<int>(particion.celdas[nivel].size()); ++c) celdas.push_back(c);
+        }
+
+        // Una tarea por fila: (celda, frontera de salida)
+        std::vector<std::shared_ptr<std::vector<int>>> nuevas(celdas.size());
+        std::vector<std::pair<int, int>> filas;
+        for (std::size_t i = 0; i < celdas.size(); ++i) {
+            std::size_t b = particion.celdas[nivel][celdas[i]].frontera.size();
+            nuevas[i] = std::make_shared<std::vector<int>>(b * b, std::numeric_limits<int>::max());
+            for (std::size_t fila = 0; fila < b; ++fila) filas.push_back({static_cast<int>(i), static_cast<int>(fila)});
+        }
+        paraCadaEnParalelo(filas.size(), numHilos, [&](std::size_t t) {
+            int c = celdas[filas[t].first];
+            int fila = filas[t].second;
+            const std::vector<int>& frontera = particion.celdas[nivel][c].frontera;
+            EtiquetasBusqueda& etiquetas = etiquetasCeldaCRP[nivel - 1];
+            dijkstraEnCelda(vista, nivel - 1, c, frontera[fila], -1, etiquetas);
+            std::vector<int>& matriz = *nuevas[filas[t].first];
+            for (std::size_t j = 0; j < frontera.size(); ++j) {
+                matriz[fila * frontera.size() + j] = distanciaEtiqueta(etiquetas, frontera[j]);
+            }
+        });
+        for (std::size_t i = 0; i < celdas.size(); ++i) metrica->matrices[nivel][celdas[i]] = std::move(nuevas[i]);
+    }
+    return metrica;
+}
+
+// Función para preparar la partición y la métrica de un modelo nuevo a partir del anterior (nullptr al cargar)
+// Si el grafo no cambió se reutiliza la partición y solo se personalizan las celdas de las atracciones con otra espera
+void prepararCRP(ModeloParque& modelo, const ModeloParque* anterior) {
+    if (!crpAlCargar) return;
+    const Grafo& grafo = *modelo.grafo;
+    if (grafo.numNodos == 0 || modelo.atracciones.size() < static_cast<std::size_t>(grafo.numNodos)) {
+        modelo.particion = nullptr;
+        modelo.metrica = nullptr;
+        return;
+    }
+    bool mismoGrafo = anterior && anterior->grafo == modelo.grafo && anterior->particion && anterior->metrica;
+    if (!mismoGrafo) {
+        modelo.particion = particionarGrafo(grafo);
+        modelo.metrica = personalizarMetrica(grafo, *modelo.particion, modelo.atracciones, nullptr, {});
+        return;
+    }
+    std::vector<int> cambiados;
+    for (int v = 0; v < grafo.numNodos; ++v) {
+        if (modelo.atracciones[v].tiempo_espera != anterior->atracciones[v].tiempo_espera) cambiados.push_back(v);
+    }
+    modelo.particion = anterior->particion;
+    modelo.metrica = cambiados.empty() ? anterior->metrica : personalizarMetrica(grafo, *modelo.particion, modelo.atracciones, anterior->metrica.get(), cambiados);
+}
+
+// Función para desplegar el tramo a -> b de la matriz de la celda (nivel, celda) en nodos del Grafo (agrega b, no a)
+void desplegarTramoCRP(const VistaCRP& vista, int nivel, int celda, int a, int b, std::vector<int>& ruta) {
+    EtiquetasBusqueda& etiquetas = etiquetasCeldaCRP[nivel - 1];
+    dijkstraEnCelda(vista, nivel - 1, celda, a, b, etiquetas);
+    std::vector<int> camino;
+    for (int nodo = b; nodo != -1; nodo = etiquetas.previo[nodo]) camino.push_back(nodo);
+    std::reverse(camino.begin(), camino.end());
+    for (std::size_t i = 1; i < camino.size(); ++i) {
+        int x = camino[i - 1], y = camino[i];
+        if (nivel - 1 > 0 && vista.particion.celdaDe[nivel - 1][x] == vista.particion.celdaDe[nivel - 1][y]) {
+            desplegarTramoCRP(vista, nivel - 1, vista.particion.celdaDe[nivel - 1][x], x, y, ruta);
+        } else {
+            ruta.push_back(y + 1);
+        }
+    }
+}
+
+// Función para buscar la ruta más corta entre dos nodos con la partición y la métrica del modelo (mismo costo que dijkstra)
+// Cada nodo se expande en el nivel más alto en el que su celda no contiene ni al inicio ni al destino.
+RutaPuntoAPunto consultarCRP(const ModeloParque& modelo, int inicio, int destino, bool desplegar) {
+    CronometroEtapa cronometro(ETAPA_PUNTO_A_PUNTO);
+    RutaPuntoAPunto resultado;
+    if (inicio == destino) {
+        resultado.distancia = 0;
+        resultado.ruta = {inicio + 1};
+        return resultado;
+    }
+    VistaCRP vista{*modelo.grafo, modelo.atracciones, *modelo.particion, *modelo.metrica};
+    const ParticionCRP& particion = *modelo.particion;
+    auto nivelDe = [&](int u) {
+        for (int nivel = particion.numNiveles; nivel > 0; --nivel) {
+            int celda = particion.celdaDe[nivel][u];
+            if (celda != particion.celdaDe[nivel][inicio] && celda != particion.celdaDe[nivel][destino]) return nivel;
+        }
+        return 0;
+    };
+
+    typedef std::pair<int, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> colaAdelante;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> colaAtras;
+    EtiquetasBusqueda& adelante = etiquetasHaciaAdelante;
+    EtiquetasBusqueda& atras = etiquetasHaciaAtras;
+    nuevaRonda(adelante, modelo.grafo->numNodos);
+    nuevaRonda(atras, modelo.grafo->numNodos);
+    etiquetar(adelante, inicio, 0, -1);
+    etiquetar(atras, destino, 0, -1);
+    colaAdelante.push({0, inicio});
+    colaAtras.push({0, destino});
+
+    long long mejor = std::numeric_limits<long long>::max();
+    int encuentro = -1;
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 2;
+    std::uint64_t extracciones = 0;
+
+    while (!colaAdelante.empty() && !colaAtras.empty()) {
+        if (static_cast<long long>(colaAdelante.top().first) + colaAtras.top().first >= mejor) break;
+        bool haciaAdelante = colaAdelante.top().first <= colaAtras.top().first;
+        auto& cola = haciaAdelante ? colaAdelante : colaAtras;
+        EtiquetasBusqueda& propias = haciaAdelante ? adelante : atras;
+        EtiquetasBusqueda& otras = haciaAdelante ? atras : adelante;
+        int distanciaU = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        if (distanciaU > distanciaEtiqueta(propias, u)) continue;
+        ++resultado.asentados;
+
+        int distanciaOtra = distanciaEtiqueta(otras, u);
+        if (distanciaOtra != std::numeric_limits<int>::max() && static_cast<long long>(distanciaU) + distanciaOtra < mejor) {
+            mejor = static_cast<long long>(distanciaU) + distanciaOtra;
+            encuentro = u;
+        }
+        arcosEnNivel(vista, u, nivelDe(u), !haciaAdelante, [&](int w, int costo) {
+            ++relajadas;
+            int distanciaW = distanciaU + costo;
+            if (distanciaW < distanciaEtiqueta(propias, w)) {
+                etiquetar(propias, w, distanciaW, u);
+                cola.push({distanciaW, w});
+                ++inserciones;
+            }
+        });
+    }
+    sumarContadoresBusqueda(resultado.asentados, relajadas, inserciones, extracciones);
+
+    if (encuentro == -1) return resultado;
+    resultado.distancia = static_cast<int>(mejor);
+    if (!desplegar) return resultado;
+
+    // Un arco entre dos nodos de la misma celda del nivel en que se expandió es un tramo de matriz; si no, una arista del Grafo
+    auto agregarArco = [&](int desde, int hasta, int nivel) {
+        if (nivel > 0 && particion.celdaDe[nivel][desde] == particion.celdaDe[nivel][hasta]) {
+            desplegarTramoCRP(vista, nivel, particion.celdaDe[nivel][desde], desde, hasta, resultado.ruta);
+        } else {
+            resultado.ruta.push_back(hasta + 1);
+        }
+    };
+    std::vector<int> ida;
+    for (int nodo = encuentro; nodo != -1; nodo = adelante.previo[nodo]) ida.push_back(nodo);
+    std::reverse(ida.begin(), ida.end());
+    resultado.ruta.push_back(inicio + 1);
+    for (std::size_t i = 1; i < ida.size(); ++i) agregarArco(ida[i - 1], ida[i], nivelDe(ida[i - 1]));
+    for (int nodo = encuentro; atras.previo[nodo] != -1; nodo = atras.previo[nodo]) {
+        int siguiente = atras.previo[nodo];
+        agregarArco(nodo, siguiente, nivelDe(siguiente));
+    }
+    return resultado;
+}
+
+//-------------------------------------------------------------
+
+// Optimizador de recorridos: orden de visita de las atracciones elegidas que minimiza el costo total
+// (mismo costo que dijkstra: metros más tiempo de espera), empezando en inicio y sin volver.
+// Las búsquedas desde cada parada y las búsquedas locales se reparten como subtareas en el planificador.
+
+struct Recorrido {
+    std::vector<int> orden;  // Identificadores de las paradas en orden de visita (sin el inicio)
+    long long costo = -1;    // -1 si alguna parada es inalcanzable
+    std::vector<int> ruta;   // Identificadores de todos los nodos recorridos, incluido el inicio
+};
+
+const long long COSTO_INALCANZABLE = 1000000000000LL;
+
+// Costo del recorrido que visita las paradas en el orden dado (posición 0 = inicio)
+long long costoOrden(const std::vector<std::vector<long long>>& costos, const std::vector<int>& orden) {
+    long long total = 0;
+    for (std::size_t i = 1; i < orden.size(); ++i) {
+        total += costos[orden[i - 1]][orden[i]];
+    }
+    return total;
+}
+
+// Orden exacto por programación dinámica (Held-Karp) para pocos destinos
+std::vector<int> ordenExacto(const std::vector<std::vector<long long>>& costos) {
+    int m = static_cast<int>(costos.size()) - 1;
+    std::vector<int> orden = {0};
+    if (m <= 0) return orden;
+    int completos = 1 << m;
+    std::vector<long long> mejor(static_cast<std::size_t>(completos) * m, std::numeric_limits<long long>::max());
+    std::vector<int> anterior(static_cast<std::size_t>(completos) * m, -1);
+    for (int j = 0; j < m; ++j) {
+        mejor[(std::size_t(1) << j) * m + j] = costos[0][j + 1];
+    }
+    for (int mascara = 1; mascara < completos; ++mascara) {
+        for (int j = 0; j < m; ++j) {
+            long long actual = mejor[std::size_t(mascara) * m + j];
+            if (!(mascara >> j & 1) || actual == std::numeric_limits<long long>::max()) continue;
+            for (int siguiente = 0; siguiente < m; ++siguiente) {
+                if (mascara >> siguiente & 1) continue;
+                int nueva = mascara | (1 << siguiente);
+                long long costo = actual + costos[j + 1][siguiente + 1];
+                if (costo < mejor[std::size_t(nueva) * m + siguiente]) {
+                    mejor[std::size_t(nueva) * m + siguiente] = costo;
+                    anterior[std::size_t(nueva) * m + siguiente] = j;
+                }
+            }
+        }
+    }
+    int ultimo = 0;
+    for (int j = 1; j < m; ++j) {
+        if (mejor[std::size_t(completos - 1) * m + j] < mejor[std::size_t(completos - 1) * m + ultimo]) ultimo = j;
+    }
+    std::vector<int> reverso;
+    for (int mascara = completos - 1; ultimo != -1;) {
+        reverso.push_back(ultimo + 1);
+        int previo = anterior[std::size_t(mascara) * m + ultimo];
+        mascara &= ~(1 << ultimo);
+        ultimo = previo;
+    }
+    orden.insert(orden.end(), reverso.rbegin(), reverso.rend());
+    return orden;
+}
+
+// Vecino más cercano; con semilla distinta de cero, cada paso elige al azar entre los dos más cercanos
+std::vector<int> ordenVecinoCercano(const std::vector<std::vector<long long>>& costos, std::uint64_t semilla) {
+    int k = static_cast<int>(costos.size());
+    std::vector<int> orden = {0};
+    std::vector<bool> visitada(k, false);
+    visitada[0] = true;
+    for (int paso = 1; paso < k; ++paso) {
+        int actual = orden.back();
+        int primero = -1, segundo = -1;
+        for (int j = 0; j < k; ++j) {
+            if (visitada[j]) continue;
+            if (primero == -1 || costos[actual][j] < costos[actual][primero]) {
+                segundo = primero;
+                primero = j;
+            } else if (segundo == -1 || costos[actual][j] < costos[actual][segundo]) {
+                segundo = j;
+            }
+        }
+        int elegido = primero;
+        if (semilla && segundo != -1) {
+            semilla ^= semilla << 13;
+            semilla ^= semilla >> 7;
+            semilla ^= semilla << 17;
+            if (semilla & 1) elegido = segundo;
+        }
+        visitada[elegido] = true;
+        orden.push_back(elegido);
+    }
+    return orden;
+}
+
+// Búsqueda local con 2-opt (costos asimétricos, evaluados con sumas prefijas) y reubicación de paradas
+void mejorarOrden(const std::vector<std::vector<long long>>& costos, std::vector<int>& orden) {
+    int m = static_cast<int>(orden.size());
+    bool mejoro = true;
+    while (mejoro) {
+        mejoro = false;
+        std::vector<long long> ida(m, 0), vuelta(m, 0);
+        for (int x = 1; x < m; ++x) {
+            ida[x] = ida[x - 1] + costos[orden[x - 1]][orden[x]];
+            vuelta[x] = vuelta[x - 1] + costos[orden[x]][orden[x - 1]];
+        }
+        for (int i = 1; i < m && !mejoro; ++i) {
+            for (int j = i + 1; j < m && !mejoro; ++j) {
+                long long antes = costos[orden[i - 1]][orden[i]] + (ida[j] - ida[i]) + (j + 1 < m ? costos[orden[j]][orden[j + 1]] : 0);
+                long long despues = costos[orden[i - 1]][orden[j]] + (vuelta[j] - vuelta[i]) + (j + 1 < m ? costos[orden[i]][orden[j + 1]] : 0);
+                if (despues < antes) {
+                    std::reverse(orden.begin() + i, orden.begin() + j + 1);
+                    mejoro = true;
+                }
+            }
+        }
+        for (int i = 1; i < m && !mejoro; ++i) {
+            long long quitar = costos[orden[i - 1]][orden[i]] +
+                               (i + 1 < m ? costos[orden[i]][orden[i + 1]] - costos[orden[i - 1]][orden[i + 1]] : 0);
+            for (int j = 0; j < m && !mejoro; ++j) {
+                if (j == i || j == i - 1) continue;
+                long long poner = costos[orden[j]][orden[i]] +
+                                  (j + 1 < m ? costos[orden[i]][orden[j + 1]] - costos[orden[j]][orden[j + 1]] : 0);
+                if (poner < quitar) {
+                    int parada = orden[i];
+                    orden.erase(orden.begin() + i);
+                    orden.insert(orden.begin() + (j < i ? j + 1 : j), parada);
+                    mejoro = true;
+                }
+            }
+        }
+    }
+}
+
+Recorrido optimizarRecorrido(const ModeloParque& modelo, int inicio_id, const std::vector<int>& destinos, PlanificadorTareas& planificador) {
+    CronometroEtapa cronometro(ETAPA_RECORRIDO);
+    // Paradas: el inicio y cada destino distinto, como índices de nodo
+    std::vector<int> paradas = {inicio_id - 1};
+    for (int id : destinos) {
+        if (std::find(paradas.begin(), paradas.end(), id - 1) == paradas.end()) paradas.push_back(id - 1);
+    }
+    int k = static_cast<int>(paradas.size());
+
+    // Matriz de costos entre paradas: una búsqueda por parada, en paralelo
+    // Con jerarquía de contracción o CRP son k consultas punto a punto por parada, mucho más baratas que recorrer todo el parque
+    bool conPreproceso = modelo.jerarquia || modelo.metrica;
+    auto consultar = [&](int desde, int hasta, bool desplegar) {
+        return modelo.jerarquia ? consultarJerarquia(*modelo.jerarquia, desde, hasta, desplegar) : consultarCRP(modelo, desde, hasta, desplegar);
+    };
+    std::vector<std::vector<long long>> costos(k, std::vector<long long>(k, 0));
+    GrupoTareas busquedas;
+    for (int i = 0; i < k; ++i) {
+        lanzarEnGrupo(planificador, busquedas, [&, i]() {
+            if (conPreproceso) {
+                for (int j = 0; j < k; ++j) {
+                    int d = consultar(paradas[i], paradas[j], false).distancia;
+                    costos[i][j] = d == std::numeric_limits<int>::max() ? COSTO_INALCANZABLE : d;
+                }
+                return;
+            }
+            std::vector<int> distancia, previo;
+            dijkstraDesde(*modelo.grafo, paradas[i], modelo.atracciones, distancia, previo);
+            for (int j = 0; j < k; ++j) {
+                int d = distancia[paradas[j]];
+                costos[i][j] = d == std::numeric_limits<int>::max() ? COSTO_INALCANZABLE : d;
+            }
+        });
+    }
+    esperarGrupo(planificador, busquedas);
+
+    // Orden de visita: exacto con pocos destinos, búsqueda local con varios arranques en paralelo si no
+    std::vector<int> orden;
+    if (k - 1 <= 12) {
+        orden = ordenExacto(costos);
+    } else {
+        int arranques = static_cast<int>(std::max<std::size_t>(4, 2 * planificador.colas.size()));
+        std::vector<std::vector<int>> candidatos(arranques);
+        GrupoTareas locales;
+        for (int a = 0; a < arranques; ++a) {
+            lanzarEnGrupo(planificador, locales, [&, a]() {
+                candidatos[a] = ordenVecinoCercano(costos, a == 0 ? 0 : 0x9E3779B97F4A7C15ULL * a);
+                mejorarOrden(costos, candidatos[a]);
+            });
+        }
+        esperarGrupo(planificador, locales);
+        orden = candidatos[0];
+        for (const auto& candidato : candidatos) {
+            if (costoOrden(costos, candidato) < costoOrden(costos, orden)) orden = candidato;
+        }
+    }
+
+    Recorrido recorrido;
+    long long total = costoOrden(costos, orden);
+    recorrido.costo = total >= COSTO_INALCANZABLE ? -1 : total;
+    for (std::size_t i = 1; i < orden.size(); ++i) {
+        recorrido.orden.push_back(paradas[orden[i]] + 1);
+    }
+
+    // Ruta completa: camino más corto entre cada par de paradas consecutivas, también en paralelo
+    std::vector<std::vector<int>> tramos(orden.size());
+    GrupoTareas caminos;
+    for (std::size_t i = 1; i < orden.size(); ++i) {
+        lanzarEnGrupo(planificador, caminos, [&, i]() {
+            if (conPreproceso) {
+                std::vector<int> ruta = consultar(paradas[orden[i - 1]], paradas[orden[i]], true).ruta;
+                if (!ruta.empty()) tramos[i].assign(ruta.begin() + 1, ruta.end());
+                return;
+            }
+            std::vector<int> distancia, previo;
+            dijkstraDesde(*modelo.grafo, paradas[orden[i - 1]], modelo.atracciones, distancia, previo);
+            for (int nodo = paradas[orden[i]]; nodo != -1 && nodo != paradas[orden[i - 1]]; nodo = previo[nodo]) {
+                tramos[i].push_back(nodo + 1);
+            }
+            std::reverse(tramos[i].begin(), tramos[i].end());
+        });
+    }
+    esperarGrupo(planificador, caminos);
+    recorrido.ruta.push_back(inicio_id);
+    for (const auto& tramo : tramos) {
+        recorrido.ruta.insert(recorrido.ruta.end(), tramo.begin(), tramo.end());
+    }
+    return recorrido;
+}
+
+//-------------------------------------------------------------
+
+// Rutas dependientes de la hora: el costo de llegar a una atracción es el tiempo de caminata más la espera
+// prevista para la hora a la que se llega (perfiles de espera del modelo). Todo en segundos desde la medianoche.
+// Con los perfiles corregidos al cargar, salir más tarde nunca llega antes, así que Dijkstra sobre la hora de
+// llegada sigue siendo exacto.
+
+const int VELOCIDAD_METROS_POR_MINUTO = 67; // Unos 4 km/h caminando entre atracciones
+
+int segundosCaminando(int metros) {
+    return metros * 60 / VELOCIDAD_METROS_POR_MINUTO;
+}
+
+// Función para calcular en etiquetas la hora en que termina la espera en cada nodo saliendo de inicio a horaSalida
+// Se detiene al asentar destino (-1 para ninguno) o al pasar horaLimite; las etiquetas hasta horaLimite son exactas
+void horasDeLlegada(const Grafo& grafo, const std::vector<Atraccion>& atracciones, const PerfilesEspera* perfiles,
+                    int inicio, int horaSalida, int destino, int horaLimite, EtiquetasBusqueda& etiquetas, std::uint64_t& asentados) {
+    nuevaRonda(etiquetas, grafo.numNodos);
+    typedef std::pair<int, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+    etiquetar(etiquetas, inicio, horaSalida, -1);
+    cola.push({horaSalida, inicio});
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 1;
+    std::uint64_t extracciones = 0;
+
+    while (!cola.empty()) {
+        int horaU = cola.top().first;
+        int u = cola.top().second;
+        if (horaU > horaLimite) break;
+        cola.pop();
+        ++extracciones;
+        if (horaU > distanciaEtiqueta(etiquetas, u)) continue;
+        ++asentados;
+        if (u == destino) break;
+        for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            ++relajadas;
+            int llegada = horaU + segundosCaminando(grafo.metros[k]);
+            int horaV = llegada + esperaEnSegundos(perfiles, atracciones, v, llegada);
+            if (horaV < distanciaEtiqueta(etiquetas, v)) {
+                etiquetar(etiquetas, v, horaV, u);
+                cola.push({horaV, v});
+                ++inserciones;
+            }
+        }
+    }
+    sumarContadoresBusqueda(asentados, relajadas, inserciones, extracciones);
+}
+
+// Función para buscar la ruta que termina antes la espera en destino saliendo de inicio a la hora dada
+// La distancia del resultado es esa hora (en segundos desde la medianoche); sin perfiles se usan las esperas fijas
+RutaPuntoAPunto rutaDependienteDeHora(const Grafo& grafo, const std::vector<Atraccion>& atracciones, const PerfilesEspera* perfiles,
+                                      int inicio, int destino, int horaSalida) {
+    CronometroEtapa cronometro(ETAPA_PUNTO_A_PUNTO);
+    RutaPuntoAPunto resultado;
+    EtiquetasBusqueda& etiquetas = etiquetasHaciaAdelante;
+    horasDeLlegada(grafo, atracciones, perfiles, inicio, horaSalida, destino, std::numeric_limits<int>::max(), etiquetas, resultado.asentados);
+    resultado.distancia = distanciaEtiqueta(etiquetas, destino);
+    if (resultado.distancia == std::numeric_limits<int>::max()) return resultado;
+    for (int nodo = destino; nodo != -1; nodo = etiquetas.previo[nodo]) resultado.ruta.push_back(nodo + 1);
+    std::reverse(resultado.ruta.begin(), resultado.ruta.end());
+    return resultado;
+}
+
+struct HorarioRecorrido {
+    std::vector<int> llegadas; // Hora en que termina la espera en cada parada, en el orden del recorrido
+    std::vector<int> ruta;     // Identificadores de todos los nodos recorridos, incluido el inicio
+    int fin = -1;              // -1 si alguna parada es inalcanzable
+};
+
+// Función para evaluar un orden de visita con las esperas de la hora de llegada a cada parada
+// Cada tramo sale a la hora en que terminó el anterior, así que se calculan uno detrás de otro
+HorarioRecorrido horarioRecorrido(const ModeloParque& modelo, int inicio_id, const std::vector<int>& orden, int horaSalida) {
+    HorarioRecorrido horario;
+    int hora = horaSalida;
+    int actual = inicio_id - 1;
+    horario.ruta.push_back(inicio_id);
+    for (int id : orden) {
+        RutaPuntoAPunto tramo = rutaDependienteDeHora(*modelo.grafo, modelo.atracciones, modelo.perfiles.get(), actual, id - 1, hora);
+        if (tramo.distancia == std::numeric_limits<int>::max()) return horario;
+        hora = tramo.distancia;
+        horario.llegadas.push_back(hora);
+        horario.ruta.insert(horario.ruta.end(), tramo.ruta.begin() + 1, tramo.ruta.end());
+        actual = id - 1;
+    }
+    horario.fin = hora;
+    return horario;
+}
+
+//-------------------------------------------------------------
+
+// Plan con tiempo disponible (orientación): la mayor cantidad de atracciones abiertas que se pueden visitar
+// desde el inicio en un presupuesto de minutos (caminata más esperas fijas), sin volver al inicio.
+// Candidatas: las más cercanas que se alcanzan dentro del presupuesto. Sobre la matriz de tiempos entre ellas,
+// con pocas candidatas se resuelve exacto; si no, una búsqueda en haz arma un primer itinerario y se mejora con
+// búsqueda local iterada (quitar algunas paradas, reordenar e insertar las más baratas) desde varias semillas fijas.
+// Cada arranque se corta tras unas iteraciones sin mejora; el plazo solo acota los casos grandes.
+
+const int MAX_CANDIDATAS_PLAN = 128;
+const std::size_t ANCHO_HAZ_PLAN = 64;
+const int MAX_PARADAS_PLAN_EXACTO = 12;
+const int ARRANQUES_PLAN = 4;
+const int MAX_ITERACIONES_SIN_MEJORA = 100;
+const int PLAZO_PLAN_MS = 20;
+const int MAX_PLAZO_PLAN_MS = 1000;
+int plazoPlanMs = PLAZO_PLAN_MS; // Plazo por defecto de --plazo-plan; cada consulta puede pedir otro
+
+struct PlanVisita {
+    std::vector<int> orden; // Identificadores de las paradas en orden de visita (sin el inicio)
+    int segundos = 0;       // Tiempo usado
+    std::vector<int> ruta;  // Identificadores de todos los nodos recorridos, incluido el inicio
+};
+
+// Un itinerario es mejor si visita más paradas o, con las mismas, usa menos tiempo
+bool planMejor(std::size_t paradasA, long long costoA, std::size_t paradasB, long long costoB) {
+    return paradasA != paradasB ? paradasA > paradasB : costoA < costoB;
+}
+
+// Búsqueda en haz: en cada nivel se extienden los itinerarios con una parada más y se quedan los más cortos,
+// uno solo por cada conjunto visitado y última parada
+std::vector<int> planEnHaz(const std::vector<std::vector<long long>>& costos, long long presupuesto) {
+    int k = static_cast<int>(costos.size());
+    struct Estado {
+        std::vector<int> orden;
+        ConjuntoAtracciones visitadas;
+        long long costo;
+    };
+    Estado inicial{{0}, crearConjunto(k), 0};
+    agregarAtraccion(inicial.visitadas, 0);
+    std::vector<Estado> haz = {inicial};
+    std::vector<int> mejor = {0};
+    while (true) {
+        // Extensiones como (estado, parada, costo) para copiar solo las que quedan en el haz
+        std::vector<std::tuple<long long, int, int>> extensiones;
+        for (int e = 0; e < static_cast<int>(haz.size()); ++e) {
+            for (int j = 1; j < k; ++j) {
+                if (contieneAtraccion(haz[e].visitadas, j)) continue;
+                long long costo = haz[e].costo + costos[haz[e].orden.back()][j];
+                if (costo <= presupuesto) extensiones.emplace_back(costo, e, j);
+            }
+        }
+        if (extensiones.empty()) break;
+        std::sort(extensiones.begin(), extensiones.end());
+        std::vector<Estado> siguiente;
+        std::unordered_set<std::string> vistos;
+        for (const auto& extension : extensiones) {
+            if (siguiente.size() == ANCHO_HAZ_PLAN) break;
+            const Estado& padre = haz[std::get<1>(extension)];
+            int parada = std::get<2>(extension);
+            Estado hijo{padre.orden, padre.visitadas, std::get<0>(extension)};
+            hijo.orden.push_back(parada);
+            agregarAtraccion(hijo.visitadas, parada);
+            std::string clave(reinterpret_cast<const char*>(hijo.visitadas.palabras.data()), hijo.visitadas.palabras.size() * sizeof(std::uint64_t));
+            clave.append(reinterpret_cast<const char*>(&parada), sizeof(parada));
+            if (!vistos.insert(clave).second) continue;
+            siguiente.push_back(std::move(hijo));
+        }
+        haz = std::move(siguiente);
+        mejor = haz.front().orden;
+    }
+    return mejor;
+}
+
+// Plan exacto por programación dinámica sobre (paradas visitadas, última parada); solo para pocas candidatas
+std::vector<int> planExacto(const std::vector<std::vector<long long>>& costos, long long presupuesto) {
+    int m = static_cast<int>(costos.size()) - 1; // Paradas sin contar el inicio (posición 0)
+    std::size_t estados = std::size_t(1) << m;
+    const long long SIN_COSTO = std::numeric_limits<long long>::max();
+    std::vector<long long> costo(estados * m, SIN_COSTO);
+    std::vector<int> previa(estados * m, -1); // Última parada del estado sin la actual; -1 es el inicio
+    for (int j = 0; j < m; ++j) {
+        if (costos[0][j + 1] <= presupuesto) costo[(std::size_t(1) << j) * m + j] = costos[0][j + 1];
+    }
+    std::size_t mejorVisitadas = 0;
+    int mejorUltima = -1;
+    long long costoMejor = 0;
+    // Agregar una parada agranda el número del conjunto, así que al recorrerlos en orden cada estado ya está completo
+    for (std::size_t visitadas = 1; visitadas < estados; ++visitadas) {
+        std::size_t cantidad = __builtin_popcountll(visitadas);
+        for (int ultima = 0; ultima < m; ++ultima) {
+            long long actual = costo[visitadas * m + ultima];
+            if (actual == SIN_COSTO) continue;
+            if (planMejor(cantidad, actual, mejorUltima == -1 ? 0 : __builtin_popcountll(mejorVisitadas), costoMejor)) {
+                mejorVisitadas = visitadas;
+                mejorUltima = ultima;
+                costoMejor = actual;
+            }
+            for (int j = 0; j < m; ++j) {
+                if (visitadas & (std::size_t(1) << j)) continue;
+                long long siguiente = actual + costos[ultima + 1][j + 1];
+                std::size_t estado = (visitadas | (std::size_t(1) << j)) * m + j;
+                if (siguiente <= presupuesto && siguiente < costo[estado]) {
+                    costo[estado] = siguiente;
+                    previa[estado] = ultima;
+                }
+            }
+        }
+    }
+    std::vector<int> orden;
+    for (int ultima = mejorUltima; ultima != -1;) {
+        orden.push_back(ultima + 1);
+        int anterior = previa[mejorVisitadas * m + ultima];
+        mejorVisitadas &= ~(std::size_t(1) << ultima);
+        ultima = anterior;
+    }
+    orden.push_back(0);
+    std::reverse(orden.begin(), orden.end());
+    return orden;
+}
+
+// Inserta la parada libre más barata mientras quepa en el presupuesto
+void insertarParadas(const std::vector<std::vector<long long>>& costos, long long presupuesto, std::vector<int>& orden) {
+    int k = static_cast<int>(costos.size());
+    std::vector<bool> usada(k, false);
+    for (int parada : orden) usada[parada] = true;
+    long long costo = costoOrden(costos, orden);
+    while (true) {
+        long long mejorAumento = std::numeric_limits<long long>::max();
+        int mejorParada = -1;
+        std::size_t mejorPosicion = 0;
+        for (int j = 1; j < k; ++j) {
+            if (usada[j]) continue;
+            for (std::size_t i = 0; i < orden.size(); ++i) {
+                long long aumento = costos[orden[i]][j] + (i + 1 < orden.size() ? costos[j][orden[i + 1]] - costos[orden[i]][orden[i + 1]] : 0);
+                if (aumento < mejorAumento) {
+                    mejorAumento = aumento;
+                    mejorParada = j;
+                    mejorPosicion = i + 1;
+                }
+            }
+        }
+        if (mejorParada == -1 || costo + mejorAumento > presupuesto) return;
+        orden.insert(orden.begin() + mejorPosicion, mejorParada);
+        usada[mejorParada] = true;
+        costo += mejorAumento;
+    }
+}
+
+// Función para planificar la visita desde inicio_id con los minutos disponibles; la búsqueda local termina a lo sumo
+// a los plazoMs milisegundos
+PlanVisita planificarVisita(const ModeloParque& modelo, int inicio_id, int minutos, int plazoMs, PlanificadorTareas& planificador) {
+    CronometroEtapa cronometro(ETAPA_PLAN);
+    const Grafo& grafo = *modelo.grafo;
+    const int presupuesto = minutos * 60;
+    int inicio = inicio_id - 1;
+    PlanVisita plan;
+    plan.ruta.push_back(inicio_id);
+
+    // Candidatas: atracciones abiertas alcanzables dentro del presupuesto, las más cercanas primero
+    std::vector<std::pair<int, int>> alcanzables;
+    {
+        std::uint64_t asentados = 0;
+        EtiquetasBusqueda& etiquetas = etiquetasHaciaAdelante;
+        horasDeLlegada(grafo, modelo.atracciones, nullptr, inicio, 0, -1, presupuesto, etiquetas, asentados);
+        for (int v = 0; v < grafo.numNodos; ++v) {
+            int segundos = distanciaEtiqueta(etiquetas, v);
+            if (v != inicio && segundos <= presupuesto && modelo.atracciones[v].abierta) alcanzables.push_back({segundos, v});
+        }
+    }
+    std::sort(alcanzables.begin(), alcanzables.end());
+    if (alcanzables.size() > static_cast<std::size_t>(MAX_CANDIDATAS_PLAN)) alcanzables.resize(MAX_CANDIDATAS_PLAN);
+    std::vector<int> paradas = {inicio};
+    for (const auto& alcanzable : alcanzables) paradas.push_back(alcanzable.second);
+    int k = static_cast<int>(paradas.size());
+    if (k == 1) return plan;
+
+    // Matriz de tiempos: una búsqueda acotada por el presupuesto desde cada parada, en paralelo
+    std::vector<std::vector<long long>> costos(k, std::vector<long long>(k, COSTO_INALCANZABLE));
+    GrupoTareas busquedas;
+    for (int i = 0; i < k; ++i) {
+        lanzarEnGrupo(planificador, busquedas, [&, i]() {
+            std::uint64_t asentados = 0;
+            EtiquetasBusqueda& etiquetas = etiquetasHaciaAdelante;
+            horasDeLlegada(grafo, modelo.atracciones, nullptr, paradas[i], 0, -1, presupuesto, etiquetas, asentados);
+            for (int j = 0; j < k; ++j) {
+                int segundos = distanciaEtiqueta(etiquetas, paradas[j]);
+                if (segundos <= presupuesto) costos[i][j] = segundos;
+            }
+        });
+    }
+    esperarGrupo(planificador, busquedas);
+
+    std::vector<int> mejor;
+    if (k - 1 <= MAX_PARADAS_PLAN_EXACTO) {
+        mejor = planExacto(costos, presupuesto);
+    } else {
+        // Primer itinerario en haz y búsqueda local desde él con ARRANQUES_PLAN semillas fijas. Cada arranque guarda
+        // su mejor itinerario y se reducen en orden de semilla, así el resultado no depende de la cantidad de hilos
+        // ni de su ritmo (salvo que se llegue al plazo). Se usan menos tareas que trabajadores para que un plan
+        // no ocupe todo el planificador.
+        std::vector<int> inicial = planEnHaz(costos, presupuesto);
+        std::vector<std::vector<int>> resultados(ARRANQUES_PLAN, inicial);
+        auto plazo = std::chrono::steady_clock::now() + std::chrono::milliseconds(plazoMs);
+        int tareas = std::min(ARRANQUES_PLAN, std::max(1, static_cast<int>(planificador.colas.size()) - 1));
+        GrupoTareas locales;
+        for (int t = 0; t < tareas; ++t) {
+            lanzarEnGrupo(planificador, locales, [&, t]() {
+                for (int a = t; a < ARRANQUES_PLAN; a += tareas) {
+                    std::mt19937_64 azar(0x9E3779B97F4A7C15ULL * (a + 1));
+                    std::vector<int>& mejorArranque = resultados[a];
+                    long long costoMejorArranque = costoOrden(costos, mejorArranque);
+                    std::vector<int> actual = inicial;
+                    int sinMejora = 0;
+                    while (sinMejora < MAX_ITERACIONES_SIN_MEJORA && std::chrono::steady_clock::now() < plazo) {
+                        ++sinMejora;
+                        std::vector<int> candidato = actual;
+                        // Perturbación: quitar un tramo corto de paradas
+                        if (candidato.size() > 1) {
+                            std::size_t largo = 1 + azar() % std::max<std::size_t>(1, (candidato.size() - 1) / 4);
+                            std::size_t desde = 1 + azar() % (candidato.size() - 1);
+                            candidato.erase(candidato.begin() + desde, candidato.begin() + std::min(candidato.size(), desde + largo));
+                        }
+                        mejorarOrden(costos, candidato);
+                        insertarParadas(costos, presupuesto, candidato);
+                        long long costoCandidato = costoOrden(costos, candidato);
+                        // Se acepta si no pierde paradas, así la búsqueda puede moverse entre itinerarios igual de largos
+                        if (costoCandidato > presupuesto || candidato.size() < actual.size()) continue;
+                        actual = std::move(candidato);
+                        if (planMejor(actual.size(), costoCandidato, mejorArranque.size(), costoMejorArranque)) {
+                            mejorArranque = actual;
+                            costoMejorArranque = costoCandidato;
+                            sinMejora = 0;
+                        }
+                    }
+                }
+            });
+        }
+        esperarGrupo(planificador, locales);
+        mejor = inicial;
+        for (const auto& resultado : resultados) {
+            if (planMejor(resultado.size(), costoOrden(costos, resultado), mejor.size(), costoOrden(costos, mejor))) mejor = resultado;
+        }
+    }
+
+    plan.segundos = static_cast<int>(costoOrden(costos, mejor));
+    for (std::size_t i = 1; i < mejor.size(); ++i) {
+        plan.orden.push_back(paradas[mejor[i]] + 1);
+        RutaPuntoAPunto tramo = rutaDependienteDeHora(grafo, modelo.atracciones, nullptr, paradas[mejor[i - 1]], paradas[mejor[i]], 0);
+        plan.ruta.insert(plan.ruta.end(), tramo.ruta.begin() + 1, tramo.ruta.end());
+    }
+    return plan;
+}
+
+//-------------------------------------------------------------
+
+// Rutas de Pareto entre caminar y hacer fila: en vez de sumar metros y minutos de espera en un solo costo,
+// cada etiqueta lleva los dos por separado y se devuelven todas las rutas que no son peores en ambos a la vez.
+// Con dos búsquedas hacia atrás desde el destino se tienen cotas inferiores de los metros y de la espera que faltan.
+// Las etiquetas salen de la cola en orden lexicográfico (metros más su cota, espera), así que las ya asentadas en un
+// nodo tienen a lo sumo los mismos metros, y las del destino a lo sumo los metros más la cota: una etiqueta está
+// dominada si su espera no es menor que la mínima asentada en el nodo, o si su espera más la cota no es menor que
+// la mínima del destino. Basta guardar esa espera mínima por nodo.
+// El conjunto exacto puede tener cientos de rutas que difieren en un minuto de fila, así que por defecto se
+// descartan también las etiquetas que no mejoran la espera mínima en más de una tolerancia relativa: las rutas
+// devueltas se separan al menos en ese porcentaje y cada ruta de Pareto omitida queda cerca de alguna de ellas.
+
+const int TOLERANCIA_PARETO_POR_CIENTO = 5;
+
+struct EtiquetaPareto {
+    int metros;
+    int espera;
+    int nodo;
+    int padre; // Índice de la etiqueta anterior en el depósito, -1 en el inicio
+};
+
+struct RutaPareto {
+    int metros;
+    int espera;
+    std::vector<int> ruta; // Identificadores desde el inicio hasta el destino
+};
+
+struct ResultadoPareto {
+    std::vector<RutaPareto> rutas; // De menos metros a menos espera
+    std::size_t etiquetas = 0;     // Etiquetas creadas durante la búsqueda
+};
+
+// Función para calcular la menor espera acumulada desde cada nodo hasta destino (por las aristas entrantes)
+void esperaHasta(const Grafo& grafo, const std::vector<Atraccion>& atracciones, int destino, std::vector<int>& espera) {
+    espera.assign(grafo.numNodos, std::numeric_limits<int>::max());
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> pq;
+    espera[destino] = 0;
+    pq.push({0, destino});
+    while (!pq.empty()) {
+        int d = pq.top().first;
+        int v = pq.top().second;
+        pq.pop();
+        if (d > espera[v]) continue;
+        int conEspera = d + atracciones[v].tiempo_espera;
+        for (int k = grafo.inicioEntrantes[v]; k < grafo.inicioEntrantes[v + 1]; ++k) {
+            int u = grafo.entrantes[k];
+            if (conEspera < espera[u]) {
+                espera[u] = conEspera;
+                pq.push({conEspera, u});
+            }
+        }
+    }
+}
+
+// Función para buscar el conjunto de Pareto de rutas (metros, minutos de espera) de inicio a destino
+// Con tolerancia 0 el conjunto es exacto
+ResultadoPareto rutasPareto(const Grafo& grafo, const std::vector<Atraccion>& atracciones, int inicio, int destino, int toleranciaPorCiento) {
+    CronometroEtapa cronometro(ETAPA_PARETO);
+    ResultadoPareto resultado;
+    std::vector<int> cotaMetros;
+    std::vector<int> cotaEspera;
+    metrosDesde(grafo, destino, true, cotaMetros);
+    esperaHasta(grafo, atracciones, destino, cotaEspera);
+    if (cotaMetros[inicio] == std::numeric_limits<int>::max()) return resultado;
+
+    // La espera mínima asentada de cada nodo se guarda como distancia de las etiquetas reutilizables del hilo
+    EtiquetasBusqueda& minimas = etiquetasHaciaAdelante;
+    nuevaRonda(minimas, grafo.numNodos);
+    std::vector<EtiquetaPareto> deposito = {{0, 0, inicio, -1}};
+    typedef std::pair<std::uint64_t, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+    auto clave = [](long long metros, int espera) { return static_cast<std::uint64_t>(metros) << 32 | static_cast<std::uint32_t>(espera); };
+    cola.push({clave(cotaMetros[inicio], 0), 0});
+    std::uint64_t asentados = 0;
+    std::uint64_t relajadas = 0;
+    std::uint64_t extracciones = 0;
+    // Una espera está dominada si, con la tolerancia, no es menor que la mínima asentada
+    auto dominada = [&minimas, toleranciaPorCiento](long long espera, int nodo) {
+        return espera * (100 + toleranciaPorCiento) >= static_cast<long long>(distanciaEtiqueta(minimas, nodo)) * 100;
+    };
+
+    while (!cola.empty()) {
+        int indice = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        EtiquetaPareto etiqueta = deposito[indice];
+        if (dominada(etiqueta.espera, etiqueta.nodo) || dominada(static_cast<long long>(etiqueta.espera) + cotaEspera[etiqueta.nodo], destino)) continue;
+        etiquetar(minimas, etiqueta.nodo, etiqueta.espera, -1);
+        ++asentados;
+        if (etiqueta.nodo == destino) {
+            RutaPareto ruta{etiqueta.metros, etiqueta.espera, {}};
+            for (int k = indice; k != -1; k = deposito[k].padre) ruta.ruta.push_back(deposito[k].nodo + 1);
+            std::reverse(ruta.ruta.begin(), ruta.ruta.end());
+            resultado.rutas.push_back(std::move(ruta));
+            continue;
+        }
+        for (int k = grafo.inicioVecinos[etiqueta.nodo]; k < grafo.inicioVecinos[etiqueta.nodo + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            ++relajadas;
+            if (cotaMetros[v] == std::numeric_limits<int>::max()) continue;
+            int espera = etiqueta.espera + atracciones[v].tiempo_espera;
+            if (dominada(espera, v) || dominada(static_cast<long long>(espera) + cotaEspera[v], destino)) continue;
+            int metros = etiqueta.metros + grafo.metros[k];
+            cola.push({clave(static_cast<long long>(metros) + cotaMetros[v], espera), static_cast<int>(deposito.size())});
+            deposito.push_back({metros, espera, v, indice});
+        }
+    }
+    resultado.etiquetas = deposito.size();
+    sumarContadoresBusqueda(asentados, relajadas, deposito.size(), extracciones);
+    return resultado;
+}
+
+//-------------------------------------------------------------
+
+// Rutas alternativas: las k rutas simples más cortas (Yen) o, más barato, las que salen de penalizar las aristas
+// ya usadas y volver a buscar. Una búsqueda hacia atrás desde el destino da el costo exacto que falta desde cada
+// nodo en el parque completo; como quitar nodos o encarecer aristas solo alarga las rutas, sirve de potencial A*
+// consistente para todas las búsquedas de la consulta, que así exploran poco más que el desvío.
+// En Yen, los desvíos desde cada nodo de la última ruta son independientes y se buscan en paralelo; cada
+// hilo reutiliza sus etiquetas de búsqueda y su conjunto de nodos excluidos.
+
+const int MAX_ALTERNATIVAS = 10;
+const int PENALIZACION_POR_CIENTO = 40;     // Aumento del costo de una arista por cada ruta que ya la usa
+const int MAX_RONDAS_POR_ALTERNATIVA = 3;   // Búsquedas con penalización por ruta pedida antes de rendirse
+
+struct RutaAlternativa {
+    int costo;
+    std::vector<int> nodos; // Nodos desde el inicio hasta el destino
+    int desvio = 0;         // Posición donde se separa de la ruta de la que salió (Yen)
+};
+
+thread_local EtiquetasBusqueda nodosExcluidos; // Marcados en la ronda actual: nodos de la raíz del desvío
+
+// Función para calcular el costo exacto de cada nodo hasta destino (por las aristas entrantes)
+void costoHastaDestino(const Grafo& grafo, const std::vector<Atraccion>& atracciones, int destino, std::vector<int>& costo) {
+    costo.assign(grafo.numNodos, std::numeric_limits<int>::max());
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> pq;
+    costo[destino] = 0;
+    pq.push({0, destino});
+    while (!pq.empty()) {
+        int d = pq.top().first;
+        int v = pq.top().second;
+        pq.pop();
+        if (d > costo[v]) continue;
+        for (int k = grafo.inicioEntrantes[v]; k < grafo.inicioEntrantes[v + 1]; ++k) {
+            int u = grafo.entrantes[k];
+            int candidato = d + grafo.metrosEntrantes[k] + atracciones[v].tiempo_espera;
+            if (candidato < costo[u]) {
+                costo[u] = candidato;
+                pq.push({candidato, u});
+            }
+        }
+    }
+}
+
+int costoArista(const Atraccion& atraccion, int metros, const std::unordered_map<int, int>* penalizaciones, int arista) {
+    int costo = metros + atraccion.tiempo_espera;
+    if (penalizaciones) {
+        auto it = penalizaciones->find(arista);
+        if (it != penalizaciones->end()) costo += static_cast<int>(static_cast<long long>(costo) * PENALIZACION_POR_CIENTO * it->second / 100);
+    }
+    return costo;
+}
+
+// Función para buscar con A* (potencial = cota) la ruta de origen a destino que evita los nodos excluidos del hilo
+// (si excluir) y las aristas de origen a los nodos bloqueados; devuelve el costo o max si no hay ruta
+int buscarDesvio(const Grafo& grafo, const std::vector<Atraccion>& atracciones, const std::vector<int>& cota, int origen, int destino,
+                 bool excluir, const std::vector<int>& bloqueados, const std::unordered_map<int, int>* penalizaciones,
+                 std::vector<int>& nodos, std::uint64_t& asentados) {
+    EtiquetasBusqueda& etiquetas = etiquetasHaciaAdelante;
+    nuevaRonda(etiquetas, grafo.numNodos);
+    typedef std::pair<long long, int> Entrada;
+    std::priority_queue<Entrada, std::vector<Entrada>, std::greater<Entrada>> cola;
+    etiquetar(etiquetas, origen, 0, -1);
+    cola.push({cota[origen], origen});
+    std::uint64_t relajadas = 0;
+    std::uint64_t inserciones = 1;
+    std::uint64_t extracciones = 0;
+    int resultado = std::numeric_limits<int>::max();
+
+    while (!cola.empty()) {
+        long long clave = cola.top().first;
+        int u = cola.top().second;
+        cola.pop();
+        ++extracciones;
+        int distanciaU = distanciaEtiqueta(etiquetas, u);
+        if (clave > static_cast<long long>(distanciaU) + cota[u]) continue;
+        ++asentados;
+        if (u == destino) {
+            resultado = distanciaU;
+            break;
+        }
+        for (int k = grafo.inicioVecinos[u]; k < grafo.inicioVecinos[u + 1]; ++k) {
+            int v = grafo.vecinos[k];
+            ++relajadas;
+            if (cota[v] == std::numeric_limits<int>::max()) continue;
+            if (excluir && nodosExcluidos.marca[v] == nodosExcluidos.ronda) continue;
+            if (u == origen && std::find(bloqueados.begin(), bloqueados.end(), v) != bloqueados.end()) continue;
+            int distanciaV = distanciaU + costoArista(atracciones[v], grafo.metros[k], penalizaciones, k);
+            if (distanciaV < distanciaEtiqueta(etiquetas, v)) {
+                etiquetar(etiquetas, v, distanciaV, u);
+                cola.push({static_cast<long long>(distanciaV) + cota[v], v});
+                ++inserciones;
+            }
+        }
+    }
+    sumarContadoresBusqueda(asentados, relajadas, inserciones, extracciones);
+    nodos.clear();
+    if (resultado == std::numeric_limits<int>::max()) return resultado;
+    for (int nodo = destino; nodo != -1; nodo = etiquetas.previo[nodo]) nodos.push_back(nodo);
+    std::reverse(nodos.begin(), nodos.end());
+    return resultado;
+}
+
+bool contieneRuta(const std::vector<RutaAlternativa>& rutas, const std::vector<int>& nodos) {
+    for (const auto& ruta : rutas) {
+        if (ruta.nodos == nodos) return true;
+    }
+    return false;
+}
+
+// Función para calcular las k rutas simples más cortas de inicio a destino (Yen, con el desvío de Lawler:
+// de cada ruta solo se buscan desvíos desde donde ella se separó de su madre)
+std::vector<RutaAlternativa> rutasAlternativasYen(const Grafo& grafo, const std::vector<Atraccion>& atracciones, int inicio, int destino, int k,
+                                                  PlanificadorTareas& planificador, std::uint64_t& asentados) {
+    CronometroEtapa cronometro(ETAPA_ALTERNATIVAS);
+    std::vector<RutaAlternativa> elegidas;
+    std::vector<int> cota;
+    costoHastaDestino(grafo, atracciones, destino, cota);
+    RutaAlternativa primera;
+    primera.costo = buscarDesvio(grafo, atracciones, cota, inicio, destino, false, {}, nullptr, primera.nodos, asentados);
+    if (primera.costo == std::numeric_limits<int>::max()) return elegidas;
+    elegidas.push_back(std::move(primera));
+
+    // Candidatas ordenadas por costo; basta guardar tantas como rutas faltan, las demás nunca se elegirían
+    std::vector<RutaAlternativa> candidatas;
+    while (static_cast<int>(elegidas.size()) < k) {
+        const RutaAlternativa& anterior = elegidas.back();
+        std::vector<int> prefijo(anterior.nodos.size(), 0);
+        for (std::size_t i = 1; i < anterior.nodos.size(); ++i) {
+            int u = anterior.nodos[i - 1];
+            int v = anterior.nodos[i];
+            int mejor = std::numeric_limits<int>::max();
+            for (int a = grafo.inicioVecinos[u]; a < grafo.inicioVecinos[u + 1]; ++a) {
+                if (grafo.vecinos[a] == v) mejor = std::min(mejor, grafo.metros[a] + atracciones[v].tiempo_espera);
+            }
+            prefijo[i] = prefijo[i - 1] + mejor;
+        }
+
+        int desde = anterior.desvio;
+        int hasta = static_cast<int>(anterior.nodos.size()) - 1;
+        std::vector<RutaAlternativa> desvios(std::max(0, hasta - desde));
+        std::vector<std::uint64_t> asentadosDesvio(desvios.size(), 0);
+        GrupoTareas grupo;
+        for (int i = desde; i < hasta; ++i) {
+            lanzarEnGrupo(planificador, grupo, [&, i]() {
+                // La raíz es anterior.nodos[0..i]; se excluyen sus nodos salvo el de desvío, y las aristas que
+                // toman desde él las rutas ya elegidas con la misma raíz
+                nuevaRonda(nodosExcluidos, grafo.numNodos);
+                for (int j = 0; j < i; ++j) etiquetar(nodosExcluidos, anterior.nodos[j], 0, -1);
+                std::vector<int> bloqueados;
+                for (const auto& ruta : elegidas) {
+                    if (static_cast<int>(ruta.nodos.size()) > i + 1 && std::equal(anterior.nodos.begin(), anterior.nodos.begin() + i + 1, ruta.nodos.begin())) {
+                        bloqueados.push_back(ruta.nodos[i + 1]);
+                    }
+                }
+                std::vector<int> tramo;
+                int costo = buscarDesvio(grafo, atracciones, cota, anterior.nodos[i], destino, true, bloqueados, nullptr, tramo, asentadosDesvio[i - desde]);
+                RutaAlternativa& desvio = desvios[i - desde];
+                desvio.costo = costo;
+                if (costo == std::numeric_limits<int>::max()) return;
+                desvio.costo = prefijo[i] + costo;
+                desvio.nodos.assign(anterior.nodos.begin(), anterior.nodos.begin() + i);
+                desvio.nodos.insert(desvio.nodos.end(), tramo.begin(), tramo.end());
+                desvio.desvio = i;
+            });
+        }
+        esperarGrupo(planificador, grupo);
+
+        std::size_t faltan = static_cast<std::size_t>(k) - elegidas.size();
+        for (std::size_t d = 0; d < desvios.size(); ++d) {
+            asentados += asentadosDesvio[d];
+            if (desvios[d].costo == std::numeric_limits<int>::max()) continue;
+            if (contieneRuta(elegidas, desvios[d].nodos) || contieneRuta(candidatas, desvios[d].nodos)) continue;
+            candidatas.push_back(std::move(desvios[d]));
+        }
+        std::sort(candidatas.begin(), candidatas.end(), [](const RutaAlternativa& a, const RutaAlternativa& b) {
+            return a.costo != b.costo ? a.costo < b.costo : a.nodos.size() < b.nodos.size();
+        });
+        if (candidatas.size() > faltan) candidatas.resize(faltan);
+        if (candidatas.empty()) break;
+        elegidas.push_back(std::move(candidatas.front()));
+        candidatas.erase(candidatas.begin());
+    }
+    return elegidas;
+}
+
+// Función para generar hasta k rutas distintas encareciendo las aristas de las rutas ya halladas
+// No garantiza que sean las k más cortas, pero cada ronda es una sola búsqueda A*
+std::vector<RutaAlternativa> rutasAlternativasPenalizadas(const Grafo& grafo, const std::vector<Atraccion>& atracciones, int inicio, int destino, int k,
+                                                          std::uint64_t& asentados) {
+    CronometroEtapa cronometro(ETAPA_ALTERNATIVAS);
+    std::vector<RutaAlternativa> rutas;
+    std::vector<int> cota;
+    costoHastaDestino(grafo, atracciones, destino, cota);
+    if (cota[inicio] == std::numeric_limits<int>::max()) return rutas;
+    std::unordered_map<int, int> penalizaciones;
+    std::vector<int> nodos;
+    for (int ronda = 0; ronda < k * MAX_RONDAS_POR_ALTERNATIVA && static_cast<int>(rutas.size()) < k; ++ronda) {
+        buscarDesvio(grafo, atracciones, cota, inicio, destino, false, {}, &penalizaciones, nodos, asentados);
+        // El costo real de la ruta, sin penalizaciones
+        RutaAlternativa ruta{0, nodos, 0};
+        for (std::size_t i = 1; i < nodos.size(); ++i) {
+            int u = nodos[i - 1];
+            int v = nodos[i];
+            int mejor = std::numeric_limits<int>::max();
+            for (int a = grafo.inicioVecinos[u]; a < grafo.inicioVecinos[u + 1]; ++a) {
+                if (grafo.vecinos[a] != v) continue;
+                mejor = std::min(mejor, grafo.metros[a] + atracciones[v].tiempo_espera);
+                ++penalizaciones[a];
+            }
+            ruta.costo += mejor;
+        }
+        if (!contieneRuta(rutas, ruta.nodos)) rutas.push_back(std::move(ruta));
+    }
+    std::sort(rutas.begin(), rutas.end(), [](const RutaAlternativa& a, const RutaAlternativa& b) { return a.costo < b.costo; });
+    return rutas;
+}
+
+
+//-------------------------------------------------------------
+
+// Función principal del menú de la aplicación
+
+void mostrarMenu() {
+    std::cout << "\n-----------------------------------------\n";
+    std::cout << "Bienvenido a C++ Kingdom\n";
+    std::cout << "\n-----------------------------------------\n";
+    std::cout << "1. Usar el arbol de decisiones\n";
+    std::cout << "2. Seleccion manual de atracciones\n";
+    std::cout << "3. Editar tiempo de espera\n";
+    std::cout << "4. Salir\n";
+    std::cout << "\n-----------------------------------------\n";
+    std::cout << "Seleccione una opcion: ";
+}
+
+//--------------------------------------------------------
+
+// Función para imprimir la ruta más eficiente
+
+void imprimirRuta(const std::vector<int>& ruta, const std::vector<Atraccion>& atracciones) {
+    CronometroEtapa cronometro(ETAPA_IMPRESION);
+    std::cout << " \n";
+    std::cout << "La ruta mas eficiente para realizar la visita es:\n";
+    for (int i = 0; i < ruta.size(); ++i) {
+        int id = ruta[i];
+        if (id >= 1 && id <= atracciones.size()) {
+            std::cout << "- Atraccion " << atracciones[id - 1].identificador << ": " << atracciones[id - 1].nombre << "\n";
+        }
+    }
+}
+
+//--------------------------------------------------------
+
+// Huella de los tiempos de espera y del estado abierto/cerrado (FNV-1a)
+// Si cambia, las rutas cacheadas en las hojas dejan de ser válidas
+
+std::uint64_t huellaEspera(const std::vector<Atraccion>& atracciones) {
+    std::uint64_t huella = 14695981039346656037ULL;
+    for (const auto& atraccion : atracciones) {
+        std::uint64_t valores[3] = {std::uint64_t(atraccion.identificador), std::uint64_t(atraccion.tiempo_espera), std::uint64_t(atraccion.abierta)};
+        for (std::uint64_t valor : valores) {
+            huella = (huella ^ valor) * 1099511628211ULL;
+        }
+    }
+    return huella;
+}
+
+//--------------------------------------------------------
+
+// Calcular la ruta de una lista de atracciones sugeridas, partiendo de la primera
+
+std::shared_ptr<const RutaHoja> calcularRutaHoja(const std::vector<int>& identificadores, const std::vector<Atraccion>& atracciones, const std::shared_ptr<const Grafo>& grafo, std::uint64_t huella) {
+    // Encontrar el índice en el vector de atracciones para el inicio (podría ser el primero de los identificadores sugeridos)
+    int inicio_indice = -1;
+    for (int i = 0; i < atracciones.size(); ++i) {
+        if (atracciones[i].identificador == identificadores[0]) {
+            inicio_indice = i;
+            break;
+        }
+    }
+
+    if (inicio_indice == -1) {
+        return nullptr;
+    }
+
+    auto ruta = std::make_shared<RutaHoja>();
+    ruta->grafo = grafo;
+    ruta->huellaEspera = huella;
+    ruta->seleccionadas = identificadores;
+    ruta->inicio_indice = inicio_indice;
+    dijkstraDesde(*grafo, inicio_indice, atracciones, ruta->distancias, ruta->previos);
+    ruta->esperas.resize(atracciones.size());
+    for (std::size_t i = 0; i < atracciones.size(); ++i) ruta->esperas[i] = atracciones[i].tiempo_espera;
+    ruta->ruta = rutaDesdePrevios(ruta->previos, identificadores);
+    return ruta;
+}
+
+// Actualizar una ruta cacheada a los tiempos de espera actuales reparando sus distancias en vez de repetir dijkstra
+// Devuelve nullptr si cambiaron demasiadas esperas o la ruta no es de este grafo; entonces conviene calcularla de nuevo
+
+std::shared_ptr<const RutaHoja> actualizarRutaHoja(const RutaHoja& anterior, const std::vector<Atraccion>& atracciones, const Grafo& grafo, std::uint64_t huella) {
+    if (anterior.distancias.size() != static_cast<std::size_t>(grafo.numNodos) || anterior.esperas.size() != atracciones.size() ||
+        atracciones.size() < static_cast<std::size_t>(grafo.numNodos)) {
+        return nullptr;
+    }
+    std::vector<int> cambiados;
+    for (int v = 0; v < grafo.numNodos; ++v) {
+        if (atracciones[v].tiempo_espera == anterior.esperas[v]) continue;
+        cambiados.push_back(v);
+        if (cambiados.size() > MAX_ESPERAS_REPARADAS) return nullptr;
+    }
+
+    auto ruta = std::make_shared<RutaHoja>(anterior);
+    ruta->huellaEspera = huella;
+    if (cambiados.empty()) return ruta;
+    // Con varios cambios, cada reparación parte de las esperas viejas de los que todavía no se aplicaron
+    std::vector<Atraccion> intermedias;
+    if (cambiados.size() > 1) {
+        intermedias = atracciones;
+        for (int v : cambiados) intermedias[v].tiempo_espera = anterior.esperas[v];
+    }
+    const std::vector<Atraccion>& esperasActuales = cambiados.size() > 1 ? intermedias : atracciones;
+    for (int v : cambiados) {
+        if (cambiados.size() > 1) intermedias[v].tiempo_espera = atracciones[v].tiempo_espera;
+        repararPorCambioDeEspera(grafo, ruta->inicio_indice, esperasActuales, v, anterior.esperas[v], ruta->distancias, ruta->previos);
+        ruta->esperas[v] = atracciones[v].tiempo_espera;
+    }
+    ruta->ruta = rutaDesdePrevios(ruta->previos, ruta->seleccionadas);
+    return ruta;
+}
+
+//--------------------------------------------------------
+
+// Recomendar las atracciones de una hoja del árbol y calcular su ruta
+// Si se pasa la hoja, la ruta se reutiliza de su caché mientras no cambien el grafo ni los tiempos de espera
+// (y se repara si cambiaron pocas esperas)
+
+void recomendarAtracciones(const std::vector<int>& identificadores, const std::vector<Atraccion>& atracciones, const std::shared_ptr<const Grafo>& grafo, Nodo* hoja = nullptr) {
+    if (identificadores.empty()) {
+        std::cout << "\nNo hay atracciones sugeridas para este perfil.\n";
+        return;
+    }
+
+    std::cout << "\nAtracciones sugeridas:\n";
+    for (int identificador : identificadores) {
+        for (const auto& atraccion : atracciones) {
+            if (atraccion.identificador == identificador) {
+                std::cout << "Identificador: " << atraccion.identificador << ", Nombre: " << atraccion.nombre << ", Tiempo de espera: " << atraccion.tiempo_espera << " minutos\n";
+            }
+        }
+    }
+
+    std::cout << "\nCalculando la ruta mas eficiente...\n";
+
+    std::uint64_t huella = huellaEspera(atracciones);
+    std::shared_ptr<const RutaHoja> ruta;
+    if (hoja) {
+        ruta = std::atomic_load(&hoja->rutaCacheada);
+        // Una ruta de otro grafo (recargado) no se puede reparar: sus distancias son de otras aristas
+        if (ruta && ruta->grafo.lock() != grafo) ruta = nullptr;
+    }
+    if (!ruta || ruta->huellaEspera != huella || ruta->seleccionadas != identificadores) {
+        // Si solo cambiaron algunas esperas, la ruta cacheada se repara en lugar de calcularse de nuevo
+        std::shared_ptr<const RutaHoja> reparada;
+        if (ruta && ruta->seleccionadas == identificadores) {
+            reparada = actualizarRutaHoja(*ruta, atracciones, *grafo, huella);
+        }
+        ruta = reparada ? reparada : calcularRutaHoja(identificadores, atracciones, grafo, huella);
+        if (!ruta) {
+            std::cerr << "Error: Identificador de atraccion de inicio no encontrado.\n";
+            return;
+        }
+        if (hoja) {
+            std::atomic_store(&hoja->rutaCacheada, ruta);
+        }
+    }
+
+    // Imprimir las distancias mínimas a cada atracción seleccionada
+    std::cout << "\nDistancias desde la atraccion de inicio (" << atracciones[ruta->inicio_indice].nombre << "):\n";
+    for (int id : ruta->seleccionadas) {
+        std::cout << "Identificador: " << id << ", Distancia: " << ruta->distancias[id - 1] << " metros\n";
+    }
+
+    // Imprimir la ruta más eficiente
+    imprimirRuta(ruta->ruta, atracciones);
+}
+
+//--------------------------------------------------------
+
+// Usar el árbol de decisiones 
+
+void usarArbolDecisiones(Nodo* nodo, const ModeloParque& modelo) {
+    if (!nodo->izquierda && !nodo->derecha) {
+        // Se descartan las atracciones cerradas con un AND por palabra sobre el bitset de la hoja (indexado al cargar)
+        ConjuntoAtracciones sugeridas = nodo->conjunto;
+        intersectar(sugeridas, modelo.abiertas);
+        recomendarAtracciones(identificadoresDelConjunto(sugeridas, modelo.atracciones), modelo.atracciones, modelo.grafo, nodo);
+        return;
+    }
+
+    // Hacer pregunta
+    std::cout << nodo->pregunta << " (1. Si / 2. No): ";
+    int respuesta;
+    std::cin >> respuesta;
+    if (respuesta == 1) {
+        usarArbolDecisiones(nodo->izquierda, modelo);
+    } else if (respuesta == 2) {
+        usarArbolDecisiones(nodo->derecha, modelo);
+    } else {
+        std::cout << "Respuesta no valida. Intente de nuevo.\n";
+        usarArbolDecisiones(nodo, modelo);
+    }
+}
+
+
+//---------------------------------------------------------------
+
+#ifdef ARBOL_COMPILADO
+// Usar el árbol de decisiones compilado (ArbolCompilado.h, generado con GeneradorClasificador)
+
+void usarArbolCompilado(const ModeloParque& modelo) {
+    arbol_compilado::Hoja hoja = arbol_compilado::clasificar([](int indice) {
+        while (true) {
+            std::cout << arbol_compilado::preguntas[indice] << " (1. Si / 2. No): ";
+            int respuesta;
+            std::cin >> respuesta;
+            if (respuesta == 1) return true;
+            if (respuesta == 2) return false;
+            std::cout << "Respuesta no valida. Intente de nuevo.\n";
+        }
+    });
+    std::vector<int> identificadores(hoja.identificadores, hoja.identificadores + hoja.cantidad);
+    ConjuntoAtracciones sugeridas = conjuntoDesdeIdentificadores(identificadores, modelo.atracciones);
+    intersectar(sugeridas, modelo.abiertas);
+    recomendarAtracciones(identificadoresDelConjunto(sugeridas, modelo.atracciones), modelo.atracciones, modelo.grafo);
+}
+#endif
+
+//---------------------------------------------------------------
+
+// Función para seleccionar manualmente las atracciones 
+
+void seleccionManualDeAtracciones(const Grafo& grafo, const std::vector<Atraccion>& atracciones) {
+    std::cout << "Lista de atracciones disponibles:\n";
+    for (const auto& atraccion : atracciones) {
+        std::cout << "Identificador: " << atraccion.identificador << ", Nombre: " << atraccion.nombre << ", Tiempo de espera: " << atraccion.tiempo_espera << " minutos\n";
+    }
+
+    std::cout << "Ingrese el identificador de la atraccion de inicio: ";
+    int inicio_id;
+    std::cin >> inicio_id;
+
+    // Encontrar el índice en el vector de atracciones
+    int inicio_indice = -1;
+    for (int i = 0; i < atracciones.size(); ++i) {
+        if (atracciones[i].identificador == inicio_id) {
+            inicio_indice = i;
+            break;
+        }
+    }
+
+    if (inicio_indice == -1) {
+        std::cerr << "Error: Identificador de atraccion de inicio no encontrado.\n";
+        return;
+    }
+
+    std::cout << "Ingrese los identificadores de las atracciones a visitar (separados por espacios) o 'todos' para visitar todas: ";
+    std::vector<int> seleccionadas;
+    std::string entrada;
+    std::cin.ignore();
+    std::getline(std::cin, entrada);
+
+    if (entrada == "todos") {
+        for (const auto& atraccion : atracciones) {
+            seleccionadas.push_back(atraccion.identificador);
+        }
+    } else {
+        std::istringstream iss(entrada);
+        int identificador;
+        while (iss >> identificador) {
+            seleccionadas.push_back(identificador);
+        }
+    }
+
+    auto resultados_dijkstra = dijkstra(grafo, inicio_indice, seleccionadas, atracciones);
+    std::vector<int> distancias = resultados_dijkstra.first;
+    std::vector<int> predecesores = resultados_dijkstra.second;
+
+    // Imprimir las distancias mínimas a cada atracción seleccionada
+    std::cout << "  \n";
+    std::cout << "Distancias desde la atraccion de inicio (" << atracciones[inicio_indice].nombre << "):\n";
+    for (int i = 0; i < seleccionadas.size(); ++i) {
+        int id = seleccionadas[i];
+        std::cout << "Identificador: " << id << ", Distancia: " << distancias[id - 1] << " metros\n"; 
+    }
+
+    // Imprimir la ruta más eficiente
+    imprimirRuta(predecesores, atracciones);
+}
+
+
+//--------------------------------------------------------
+
+// Modo por lotes: cada línea es una consulta "inicio id1 id2 ..." o "inicio todos"
+// (con el prefijo "recorrido" se calcula el orden de visita óptimo, y "plan inicio minutos [plazo_ms]" arma la visita
+// con más atracciones en ese tiempo, "pareto inicio destino [tolerancia]" las rutas que equilibran caminar y hacer fila,
+// y "alternativas inicio destino [k] [penalizacion]" varias rutas distintas)
+// y cada respuesta es una línea JSON con las distancias y la ruta
+
+// Consulta de ruta ya validada contra el modelo, con los destinos ordenados y sin repetir
+struct ConsultaRuta {
+    int inicio_id;
+    std::vector<int> destinos;
+};
+
+// Función para interpretar una línea; devuelve un mensaje de error vacío si es válida
+std::string interpretarConsulta(const char* inicio, const char* fin, const ModeloParque& modelo, ConsultaRuta& consulta) {
+    CronometroEtapa cronometro(ETAPA_INTERPRETAR);
+    auto saltarEspacios = [&inicio, fin]() {
+        while (inicio < fin && (*inicio == ' ' || *inicio == '\t' || *inicio == '\r' || *inicio == ',')) ++inicio;
+    };
+    int numNodos = modelo.grafo->numNodos;
+    auto idValido = [numNodos](int id) { return id >= 1 && id <= numNodos; };
+
+    saltarEspacios();
+    auto leido = std::from_chars(inicio, fin, consulta.inicio_id);
+    if (leido.ec != std::errc()) return "falta el identificador de inicio";
+    if (!idValido(consulta.inicio_id)) return "identificador de inicio no encontrado";
+    inicio = leido.ptr;
+
+    consulta.destinos.clear();
+    saltarEspacios();
+    if (fin - inicio >= 5 && std::memcmp(inicio, "todos", 5) == 0) {
+        for (const auto& atraccion : modelo.atracciones) {
+            if (idValido(atraccion.identificador)) consulta.destinos.push_back(atraccion.identificador);
+        }
+        inicio += 5;
+        saltarEspacios();
+        if (inicio != fin) return "texto inesperado despues de 'todos'";
+        std::sort(consulta.destinos.begin(), consulta.destinos.end());
+        consulta.destinos.erase(std::unique(consulta.destinos.begin(), consulta.destinos.end()), consulta.destinos.end());
+        return "";
+    }
+    while (inicio < fin) {
+        int id;
+        leido = std::from_chars(inicio, fin, id);
+        if (leido.ec != std::errc()) return "identificador de destino invalido";
+        if (!idValido(id)) return "identificador de destino no encontrado";
+        consulta.destinos.push_back(id);
+        inicio = leido.ptr;
+        saltarEspacios();
+    }
+    if (consulta.destinos.empty()) return "no hay destinos";
+    // Forma canónica: consultas con el mismo conjunto de destinos comparten cálculo y respuesta
+    std::sort(consulta.destinos.begin(), consulta.destinos.end());
+    consulta.destinos.erase(std::unique(consulta.destinos.begin(), consulta.destinos.end()), consulta.destinos.end());
+    return "";
+}
+
+// Consulta de plan con tiempo disponible ya validada contra el modelo
+struct ConsultaPlan {
+    int inicio_id;
+    int minutos;
+    int plazo_ms = plazoPlanMs;
+};
+
+const int MAX_MINUTOS_PLAN = 24 * 60;
+
+// Función para interpretar "inicio minutos [plazo_ms]"; devuelve un mensaje de error vacío si es válida
+std::string interpretarPlan(const char* inicio, const char* fin, const ModeloParque& modelo, ConsultaPlan& consulta) {
+    CronometroEtapa cronometro(ETAPA_INTERPRETAR);
+    auto saltarEspacios = [&inicio, fin]() {
+        while (inicio < fin && (*inicio == ' ' || *inicio == '\t' || *inicio == '\r' || *inicio == ',')) ++inicio;
+    };
+    saltarEspacios();
+    auto leido = std::from_chars(inicio, fin, consulta.inicio_id);
+    if (leido.ec != std::errc()) return "falta el identificador de inicio";
+    if (consulta.inicio_id < 1 || consulta.inicio_id > modelo.grafo->numNodos) return "identificador de inicio no encontrado";
+    inicio = leido.ptr;
+    saltarEspacios();
+    leido = std::from_chars(inicio, fin, consulta.minutos);
+    if (leido.ec != std::errc()) return "faltan los minutos disponibles";
+    if (consulta.minutos < 0 || consulta.minutos > MAX_MINUTOS_PLAN) return "minutos fuera de rango";
+    inicio = leido.ptr;
+    saltarEspacios();
+    consulta.plazo_ms = plazoPlanMs;
+    if (inicio == fin) return "";
+    leido = std::from_chars(inicio, fin, consulta.plazo_ms);
+    if (leido.ec != std::errc()) return "plazo invalido";
+    if (consulta.plazo_ms < 0 || consulta.plazo_ms > MAX_PLAZO_PLAN_MS) return "plazo fuera de rango";
+    inicio = leido.ptr;
+    saltarEspacios();
+    if (inicio != fin) return "texto inesperado despues del plazo";
+    return "";
+}
+
+// Consulta de rutas de Pareto ya validada contra el modelo
+struct ConsultaPareto {
+    int inicio_id;
+    int destino_id;
+    int tolerancia = TOLERANCIA_PARETO_POR_CIENTO;
+};
+
+// Función para interpretar "inicio destino [tolerancia]"; devuelve un mensaje de error vacío si es válida
+std::string interpretarPareto(const char* inicio, const char* fin, const ModeloParque& modelo, ConsultaPareto& consulta) {
+    CronometroEtapa cronometro(ETAPA_INTERPRETAR);
+    auto saltarEspacios = [&inicio, fin]() {
+        while (inicio < fin && (*inicio == ' ' || *inicio == '\t' || *inicio == '\r' || *inicio == ',')) ++inicio;
+    };
+    int numNodos = modelo.grafo->numNodos;
+    saltarEspacios();
+    auto leido = std::from_chars(inicio, fin, consulta.inicio_id);
+    if (leido.ec != std::errc()) return "falta el identificador de inicio";
+    if (consulta.inicio_id < 1 || consulta.inicio_id > numNodos) return "identificador de inicio no encontrado";
+    inicio = leido.ptr;
+    saltarEspacios();
+    leido = std::from_chars(inicio, fin, consulta.destino_id);
+    if (leido.ec != std::errc()) return "falta el identificador de destino";
+    if (consulta.destino_id < 1 || consulta.destino_id > numNodos) return "identificador de destino no encontrado";
+    inicio = leido.ptr;
+    saltarEspacios();
+    consulta.tolerancia = TOLERANCIA_PARETO_POR_CIENTO;
+    if (inicio != fin) {
+        leido = std::from_chars(inicio, fin, consulta.tolerancia);
+        if (leido.ec != std::errc() || consulta.tolerancia < 0 || consulta.tolerancia > 100) return "tolerancia invalida";
+        inicio = leido.ptr;
+        saltarEspacios();
+        if (inicio != fin) return "texto inesperado despues de la tolerancia";
+    }
+    return "";
+}
+
+// Consulta de rutas alternativas ya validada contra el modelo
+struct ConsultaAlternativas {
+    int inicio_id;
+    int destino_id;
+    int k = 3;
+    bool penalizacion = false; // Método de penalización en lugar de Yen
+};
+
+// Función para interpretar "inicio destino [k] [yen|penalizacion]"; devuelve un mensaje de error vacío si es válida
+std::string interpretarAlternativas(const char* inicio, const char* fin, const ModeloParque& modelo, ConsultaAlternativas& consulta) {
+    CronometroEtapa cronometro(ETAPA_INTERPRETAR);
+    auto saltarEspacios = [&inicio, fin]() {
+        while (inicio < fin && (*inicio == ' ' || *inicio == '\t' || *inicio == '\r' || *inicio == ',')) ++inicio;
+    };
+    int numNodos = modelo.grafo->numNodos;
+    saltarEspacios();
+    auto leido = std::from_chars(inicio, fin, consulta.inicio_id);
+    if (leido.ec != std::errc()) return "falta el identificador de inicio";
+    if (consulta.inicio_id < 1 || consulta.inicio_id > numNodos) return "identificador de inicio no encontrado";
+    inicio = leido.ptr;
+    saltarEspacios();
+    leido = std::from_chars(inicio, fin, consulta.destino_id);
+    if (leido.ec != std::errc()) return "falta el identificador de destino";
+    if (consulta.destino_id < 1 || consulta.destino_id > numNodos) return "identificador de destino no encontrado";
+    inicio = leido.ptr;
+    saltarEspacios();
+    consulta.k = 3;
+    consulta.penalizacion = false;
+    if (inicio < fin && std::isdigit(static_cast<unsigned char>(*inicio))) {
+        leido = std::from_chars(inicio, fin, consulta.k);
+        if (leido.ec != std::errc() || consulta.k < 1 || consulta.k > MAX_ALTERNATIVAS) return "cantidad de rutas fuera de rango";
+        inicio = leido.ptr;
+        saltarEspacios();
+    }
+    std::string metodo(inicio, fin);
+    while (!metodo.empty() && std::isspace(static_cast<unsigned char>(metodo.back()))) metodo.pop_back();
+    if (metodo == "penalizacion") {
+        consulta.penalizacion = true;
+    } else if (!metodo.empty() && metodo != "yen") {
+        return "metodo desconocido (yen o penalizacion)";
+    }
+    return "";
+}
+
+void escribirEntero(std::string& salida, long long valor) {
+    char buffer[24];
+    auto resultado = std::to_chars(buffer, buffer + sizeof(buffer), valor);
+    salida.append(buffer, resultado.ptr);
+}
+
+void escribirListaJSON(std::string& salida, const std::vector<int>& valores) {
+    salida += '[';
+    for (std::size_t i = 0; i < valores.size(); ++i) {
+        if (i) salida += ',';
+        escribirEntero(salida, valores[i]);
+    }
+    salida += ']';
+}
+
+// Función para resolver una consulta y agregar su respuesta JSON (sin salto de línea)
+// Motor de las consultas con un solo destino; las de varios destinos siempre usan dijkstra desde el inicio
+enum MotorPuntoAPunto {
+    MOTOR_DIJKSTRA,
+    MOTOR_BIDIRECCIONAL,
+    MOTOR_ALT,
+    MOTOR_CH,
+    MOTOR_CRP,
+};
+
+MotorPuntoAPunto motorPuntoAPunto = MOTOR_BIDIRECCIONAL;
+
+bool interpretarMotor(const std::string& nombre) {
+    if (nombre == "dijkstra") motorPuntoAPunto = MOTOR_DIJKSTRA;
+    else if (nombre == "bidireccional") motorPuntoAPunto = MOTOR_BIDIRECCIONAL;
+    else if (nombre == "alt") motorPuntoAPunto = MOTOR_ALT;
+    else if (nombre == "ch") motorPuntoAPunto = MOTOR_CH;
+    else if (nombre == "crp") motorPuntoAPunto = MOTOR_CRP;
+    else return false;
+    return true;
+}
+
+RutaPuntoAPunto rutaPuntoAPunto(const ModeloParque& modelo, int inicio, int destino) {
+    if (motorPuntoAPunto == MOTOR_CH && modelo.jerarquia) {
+        return consultarJerarquia(*modelo.jerarquia, inicio, destino, true);
+    }
+    if (motorPuntoAPunto == MOTOR_CRP && modelo.metrica) {
+        return consultarCRP(modelo, inicio, destino, true);
+    }
+    if (motorPuntoAPunto == MOTOR_ALT && modelo.grafo->numMarcas > 0) {
+        return aEstrellaALT(*modelo.grafo, inicio, destino, modelo.atracciones);
+    }
+    return dijkstraBidireccional(*modelo.grafo, inicio, destino, modelo.atracciones);
+}
+
+// Hora de salida de --hora (segundos desde la medianoche); -1 si las consultas no dependen de la hora
+int horaSalidaConsultas = -1;
+
+// Escribe una hora del día como "HH:MM" (los segundos sueltos cuentan como un minuto más)
+void escribirHora(std::string& salida, int segundos) {
+    int minutos = (segundos + 59) / 60;
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "\"%02d:%02d\"", minutos / 60, minutos % 60);
+    salida += buffer;
+}
+
+// Con --hora la distancia es el tiempo de viaje en minutos (caminata más esperas previstas) y se agrega la hora de llegada
+void responderPuntoAPunto(const ConsultaRuta& consulta, const ModeloParque& modelo, std::string& salida) {
+    bool conHora = horaSalidaConsultas >= 0;
+    RutaPuntoAPunto ruta = conHora ? rutaDependienteDeHora(*modelo.grafo, modelo.atracciones, modelo.perfiles.get(), consulta.inicio_id - 1,
+                                                           consulta.destinos[0] - 1, horaSalidaConsultas)
+                                   : rutaPuntoAPunto(modelo, consulta.inicio_id - 1, consulta.destinos[0] - 1);
+    bool alcanzable = ruta.distancia != std::numeric_limits<int>::max();
+    salida += "{\"inicio\":";
+    escribirEntero(salida, consulta.inicio_id);
+    salida += ",\"destinos\":";
+    escribirListaJSON(salida, consulta.destinos);
+    salida += ",\"distancias\":[";
+    if (!alcanzable) {
+        salida += "null";
+    } else {
+        escribirEntero(salida, conHora ? (ruta.distancia - horaSalidaConsultas + 59) / 60 : ruta.distancia);
+    }
+    salida += "],\"ruta\":";
+    escribirListaJSON(salida, ruta.ruta);
+    if (conHora) {
+        salida += ",\"llegada\":";
+        if (alcanzable) {
+            escribirHora(salida, ruta.distancia);
+        } else {
+            salida += "null";
+        }
+    }
+    salida += '}';
+}
+
+void responderConsulta(const ConsultaRuta& consulta, const ModeloParque& modelo, std::string& salida) {
+    if (consulta.destinos.size() == 1 && (motorPuntoAPunto != MOTOR_DIJKSTRA || horaSalidaConsultas >= 0)) {
+        responderPuntoAPunto(consulta, modelo, salida);
+        return;
+    }
+    auto resultados_dijkstra = dijkstra(*modelo.grafo, consulta.inicio_id - 1, consulta.destinos, modelo.atracciones);
+    const std::vector<int>& distancias = resultados_dijkstra.first;
+
+    salida += "{\"inicio\":";
+    escribirEntero(salida, consulta.inicio_id);
+    salida += ",\"destinos\":";
+    escribirListaJSON(salida, consulta.destinos);
+    salida += ",\"distancias\":[";
+    for (std::size_t i = 0; i < consulta.destinos.size(); ++i) {
+        if (i) salida += ',';
+        int distancia = distancias[consulta.destinos[i] - 1];
+        if (distancia == std::numeric_limits<int>::max()) {
+            salida += "null";
+        } else {
+            escribirEntero(salida, distancia);
+        }
+    }
+    salida += "],\"ruta\":";
+    escribirListaJSON(salida, resultados_dijkstra.second);
+    salida += '}';
+}
+
+void responderRecorrido(const ConsultaRuta& consulta, const ModeloParque& modelo, PlanificadorTareas& planificador, std::string& salida) {
+    Recorrido recorrido = optimizarRecorrido(modelo, consulta.inicio_id, consulta.destinos, planificador);
+    salida += "{\"inicio\":";
+    escribirEntero(salida, consulta.inicio_id);
+    salida += ",\"orden\":";
+    escribirListaJSON(salida, recorrido.orden);
+    salida += ",\"costo\":";
+    if (recorrido.costo < 0) {
+        salida += "null";
+    } else {
+        escribirEntero(salida, recorrido.costo);
+    }
+    // Con --hora, el orden elegido se evalúa con las esperas previstas a la hora de llegada a cada parada,
+    // y la ruta es la de ese horario (cada tramo puede desviarse para evitar una fila que crece)
+    bool conHora = horaSalidaConsultas >= 0 && recorrido.costo >= 0;
+    HorarioRecorrido horario;
+    if (conHora) horario = horarioRecorrido(modelo, consulta.inicio_id, recorrido.orden, horaSalidaConsultas);
+    salida += ",\"ruta\":";
+    escribirListaJSON(salida, conHora ? horario.ruta : recorrido.ruta);
+    if (conHora) {
+        salida += ",\"llegadas\":[";
+        for (std::size_t i = 0; i < horario.llegadas.size(); ++i) {
+            if (i) salida += ',';
+            escribirHora(salida, horario.llegadas[i]);
+        }
+        salida += "],\"fin\":";
+        if (horario.fin >= 0) {
+            escribirHora(salida, horario.fin);
+        } else {
+            salida += "null";
+        }
+    }
+    salida += '}';
+}
+
+void responderPlan(const ConsultaPlan& consulta, const ModeloParque& modelo, PlanificadorTareas& planificador, std::string& salida) {
+    PlanVisita plan = planificarVisita(modelo, consulta.inicio_id, consulta.minutos, consulta.plazo_ms, planificador);
+    salida += "{\"inicio\":";
+    escribirEntero(salida, consulta.inicio_id);
+    salida += ",\"minutos\":";
+    escribirEntero(salida, consulta.minutos);
+    salida += ",\"orden\":";
+    escribirListaJSON(salida, plan.orden);
+    salida += ",\"minutos_usados\":";
+    escribirEntero(salida, (plan.segundos + 59) / 60);
+    salida += ",\"ruta\":";
+    escribirListaJSON(salida, plan.ruta);
+    salida += '}';
+}
+
+void responderPareto(const ConsultaPareto& consulta, const ModeloParque& modelo, std::string& salida) {
+    ResultadoPareto pareto = rutasPareto(*modelo.grafo, modelo.atracciones, consulta.inicio_id - 1, consulta.destino_id - 1, consulta.tolerancia);
+    salida += "{\"inicio\":";
+    escribirEntero(salida, consulta.inicio_id);
+    salida += ",\"destino\":";
+    escribirEntero(salida, consulta.destino_id);
+    salida += ",\"tolerancia\":";
+    escribirEntero(salida, consulta.tolerancia);
+    salida += ",\"rutas\":[";
+    for (std::size_t i = 0; i < pareto.rutas.size(); ++i) {
+        if (i) salida += ',';
+        salida += "{\"metros\":";
+        escribirEntero(salida, pareto.rutas[i].metros);
+        salida += ",\"espera\":";
+        escribirEntero(salida, pareto.rutas[i].espera);
+        salida += ",\"ruta\":";
+        escribirListaJSON(salida, pareto.rutas[i].ruta);
+        salida += '}';
+    }
+    salida += "]}";
+}
+
+void responderAlternativas(const ConsultaAlternativas& consulta, const ModeloParque& modelo, PlanificadorTareas& planificador, std::string& salida) {
+    std::uint64_t asentados = 0;
+    int inicio = consulta.inicio_id - 1;
+    int destino = consulta.destino_id - 1;
+    std::vector<RutaAlternativa> rutas = consulta.penalizacion
+        ? rutasAlternativasPenalizadas(*modelo.grafo, modelo.atracciones, inicio, destino, consulta.k, asentados)
+        : rutasAlternativasYen(*modelo.grafo, modelo.atracciones, inicio, destino, consulta.k, planificador, asentados);
+    salida += "{\"inicio\":";
+    escribirEntero(salida, consulta.inicio_id);
+    salida += ",\"destino\":";
+    escribirEntero(salida, consulta.destino_id);
+    salida += consulta.penalizacion ? ",\"metodo\":\"penalizacion\"" : ",\"metodo\":\"yen\"";
+    salida += ",\"rutas\":[";
+    for (std::size_t i = 0; i < rutas.size(); ++i) {
+        if (i) salida += ',';
+        salida += "{\"costo\":";
+        escribirEntero(salida, rutas[i].costo);
+        salida += ",\"ruta\":[";
+        for (std::size_t j = 0; j < rutas[i].nodos.size(); ++j) {
+            if (j) salida += ',';
+            escribirEntero(salida, rutas[i].nodos[j] + 1);
+        }
+        salida += "]}";
+    }
+    salida += "]}";
+}
+
+//--------------------------------------------------------
+
+// Coalescencia de consultas idénticas en curso (single-flight)
+// La primera consulta con una clave (tipo, inicio, destinos canónicos, época del modelo) hace el cálculo;
+// las que llegan mientras tanto esperan y reciben el mismo buffer de respuesta
+
+struct CoalescedorRutas {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const std::string>>> enCurso;
+    std::atomic<std::uint64_t> calculadas{0};
+    std::atomic<std::uint64_t> compartidas{0};
+};
+
+CoalescedorRutas coalescedorRutas;
+
+std::string claveConsulta(char tipo, const ConsultaRuta& consulta, std::uint64_t epoca) {
+    std::string clave(1, tipo);
+    clave.append(reinterpret_cast<const char*>(&epoca), sizeof(epoca));
+    clave.append(reinterpret_cast<const char*>(&consulta.inicio_id), sizeof(int));
+    clave.append(reinterpret_cast<const char*>(consulta.destinos.data()), consulta.destinos.size() * sizeof(int));
+    return clave;
+}
+
+std::shared_ptr<const std::string> resolverCoalescido(CoalescedorRutas& coalescedor, const std::string& clave,
+                                                      const std::function<std::shared_ptr<const std::string>()>& calcular) {
+    std::promise<std::shared_ptr<const std::string>> promesa;
+    std::unique_lock<std::mutex> bloqueo(coalescedor.mutex);
+    auto it = coalescedor.enCurso.find(clave);
+    if (it != coalescedor.enCurso.end()) {
+        std::shared_future<std::shared_ptr<const std::string>> futuro = it->second;
+        bloqueo.unlock();
+        coalescedor.compartidas.fetch_add(1, std::memory_order_relaxed);
+        return futuro.get();
+    }
+    coalescedor.enCurso.emplace(clave, promesa.get_future().share());
+    bloqueo.unlock();
+
+    coalescedor.calculadas.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<const std::string> resultado;
+    try {
+        resultado = calcular();
+        promesa.set_value(resultado);
+    } catch (...) {
+        promesa.set_exception(std::current_exception());
+        bloqueo.lock();
+        coalescedor.enCurso.erase(clave);
+        throw;
+    }
+    bloqueo.lock();
+    coalescedor.enCurso.erase(clave);
+    return resultado;
+}
+
+//--------------------------------------------------------
+
+// Caché LRU de respuestas de ruta y de recorrido, repartida en fragmentos con su propio mutex
+// La clave incluye la época del modelo: al editar un tiempo de espera o recargar archivos las entradas
+// viejas dejan de coincidir y salen solas por el final de la lista
+
+const std::size_t FRAGMENTOS_CACHE = 16;
+
+struct FragmentoCache {
+    std::mutex mutex;
+    std::list<std::pair<std::string, std::shared_ptr<const std::string>>> orden; // Más reciente al frente
+    std::unordered_map<std::string, decltype(orden)::iterator> indice;
+};
+
+struct CacheRutas {
+    FragmentoCache fragmentos[FRAGMENTOS_CACHE];
+    std::size_t capacidadFragmento = 256; // 0 desactiva la caché
+    std::atomic<std::uint64_t> aciertos{0};
+    std::atomic<std::uint64_t> fallos{0};
+    std::atomic<std::uint64_t> expulsiones{0};
+};
+
+CacheRutas cacheRutas;
+
+void configurarCache(CacheRutas& cache, std::size_t capacidadTotal) {
+    cache.capacidadFragmento = (capacidadTotal + FRAGMENTOS_CACHE - 1) / FRAGMENTOS_CACHE;
+}
+
+FragmentoCache& fragmentoDeClave(CacheRutas& cache, const std::string& clave) {
+    return cache.fragmentos[std::hash<std::string>()(clave) % FRAGMENTOS_CACHE];
+}
+
+std::shared_ptr<const std::string> buscarEnCache(CacheRutas& cache, const std::string& clave) {
+    if (cache.capacidadFragmento == 0) return nullptr;
+    FragmentoCache& fragmento = fragmentoDeClave(cache, clave);
+    std::lock_guard<std::mutex> bloqueo(fragmento.mutex);
+    auto it = fragmento.indice.find(clave);
+    if (it == fragmento.indice.end()) {
+        cache.fallos.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    fragmento.orden.splice(fragmento.orden.begin(), fragmento.orden, it->second);
+    cache.aciertos.fetch_add(1, std::memory_order_relaxed);
+    return it->second->second;
+}
+
+void guardarEnCache(CacheRutas& cache, const std::string& clave, std::shared_ptr<const std::string> respuesta) {
+    if (cache.capacidadFragmento == 0) return;
+    FragmentoCache& fragmento = fragmentoDeClave(cache, clave);
+    std::lock_guard<std::mutex> bloqueo(fragmento.mutex);
+    auto it = fragmento.indice.find(clave);
+    if (it != fragmento.indice.end()) {
+        it->second->second = std::move(respuesta);
+        fragmento.orden.splice(fragmento.orden.begin(), fragmento.orden, it->second);
+        return;
+    }
+    fragmento.orden.emplace_front(clave, std::move(respuesta));
+    fragmento.indice.emplace(clave, fragmento.orden.begin());
+    if (fragmento.orden.size() > cache.capacidadFragmento) {
+        fragmento.indice.erase(fragmento.orden.back().first);
+        fragmento.orden.pop_back();
+        cache.expulsiones.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::size_t entradasEnCache(CacheRutas& cache) {
+    std::size_t total = 0;
+    for (auto& fragmento : cache.fragmentos) {
+        std::lock_guard<std::mutex> bloqueo(fragmento.mutex);
+        total += fragmento.orden.size();
+    }
+    return total;
+}
+
+// Busca la respuesta en la caché; si no está, la calcula una sola vez aunque lleguen varias consultas
+// iguales a la vez. Quien calcula la guarda en la caché antes de liberar a los que esperan.
+std::shared_ptr<const std::string> respuestaCacheada(const std::string& clave, const std::function<void(std::string&)>& calcular) {
+    if (auto guardada = buscarEnCache(cacheRutas, clave)) return guardada;
+    return resolverCoalescido(coalescedorRutas, clave, [&]() {
+        std::string salida;
+        calcular(salida);
+        auto respuesta = std::make_shared<const std::string>(std::move(salida));
+        guardarEnCache(cacheRutas, clave, respuesta);
+        return respuesta;
+    });
+}
+
+// Respuestas de ruta y de recorrido, compartidas entre consultas idénticas de la misma época del modelo
+std::shared_ptr<const std::string> respuestaRuta(const ConsultaRuta& consulta, const ModeloParque& modelo) {
+    return respuestaCacheada(claveConsulta('r', consulta, modelo.epoca), [&](std::string& salida) {
+        responderConsulta(consulta, modelo, salida);
+    });
+}
+
+std::shared_ptr<const std::string> respuestaRecorrido(const ConsultaRuta& consulta, const ModeloParque& modelo, PlanificadorTareas& planificador) {
+    return respuestaCacheada(claveConsulta('t', consulta, modelo.epoca), [&](std::string& salida) {
+        responderRecorrido(consulta, modelo, planificador, salida);
+    });
+}
+
+std::shared_ptr<const std::string> respuestaPareto(const ConsultaPareto& consulta, const ModeloParque& modelo) {
+    ConsultaRuta clave{consulta.inicio_id, {consulta.destino_id, consulta.tolerancia}};
+    return respuestaCacheada(claveConsulta('o', clave, modelo.epoca), [&](std::string& salida) {
+        responderPareto(consulta, modelo, salida);
+    });
+}
 
-    distancia[inicio] = 0;
-    pq.push({0, inicio});
+std::shared_ptr<const std::string> respuestaAlternativas(const ConsultaAlternativas& consulta, const ModeloParque& modelo, PlanificadorTareas& planificador) {
+    ConsultaRuta clave{consulta.inicio_id, {consulta.destino_id, consulta.k, consulta.penalizacion ? 1 : 0}};
+    return respuestaCacheada(claveConsulta('a', clave, modelo.epoca), [&](std::string& salida) {
+        responderAlternativas(consulta, modelo, planificador, salida);
+    });
+}
 
-    while (!pq.empty()) {
-        int peso_actual = pq.top().first;
-        int u = pq.top().second;
-        pq.pop();
+std::shared_ptr<const std::string> respuestaPlan(const ConsultaPlan& consulta, const ModeloParque& modelo, PlanificadorTareas& planificador) {
+    return respuestaCacheada(claveConsulta('p', ConsultaRuta{consulta.inicio_id, {consulta.minutos, consulta.plazo_ms}}, modelo.epoca), [&](std::string& salida) {
+        responderPlan(consulta, modelo, planificador, salida);
+    });
+}
 
-        if (peso_actual > distancia[u]) continue;
+void escribirErrorJSON(std::string& salida, long long numeroLinea, const std::string& mensaje) {
+    salida += "{\"linea\":";
+    escribirEntero(salida, numeroLinea);
+    salida += ",\"error\":\"";
+    salida += mensaje;
+    salida += "\"}";
+}
 
-        for (int v = 0; v < n; ++v) {
-            if (grafo.matrizAdyacencia[u][v] > 0) {
-                // Sumamos el tiempo de espera de la atracción actual al peso de la ruta
-                int peso_ruta = distancia[u] + grafo.matrizAdyacencia[u][v] + atracciones[v].tiempo_espera;
-                if (peso_ruta < distancia[v]) {
-                    distancia[v] = peso_ruta;
-                    previo[v] = u;
-                    pq.push({peso_ruta, v});
-                }
+// Procesa un bloque de líneas; cada bloque escribe en su propio buffer
+// Las líneas que empiezan con "recorrido" piden además el orden de visita óptimo, y las que empiezan con "plan"
+// el itinerario con más atracciones en los minutos dados; las que empiezan con "pareto", las rutas de Pareto,
+// y las que empiezan con "alternativas", varias rutas distintas entre dos nodos
+void procesarBloque(const std::vector<std::string>& lineas, std::size_t desde, std::size_t hasta, long long primeraLinea,
+                    const ModeloParque& modelo, std::string& salida, PlanificadorTareas& planificador) {
+    ConsultaRuta consulta;
+    for (std::size_t i = desde; i < hasta; ++i) {
+        const std::string& linea = lineas[i];
+        std::size_t primerCaracter = linea.find_first_not_of(" \t\r");
+        if (primerCaracter == std::string::npos) continue;
+        if (linea.compare(primerCaracter, 4, "plan") == 0) {
+            ConsultaPlan plan;
+            std::string error = interpretarPlan(linea.data() + primerCaracter + 4, linea.data() + linea.size(), modelo, plan);
+            if (error.empty()) {
+                salida += *respuestaPlan(plan, modelo, planificador);
+            } else {
+                escribirErrorJSON(salida, primeraLinea + static_cast<long long>(i), error);
+            }
+            salida += '\n';
+            continue;
+        }
+        if (linea.compare(primerCaracter, 6, "pareto") == 0) {
+            ConsultaPareto pareto;
+            std::string error = interpretarPareto(linea.data() + primerCaracter + 6, linea.data() + linea.size(), modelo, pareto);
+            if (error.empty()) {
+                salida += *respuestaPareto(pareto, modelo);
+            } else {
+                escribirErrorJSON(salida, primeraLinea + static_cast<long long>(i), error);
+            }
+            salida += '\n';
+            continue;
+        }
+        if (linea.compare(primerCaracter, 12, "alternativas") == 0) {
+            ConsultaAlternativas alternativas;
+            std::string error = interpretarAlternativas(linea.data() + primerCaracter + 12, linea.data() + linea.size(), modelo, alternativas);
+            if (error.empty()) {
+                salida += *respuestaAlternativas(alternativas, modelo, planificador);
+            } else {
+                escribirErrorJSON(salida, primeraLinea + static_cast<long long>(i), error);
             }
+            salida += '\n';
+            continue;
         }
+        bool esRecorrido = linea.compare(primerCaracter, 9, "recorrido") == 0;
+        const char* inicio = linea.data() + (esRecorrido ? primerCaracter + 9 : 0);
+        std::string error = interpretarConsulta(inicio, linea.data() + linea.size(), modelo, consulta);
+        if (error.empty() && esRecorrido) {
+            salida += *respuestaRecorrido(consulta, modelo, planificador);
+        } else if (error.empty()) {
+            salida += *respuestaRuta(consulta, modelo);
+        } else {
+            escribirErrorJSON(salida, primeraLinea + static_cast<long long>(i), error);
+        }
+        salida += '\n';
     }
+}
 
-    // Reconstruir el camino más corto en términos de nodos visitados
-    std::vector<int> ruta_optima;
-    int destino;
-    for (int atraccion : seleccionadas) {
-        destino = atraccion - 1; 
-        while (destino != -1) {
-            ruta_optima.push_back(destino + 1); 
-            destino = previo[destino];
+// Función principal del modo por lotes: lee de un archivo o de la entrada estándar ("-")
+int ejecutarLote(const std::string& archivoEntrada, unsigned numHilos) {
+    std::ifstream archivo;
+    if (archivoEntrada != "-") {
+        archivo.open(archivoEntrada);
+        if (!archivo.is_open()) {
+            std::cerr << "Error: No se pudo abrir el archivo " << archivoEntrada << std::endl;
+            return 1;
         }
-        std::reverse(ruta_optima.begin(), ruta_optima.end());
     }
+    std::istream& entrada = archivoEntrada == "-" ? std::cin : archivo;
 
-    return {distancia, ruta_optima};
-}
+    PlanificadorTareas planificador;
+    iniciarPlanificador(planificador, numHilos);
 
+    // Las líneas se leen por bloques; cada bloque se reparte entre los hilos y su salida se escribe en orden
+    const std::size_t lineasPorBloque = 1 << 16;
+    const std::size_t lineasPorTarea = 1 << 10;
+    std::vector<std::string> lineas;
+    long long numeroLinea = 1;
+    long long consultas = 0;
+    auto comienzo = std::chrono::steady_clock::now();
 
-//-------------------------------------------------------------
+    while (entrada) {
+        lineas.clear();
+        std::string linea;
+        while (lineas.size() < lineasPorBloque && std::getline(entrada, linea)) {
+            lineas.push_back(std::move(linea));
+        }
+        if (lineas.empty()) break;
 
-// Función principal del menú de la aplicación
+        std::shared_ptr<const ModeloParque> modelo = modeloActual();
+        std::size_t numTareas = (lineas.size() + lineasPorTarea - 1) / lineasPorTarea;
+        std::vector<std::string> salidas(numTareas);
+        GrupoTareas grupo;
+        for (std::size_t t = 0; t < numTareas; ++t) {
+            lanzarEnGrupo(planificador, grupo, [&, t]() {
+                TramoTraza tramo("bloque_lote");
+                std::size_t desde = t * lineasPorTarea;
+                std::size_t hasta = std::min(lineas.size(), desde + lineasPorTarea);
+                procesarBloque(lineas, desde, hasta, numeroLinea, *modelo, salidas[t], planificador);
+            });
+        }
+        esperarGrupo(planificador, grupo);
+        for (const auto& salida : salidas) {
+            std::fwrite(salida.data(), 1, salida.size(), stdout);
+        }
+        numeroLinea += static_cast<long long>(lineas.size());
+        atenderVolcadoPedido();
+        consultas += static_cast<long long>(lineas.size());
+    }
+    std::fflush(stdout);
+    detenerPlanificador(planificador);
 
-void mostrarMenu() {
-    std::cout << "\n-----------------------------------------\n";
-    std::cout << "Bienvenido a C++ Kingdom\n";
-    std::cout << "\n-----------------------------------------\n";
-    std::cout << "1. Usar el arbol de decisiones\n";
-    std::cout << "2. Seleccion manual de atracciones\n";
-    std::cout << "3. Editar tiempo de espera\n";
-    std::cout << "4. Salir\n";
-    std::cout << "\n-----------------------------------------\n";
-    std::cout << "Seleccione una opcion: ";
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - comienzo).count();
+    std::cerr << consultas << " consultas en " << segundos << " s (" << (segundos > 0 ? consultas / segundos : 0.0) << " consultas/s), "
+              << coalescedorRutas.compartidas.load() << " resueltas por coalescencia, "
+              << cacheRutas.aciertos.load() << " aciertos de cache" << std::endl;
+    return 0;
 }
 
 //--------------------------------------------------------
 
-// Función para imprimir la ruta más eficiente
+// Modo mapa: distancias y predecesores desde un nodo hacia todo el parque, en CSV por la salida estándar
+// (para mapas de calor y análisis fuera de línea). Usa delta-stepping con los hilos de --hilos.
 
-void imprimirRuta(const std::vector<int>& ruta, const std::vector<Atraccion>& atracciones) {
-    std::cout << " \n";
-    std::cout << "La ruta mas eficiente para realizar la visita es:\n";
-    for (int i = 0; i < ruta.size(); ++i) {
-        int id = ruta[i];
-        if (id >= 1 && id <= atracciones.size()) {
-            std::cout << "- Atraccion " << atracciones[id - 1].identificador << ": " << atracciones[id - 1].nombre << "\n";
+int deltaMapa = 0; // Ancho de cubeta de --delta (0: el costo promedio de una arista)
+
+int ejecutarMapa(int inicio_id, unsigned numHilos) {
+    std::shared_ptr<const ModeloParque> modelo = modeloActual();
+    const Grafo& grafo = *modelo->grafo;
+    if (inicio_id < 1 || inicio_id > grafo.numNodos) {
+        std::cerr << "Error: El identificador de inicio " << inicio_id << " no existe en el grafo." << std::endl;
+        return 1;
+    }
+    int delta = deltaMapa > 0 ? deltaMapa : deltaPorDefecto(grafo, modelo->atracciones);
+
+    PlanificadorTareas planificador;
+    iniciarPlanificador(planificador, numHilos);
+    auto comienzo = std::chrono::steady_clock::now();
+    std::vector<int> distancia;
+    std::vector<int> previo;
+    deltaStepping(grafo, inicio_id - 1, modelo->atracciones, delta, planificador, distancia, previo);
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - comienzo).count();
+    detenerPlanificador(planificador);
+
+    std::string salida = "identificador,distancia,previo\n";
+    int alcanzados = 0;
+    for (int v = 0; v < grafo.numNodos; ++v) {
+        escribirEntero(salida, v + 1);
+        salida += ',';
+        if (distancia[v] != std::numeric_limits<int>::max()) {
+            escribirEntero(salida, distancia[v]);
+            ++alcanzados;
         }
+        salida += ',';
+        if (previo[v] != -1) escribirEntero(salida, previo[v] + 1);
+        salida += '\n';
     }
+    std::fwrite(salida.data(), 1, salida.size(), stdout);
+    std::fflush(stdout);
+    std::cerr << alcanzados << " nodos alcanzados en " << segundos << " s (delta " << delta << ", " << numHilos << " hilos)" << std::endl;
+    return 0;
 }
 
 //--------------------------------------------------------
 
-// Usar el árbol de decisiones 
+// Servidor de rutas: HTTP/1.1 sobre un socket Unix o TCP en localhost
+// Un hilo con epoll atiende las conexiones y los trabajadores del planificador resuelven las peticiones
+// sobre la versión vigente del modelo del parque
+//   GET /ruta?inicio=1&destinos=2,3          (o destinos=todos)
+//   GET /recorrido?inicio=1&destinos=todos    (orden de visita óptimo y ruta completa)
+//   GET /plan?inicio=1&minutos=180            (itinerario con más atracciones en ese tiempo)
+//   GET /pareto?inicio=1&destino=9            (rutas de Pareto entre metros caminados y minutos de fila;
+//                                              opcional: tolerancia=5 en por ciento, 0 da el conjunto exacto)
+//   GET /alternativas?inicio=1&destino=9&k=3  (k rutas simples más cortas; metodo=penalizacion es más barato)
+//   GET /clasificar?respuestas=si,no,si       (opcional: espera_menor_a=30, accesible=1)
+//   POST /espera con id=3&tiempo=20           (en el cuerpo en formato de formulario o en la URL; solo POST)
+//   GET /metricas
 
-void usarArbolDecisiones(Nodo* nodo, const std::vector<Atraccion>& atracciones, const Grafo& grafo) {
-    if (!nodo->izquierda && !nodo->derecha) {
-        std::cout << "\nAtracciones sugeridas:\n";
-        for (int identificador : nodo->identificadores) {
-            for (const auto& atraccion : atracciones) {
-                if (atraccion.identificador == identificador) {
-                    std::cout << "Identificador: " << atraccion.identificador << ", Nombre: " << atraccion.nombre << ", Tiempo de espera: " << atraccion.tiempo_espera << " minutos\n";
-                }
+std::unordered_map<std::string, std::string> leerParametros(const std::string& texto) {
+    auto decodificar = [](const std::string& valor) {
+        std::string resultado;
+        for (std::size_t i = 0; i < valor.size(); ++i) {
+            if (valor[i] == '+') {
+                resultado += ' ';
+            } else if (valor[i] == '%' && i + 2 < valor.size() && std::isxdigit(static_cast<unsigned char>(valor[i + 1])) &&
+                       std::isxdigit(static_cast<unsigned char>(valor[i + 2]))) {
+                resultado += static_cast<char>(std::stoi(valor.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            } else {
+                resultado += valor[i];
             }
         }
+        return resultado;
+    };
+    std::unordered_map<std::string, std::string> parametros;
+    std::size_t inicio = 0;
+    while (inicio < texto.size()) {
+        std::size_t fin = texto.find('&', inicio);
+        if (fin == std::string::npos) fin = texto.size();
+        std::string par = texto.substr(inicio, fin - inicio);
+        std::size_t igual = par.find('=');
+        if (igual == std::string::npos) {
+            parametros[decodificar(par)] = "";
+        } else {
+            parametros[decodificar(par.substr(0, igual))] = decodificar(par.substr(igual + 1));
+        }
+        inicio = fin + 1;
+    }
+    return parametros;
+}
 
-        std::vector<int> seleccionadas;
-        for (int identificador : nodo->identificadores) {
-            seleccionadas.push_back(identificador);
+std::string escaparJSON(const std::string& texto) {
+    std::string resultado;
+    for (char c : texto) {
+        if (c == '"' || c == '\\') {
+            resultado += '\\';
+            resultado += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char codigo[8];
+            std::snprintf(codigo, sizeof(codigo), "\\u%04x", c);
+            resultado += codigo;
+        } else {
+            resultado += c;
         }
+    }
+    return resultado;
+}
 
-        std::cout << "\nCalculando la ruta mas eficiente...\n";
+std::string errorJSON(const std::string& mensaje) {
+    return "{\"error\":\"" + escaparJSON(mensaje) + "\"}";
+}
 
-        // Encontrar el índice en el vector de atracciones para el inicio (podría ser el primero de los identificadores sugeridos)
-        int inicio_indice = -1;
-        for (int i = 0; i < atracciones.size(); ++i) {
-            if (atracciones[i].identificador == nodo->identificadores[0]) {
-                inicio_indice = i;
-                break;
+struct ServidorParque {
+    ArchivosParque archivos;
+    PlanificadorTareas planificador;
+    HistogramaLatencia latencia; // Nanosegundos desde que llega la petición completa hasta que la respuesta está lista
+    std::atomic<std::uint64_t> peticiones{0};
+    std::atomic<std::uint64_t> errores{0};
+};
+
+std::string atenderRuta(const std::unordered_map<std::string, std::string>& parametros, const ModeloParque& modelo, int& estado) {
+    auto inicio = parametros.find("inicio");
+    auto destinos = parametros.find("destinos");
+    if (inicio == parametros.end() || destinos == parametros.end()) {
+        estado = 400;
+        return errorJSON("faltan los parametros inicio y destinos");
+    }
+    std::string linea = inicio->second + " " + destinos->second;
+    ConsultaRuta consulta;
+    std::string error = interpretarConsulta(linea.data(), linea.data() + linea.size(), modelo, consulta);
+    if (!error.empty()) {
+        estado = 400;
+        return errorJSON(error);
+    }
+    return *respuestaRuta(consulta, modelo);
+}
+
+std::string atenderRecorrido(ServidorParque& servidor, const std::unordered_map<std::string, std::string>& parametros, const ModeloParque& modelo, int& estado) {
+    auto inicio = parametros.find("inicio");
+    auto destinos = parametros.find("destinos");
+    if (inicio == parametros.end() || destinos == parametros.end()) {
+        estado = 400;
+        return errorJSON("faltan los parametros inicio y destinos");
+    }
+    std::string linea = inicio->second + " " + destinos->second;
+    ConsultaRuta consulta;
+    std::string error = interpretarConsulta(linea.data(), linea.data() + linea.size(), modelo, consulta);
+    if (!error.empty()) {
+        estado = 400;
+        return errorJSON(error);
+    }
+    return *respuestaRecorrido(consulta, modelo, servidor.planificador);
+}
+
+std::string atenderPlan(ServidorParque& servidor, const std::unordered_map<std::string, std::string>& parametros, const ModeloParque& modelo, int& estado) {
+    auto inicio = parametros.find("inicio");
+    auto minutos = parametros.find("minutos");
+    if (inicio == parametros.end() || minutos == parametros.end()) {
+        estado = 400;
+        return errorJSON("faltan los parametros inicio y minutos");
+    }
+    std::string linea = inicio->second + " " + minutos->second;
+    auto plazo = parametros.find("plazo_ms");
+    if (plazo != parametros.end()) linea += " " + plazo->second;
+    ConsultaPlan consulta;
+    std::string error = interpretarPlan(linea.data(), linea.data() + linea.size(), modelo, consulta);
+    if (!error.empty()) {
+        estado = 400;
+        return errorJSON(error);
+    }
+    return *respuestaPlan(consulta, modelo, servidor.planificador);
+}
+
+std::string atenderPareto(const std::unordered_map<std::string, std::string>& parametros, const ModeloParque& modelo, int& estado) {
+    auto inicio = parametros.find("inicio");
+    auto destino = parametros.find("destino");
+    if (inicio == parametros.end() || destino == parametros.end()) {
+        estado = 400;
+        return errorJSON("faltan los parametros inicio y destino");
+    }
+    auto tolerancia = parametros.find("tolerancia");
+    std::string linea = inicio->second + " " + destino->second + (tolerancia != parametros.end() ? " " + tolerancia->second : "");
+    ConsultaPareto consulta;
+    std::string error = interpretarPareto(linea.data(), linea.data() + linea.size(), modelo, consulta);
+    if (!error.empty()) {
+        estado = 400;
+        return errorJSON(error);
+    }
+    return *respuestaPareto(consulta, modelo);
+}
+
+std::string atenderAlternativas(ServidorParque& servidor, const std::unordered_map<std::string, std::string>& parametros, const ModeloParque& modelo, int& estado) {
+    auto inicio = parametros.find("inicio");
+    auto destino = parametros.find("destino");
+    if (inicio == parametros.end() || destino == parametros.end()) {
+        estado = 400;
+        return errorJSON("faltan los parametros inicio y destino");
+    }
+    auto k = parametros.find("k");
+    auto metodo = parametros.find("metodo");
+    std::string linea = inicio->second + " " + destino->second + (k != parametros.end() ? " " + k->second : "") +
+                        (metodo != parametros.end() ? " " + metodo->second : "");
+    ConsultaAlternativas consulta;
+    std::string error = interpretarAlternativas(linea.data(), linea.data() + linea.size(), modelo, consulta);
+    if (!error.empty()) {
+        estado = 400;
+        return errorJSON(error);
+    }
+    return *respuestaAlternativas(consulta, modelo, servidor.planificador);
+}
+
+// Función para leer un parámetro entero completo (sin texto sobrante); false si no es un número o se sale de int
+bool leerParametroEntero(const std::string& texto, int& valor) {
+    const char* fin = texto.data() + texto.size();
+    auto leido = std::from_chars(texto.data(), fin, valor);
+    return !texto.empty() && leido.ec == std::errc() && leido.ptr == fin;
+}
+
+// Recorre el árbol con las respuestas dadas; si faltan respuestas devuelve la siguiente pregunta
+std::string atenderClasificar(const std::unordered_map<std::string, std::string>& parametros, const ModeloParque& modelo, int& estado) {
+    CronometroEtapa cronometro(ETAPA_CLASIFICAR);
+    std::vector<bool> respuestas;
+    auto texto = parametros.find("respuestas");
+    if (texto != parametros.end()) {
+        std::stringstream ss(texto->second);
+        std::string respuesta;
+        while (std::getline(ss, respuesta, ',')) {
+            if (respuesta == "1" || respuesta == "si" || respuesta == "s") {
+                respuestas.push_back(true);
+            } else if (respuesta == "2" || respuesta == "no" || respuesta == "n") {
+                respuestas.push_back(false);
+            } else {
+                estado = 400;
+                return errorJSON("respuesta no valida: " + respuesta);
             }
         }
+    }
 
-        if (inicio_indice == -1) {
-            std::cerr << "Error: Identificador de atraccion de inicio no encontrado.\n";
-            return;
+    ConjuntoAtracciones sugeridas;
+    std::size_t respondidas = 0;
+#ifdef ARBOL_COMPILADO
+    int siguientePregunta = -1;
+    arbol_compilado::Hoja hoja = arbol_compilado::clasificar([&](int indice) {
+        if (siguientePregunta != -1) return false;
+        if (respondidas == respuestas.size()) {
+            siguientePregunta = indice;
+            return false;
         }
+        return static_cast<bool>(respuestas[respondidas++]);
+    });
+    if (siguientePregunta != -1) {
+        return "{\"pregunta\":\"" + escaparJSON(arbol_compilado::preguntas[siguientePregunta]) + "\",\"respondidas\":" + std::to_string(respondidas) + "}";
+    }
+    sugeridas = conjuntoDesdeIdentificadores(std::vector<int>(hoja.identificadores, hoja.identificadores + hoja.cantidad), modelo.atracciones);
+#else
+    const Nodo* nodo = modelo.arbol.get();
+    while (nodo && (nodo->izquierda || nodo->derecha)) {
+        if (respondidas == respuestas.size()) {
+            return "{\"pregunta\":\"" + escaparJSON(nodo->pregunta) + "\",\"respondidas\":" + std::to_string(respondidas) + "}";
+        }
+        nodo = respuestas[respondidas++] ? nodo->izquierda : nodo->derecha;
+    }
+    if (!nodo) {
+        estado = 500;
+        return errorJSON("el arbol de decisiones no tiene esa rama");
+    }
+    sugeridas = nodo->conjunto;
+#endif
 
-        auto resultados_dijkstra = dijkstra(grafo, inicio_indice, seleccionadas, atracciones);
-        std::vector<int> distancias = resultados_dijkstra.first;
-        std::vector<int> predecesores = resultados_dijkstra.second;
-
-        // Imprimir las distancias mínimas a cada atracción seleccionada
-        std::cout << "\nDistancias desde la atraccion de inicio (" << atracciones[inicio_indice].nombre << "):\n";
-        for (int id : seleccionadas) {
-            std::cout << "Identificador: " << id << ", Distancia: " << distancias[id - 1] << " metros\n";
+    intersectar(sugeridas, modelo.abiertas);
+    auto accesible = parametros.find("accesible");
+    if (accesible != parametros.end() && accesible->second != "0") {
+        intersectar(sugeridas, modelo.accesibles);
+    }
+    auto espera = parametros.find("espera_menor_a");
+    if (espera != parametros.end()) {
+        int limite;
+        if (!leerParametroEntero(espera->second, limite)) {
+            estado = 400;
+            return errorJSON("espera_menor_a invalido");
         }
+        quitarEsperaDesde(sugeridas, modelo.atracciones, limite);
+    }
 
-        // Imprimir la ruta más eficiente
-        imprimirRuta(predecesores, atracciones);
+    std::string cuerpo = "{\"identificadores\":";
+    escribirListaJSON(cuerpo, identificadoresDelConjunto(sugeridas, modelo.atracciones));
+    cuerpo += ",\"respondidas\":" + std::to_string(respondidas) + "}";
+    return cuerpo;
+}
 
-        return;
+// Cambia el estado del parque, así que solo se acepta por POST
+std::string atenderEspera(ServidorParque& servidor, const std::string& metodo, const std::unordered_map<std::string, std::string>& parametros, int& estado) {
+    if (metodo != "POST") {
+        estado = 405;
+        return errorJSON("/espera solo acepta POST");
+    }
+    auto id = parametros.find("id");
+    auto tiempo = parametros.find("tiempo");
+    if (id == parametros.end() || tiempo == parametros.end()) {
+        estado = 400;
+        return errorJSON("faltan los parametros id y tiempo");
+    }
+    int identificador;
+    int nuevoTiempo;
+    if (!leerParametroEntero(id->second, identificador)) {
+        estado = 400;
+        return errorJSON("identificador invalido");
+    }
+    if (!leerParametroEntero(tiempo->second, nuevoTiempo)) {
+        estado = 400;
+        return errorJSON("tiempo de espera invalido");
+    }
+    if (nuevoTiempo < 0 || nuevoTiempo > MAX_TIEMPO_ESPERA) {
+        estado = 400;
+        return errorJSON("tiempo de espera fuera de rango (0 a " + std::to_string(MAX_TIEMPO_ESPERA) + " minutos)");
     }
 
-    // Hacer pregunta
-    std::cout << nodo->pregunta << " (1. Si / 2. No): ";
-    int respuesta;
-    std::cin >> respuesta;
-    if (respuesta == 1) {
-        usarArbolDecisiones(nodo->izquierda, atracciones, grafo);
-    } else if (respuesta == 2) {
-        usarArbolDecisiones(nodo->derecha, atracciones, grafo);
+    std::lock_guard<std::mutex> bloqueo(mutexEdicionModelo);
+    auto anterior = modeloActual();
+    auto editado = std::make_shared<ModeloParque>(*anterior);
+    if (!actualizarTiempoEspera(editado->atracciones, identificador, nuevoTiempo)) {
+        estado = 404;
+        return errorJSON("identificador de atraccion no encontrado");
+    }
+    // La jerarquía tiene las esperas en sus pesos: hasta que se reconstruya, las consultas usan la búsqueda bidireccional
+    editado->jerarquia = nullptr;
+    prepararCRP(*editado, anterior.get());
+    publicarModelo(editado);
+    pedirJerarquia();
+    guardarTiempoEspera(servidor.archivos.atracciones, editado->atracciones);
+    return "{\"id\":" + std::to_string(identificador) + ",\"tiempo_espera\":" + std::to_string(nuevoTiempo) +
+           ",\"epoca\":" + std::to_string(editado->epoca) + "}";
+}
+
+std::string atenderMetricas(ServidorParque& servidor) {
+    std::string cuerpo = "{\"peticiones\":" + std::to_string(servidor.peticiones.load()) +
+                         ",\"errores\":" + std::to_string(servidor.errores.load()) +
+                         ",\"epoca\":" + std::to_string(modeloActual()->epoca) +
+                         ",\"coalescencia\":{\"calculadas\":" + std::to_string(coalescedorRutas.calculadas.load()) +
+                         ",\"compartidas\":" + std::to_string(coalescedorRutas.compartidas.load()) + "}" +
+                         ",\"cache\":{\"aciertos\":" + std::to_string(cacheRutas.aciertos.load()) +
+                         ",\"fallos\":" + std::to_string(cacheRutas.fallos.load()) +
+                         ",\"expulsiones\":" + std::to_string(cacheRutas.expulsiones.load()) +
+                         ",\"entradas\":" + std::to_string(entradasEnCache(cacheRutas)) + "}" +
+                         ",\"latencia_us\":{\"p50\":" + std::to_string(percentil(servidor.latencia, 0.50) / 1000.0) +
+                         ",\"p99\":" + std::to_string(percentil(servidor.latencia, 0.99) / 1000.0) +
+                         ",\"max\":" + std::to_string(servidor.latencia.maximo.load() / 1000.0) + "}" +
+                         ",\"instrumentacion\":" + instrumentacionJSON() + "}";
+    return cuerpo;
+}
+
+// Resuelve una petición ya separada en método, ruta y parámetros
+std::string atenderPeticion(ServidorParque& servidor, const std::string& metodo, const std::string& objetivo, const std::string& cuerpo, int& estado) {
+    std::size_t interrogacion = objetivo.find('?');
+    std::string ruta = objetivo.substr(0, interrogacion);
+    auto parametros = leerParametros(interrogacion == std::string::npos ? "" : objetivo.substr(interrogacion + 1));
+    if (metodo == "POST") {
+        for (auto& parametro : leerParametros(cuerpo)) {
+            parametros[parametro.first] = parametro.second;
+        }
+    } else if (metodo != "GET") {
+        estado = 405;
+        return errorJSON("metodo no permitido");
+    }
+
+    std::shared_ptr<const ModeloParque> modelo = modeloActual();
+    if (ruta == "/ruta") return atenderRuta(parametros, *modelo, estado);
+    if (ruta == "/recorrido") return atenderRecorrido(servidor, parametros, *modelo, estado);
+    if (ruta == "/plan") return atenderPlan(servidor, parametros, *modelo, estado);
+    if (ruta == "/pareto") return atenderPareto(parametros, *modelo, estado);
+    if (ruta == "/alternativas") return atenderAlternativas(servidor, parametros, *modelo, estado);
+    if (ruta == "/clasificar") return atenderClasificar(parametros, *modelo, estado);
+    if (ruta == "/espera") return atenderEspera(servidor, metodo, parametros, estado);
+    if (ruta == "/metricas") return atenderMetricas(servidor);
+    estado = 404;
+    return errorJSON("ruta desconocida");
+}
+
+std::string respuestaHTTP(int estado, const std::string& cuerpo, bool cerrar) {
+    const char* motivo = estado == 200 ? "OK" : estado == 400 ? "Bad Request" : estado == 404 ? "Not Found" :
+                         estado == 405 ? "Method Not Allowed" : estado == 431 ? "Request Header Fields Too Large" : "Internal Server Error";
+    std::string respuesta = "HTTP/1.1 " + std::to_string(estado) + " " + motivo + "\r\n";
+    respuesta += "Content-Type: application/json\r\n";
+    respuesta += "Content-Length: " + std::to_string(cuerpo.size()) + "\r\n";
+    respuesta += cerrar ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    respuesta += cuerpo;
+    return respuesta;
+}
+
+#ifdef __linux__
+
+std::atomic<bool> detenerServidor{false};
+
+void senalDetenerServidor(int) {
+    detenerServidor = true;
+}
+
+// Crea el socket de escucha: "unix:/ruta/al/socket", "puerto" o "127.0.0.1:puerto"
+int crearSocketEscucha(const std::string& direccion) {
+    int fd;
+    if (direccion.rfind("unix:", 0) == 0) {
+        std::string ruta = direccion.substr(5);
+        sockaddr_un dir = {};
+        dir.sun_family = AF_UNIX;
+        if (ruta.size() >= sizeof(dir.sun_path)) return -1;
+        std::strcpy(dir.sun_path, ruta.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(ruta.c_str());
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&dir), sizeof(dir)) < 0) return -1;
     } else {
-        std::cout << "Respuesta no valida. Intente de nuevo.\n";
-        usarArbolDecisiones(nodo, atracciones, grafo);
+        std::size_t dosPuntos = direccion.rfind(':');
+        int puerto = std::atoi(dosPuntos == std::string::npos ? direccion.c_str() : direccion.c_str() + dosPuntos + 1);
+        sockaddr_in dir = {};
+        dir.sin_family = AF_INET;
+        dir.sin_port = htons(static_cast<std::uint16_t>(puerto));
+        dir.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int uno = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&dir), sizeof(dir)) < 0) return -1;
     }
+    if (listen(fd, 1024) < 0) return -1;
+    return fd;
 }
 
+// Estado de una conexión; solo lo toca el hilo de epoll
+struct ConexionHTTP {
+    std::uint64_t generacion = 0;
+    std::string entrada;
+    std::string salida;
+    std::size_t enviados = 0;
+    bool ocupada = false;  // Un trabajador está resolviendo su petición
+    bool cerrarAlTerminar = false;
+    bool tcp = false;
+};
 
-//---------------------------------------------------------------
+// Respuesta que un trabajador deja para el hilo de epoll
+struct RespuestaLista {
+    int fd;
+    std::uint64_t generacion;
+    std::string datos;
+    bool cerrar;
+};
 
-// Función para seleccionar manualmente las atracciones 
+struct BucleServidor {
+    int epoll = -1;
+    int escucha = -1;
+    int aviso = -1; // eventfd con el que los trabajadores despiertan a epoll
+    bool escuchaTCP = false;
+    std::unordered_map<int, ConexionHTTP> conexiones;
+    std::uint64_t ultimaGeneracion = 0;
+    std::mutex mutexListas;
+    std::vector<RespuestaLista> listas;
+};
 
-void seleccionManualDeAtracciones(const Grafo& grafo, const std::vector<Atraccion>& atracciones) {
-    std::cout << "Lista de atracciones disponibles:\n";
-    for (const auto& atraccion : atracciones) {
-        std::cout << "Identificador: " << atraccion.identificador << ", Nombre: " << atraccion.nombre << ", Tiempo de espera: " << atraccion.tiempo_espera << " minutos\n";
+void cerrarConexion(BucleServidor& bucle, int fd) {
+    epoll_ctl(bucle.epoll, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    bucle.conexiones.erase(fd);
+}
+
+void despacharPeticion(ServidorParque& servidor, BucleServidor& bucle, int fd);
+
+void escribirConexion(ServidorParque& servidor, BucleServidor& bucle, int fd) {
+    auto it = bucle.conexiones.find(fd);
+    if (it == bucle.conexiones.end()) return;
+    ConexionHTTP& conexion = it->second;
+    while (conexion.enviados < conexion.salida.size()) {
+        ssize_t escritos = send(fd, conexion.salida.data() + conexion.enviados, conexion.salida.size() - conexion.enviados, MSG_NOSIGNAL);
+        if (escritos < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            epoll_event evento = {};
+            evento.events = EPOLLIN | EPOLLOUT;
+            evento.data.fd = fd;
+            epoll_ctl(bucle.epoll, EPOLL_CTL_MOD, fd, &evento);
+            return;
+        }
+        if (escritos <= 0) {
+            cerrarConexion(bucle, fd);
+            return;
+        }
+        conexion.enviados += static_cast<std::size_t>(escritos);
+    }
+    conexion.salida.clear();
+    conexion.enviados = 0;
+    if (conexion.cerrarAlTerminar) {
+        cerrarConexion(bucle, fd);
+        return;
     }
+    epoll_event evento = {};
+    evento.events = EPOLLIN;
+    evento.data.fd = fd;
+    epoll_ctl(bucle.epoll, EPOLL_CTL_MOD, fd, &evento);
+    // Puede haber otra petición encadenada en el buffer
+    despacharPeticion(servidor, bucle, fd);
+}
 
-    std::cout << "Ingrese el identificador de la atraccion de inicio: ";
-    int inicio_id;
-    std::cin >> inicio_id;
+// Si hay una petición completa en el buffer, la envía a un trabajador
+void despacharPeticion(ServidorParque& servidor, BucleServidor& bucle, int fd) {
+    auto it = bucle.conexiones.find(fd);
+    if (it == bucle.conexiones.end()) return;
+    ConexionHTTP& conexion = it->second;
+    if (conexion.ocupada || !conexion.salida.empty()) return;
 
-    // Encontrar el índice en el vector de atracciones
-    int inicio_indice = -1;
-    for (int i = 0; i < atracciones.size(); ++i) {
-        if (atracciones[i].identificador == inicio_id) {
-            inicio_indice = i;
-            break;
+    const std::size_t maximoPeticion = 64 * 1024;
+    std::size_t finCabecera = conexion.entrada.find("\r\n\r\n");
+    if (finCabecera == std::string::npos) {
+        if (conexion.entrada.size() > maximoPeticion) {
+            conexion.salida = respuestaHTTP(431, errorJSON("peticion demasiado grande"), true);
+            conexion.cerrarAlTerminar = true;
+            escribirConexion(servidor, bucle, fd);
         }
+        return;
     }
 
-    if (inicio_indice == -1) {
-        std::cerr << "Error: Identificador de atraccion de inicio no encontrado.\n";
+    std::string cabecera = conexion.entrada.substr(0, finCabecera);
+    std::string minusculas = cabecera;
+    std::transform(minusculas.begin(), minusculas.end(), minusculas.begin(), [](unsigned char c) { return std::tolower(c); });
+    std::size_t largoCuerpo = 0;
+    std::size_t posicionLargo = minusculas.find("\r\ncontent-length:");
+    if (posicionLargo != std::string::npos) {
+        largoCuerpo = std::strtoul(cabecera.c_str() + posicionLargo + 17, nullptr, 10);
+    }
+    if (largoCuerpo > maximoPeticion) {
+        conexion.salida = respuestaHTTP(431, errorJSON("peticion demasiado grande"), true);
+        conexion.cerrarAlTerminar = true;
+        escribirConexion(servidor, bucle, fd);
         return;
     }
+    if (conexion.entrada.size() < finCabecera + 4 + largoCuerpo) return;
 
-    std::cout << "Ingrese los identificadores de las atracciones a visitar (separados por espacios) o 'todos' para visitar todas: ";
-    std::vector<int> seleccionadas;
-    std::string entrada;
-    std::cin.ignore();
-    std::getline(std::cin, entrada);
+    std::string cuerpo = conexion.entrada.substr(finCabecera + 4, largoCuerpo);
+    conexion.entrada.erase(0, finCabecera + 4 + largoCuerpo);
 
-    if (entrada == "todos") {
-        for (const auto& atraccion : atracciones) {
-            seleccionadas.push_back(atraccion.identificador);
+    std::istringstream lineaPeticion(cabecera.substr(0, cabecera.find("\r\n")));
+    std::string metodo, objetivo, version;
+    lineaPeticion >> metodo >> objetivo >> version;
+    bool cerrar = version == "HTTP/1.0" ? minusculas.find("connection: keep-alive") == std::string::npos
+                                        : minusculas.find("connection: close") != std::string::npos;
+
+    conexion.ocupada = true;
+    std::uint64_t generacion = conexion.generacion;
+    auto llegada = std::chrono::steady_clock::now();
+    enviarTarea(servidor.planificador, [&servidor, &bucle, fd, generacion, metodo, objetivo, cuerpo, cerrar, llegada]() {
+        int estado = 200;
+        std::string respuesta;
+        try {
+            respuesta = atenderPeticion(servidor, metodo, objetivo, cuerpo, estado);
+        } catch (const std::exception& e) {
+            estado = 500;
+            respuesta = errorJSON(e.what());
         }
-    } else {
-        std::istringstream iss(entrada);
-        int identificador;
-        while (iss >> identificador) {
-            seleccionadas.push_back(identificador);
+        servidor.peticiones.fetch_add(1, std::memory_order_relaxed);
+        if (estado != 200) servidor.errores.fetch_add(1, std::memory_order_relaxed);
+        RespuestaLista lista = {fd, generacion, respuestaHTTP(estado, respuesta, cerrar), cerrar};
+        auto terminada = std::chrono::steady_clock::now();
+        registrarValor(servidor.latencia, std::chrono::duration_cast<std::chrono::nanoseconds>(terminada - llegada).count());
+        // El tramo empieza al llegar la petición, así incluye la espera en la cola del planificador
+        if (trazaActiva()) registrarTramo("peticion", llegada, terminada, (metodo + " " + objetivo).c_str());
+        {
+            std::lock_guard<std::mutex> bloqueo(bucle.mutexListas);
+            bucle.listas.push_back(std::move(lista));
         }
+        std::uint64_t uno = 1;
+        ssize_t escrito = write(bucle.aviso, &uno, sizeof(uno));
+        (void)escrito;
+    });
+}
+
+void aceptarConexiones(BucleServidor& bucle) {
+    while (true) {
+        int fd = accept4(bucle.escucha, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (bucle.escuchaTCP) {
+            int uno = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+        }
+        ConexionHTTP& conexion = bucle.conexiones[fd];
+        conexion = ConexionHTTP();
+        conexion.generacion = ++bucle.ultimaGeneracion;
+        epoll_event evento = {};
+        evento.events = EPOLLIN;
+        evento.data.fd = fd;
+        epoll_ctl(bucle.epoll, EPOLL_CTL_ADD, fd, &evento);
     }
+}
 
-    auto resultados_dijkstra = dijkstra(grafo, inicio_indice, seleccionadas, atracciones);
-    std::vector<int> distancias = resultados_dijkstra.first;
-    std::vector<int> predecesores = resultados_dijkstra.second;
+void leerConexion(ServidorParque& servidor, BucleServidor& bucle, int fd) {
+    auto it = bucle.conexiones.find(fd);
+    if (it == bucle.conexiones.end()) return;
+    char buffer[16 * 1024];
+    while (true) {
+        ssize_t leidos = recv(fd, buffer, sizeof(buffer), 0);
+        if (leidos > 0) {
+            it->second.entrada.append(buffer, static_cast<std::size_t>(leidos));
+            continue;
+        }
+        if (leidos < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        // El cliente cerró o hubo un error; si hay una petición en curso su respuesta se descarta
+        cerrarConexion(bucle, fd);
+        return;
+    }
+    despacharPeticion(servidor, bucle, fd);
+}
 
-    // Imprimir las distancias mínimas a cada atracción seleccionada
-    std::cout << "  \n";
-    std::cout << "Distancias desde la atraccion de inicio (" << atracciones[inicio_indice].nombre << "):\n";
-    for (int i = 0; i < seleccionadas.size(); ++i) {
-        int id = seleccionadas[i];
-        std::cout << "Identificador: " << id << ", Distancia: " << distancias[id - 1] << " metros\n"; 
+void entregarRespuestas(ServidorParque& servidor, BucleServidor& bucle) {
+    std::uint64_t valor;
+    ssize_t leido = read(bucle.aviso, &valor, sizeof(valor));
+    (void)leido;
+    std::vector<RespuestaLista> listas;
+    {
+        std::lock_guard<std::mutex> bloqueo(bucle.mutexListas);
+        listas.swap(bucle.listas);
+    }
+    for (auto& lista : listas) {
+        auto it = bucle.conexiones.find(lista.fd);
+        // La conexión pudo cerrarse y su descriptor reutilizarse mientras el trabajador respondía
+        if (it == bucle.conexiones.end() || it->second.generacion != lista.generacion) continue;
+        it->second.ocupada = false;
+        it->second.salida = std::move(lista.datos);
+        it->second.enviados = 0;
+        it->second.cerrarAlTerminar = lista.cerrar;
+        escribirConexion(servidor, bucle, lista.fd);
     }
+}
 
-    // Imprimir la ruta más eficiente
-    imprimirRuta(predecesores, atracciones);
+int ejecutarServidor(const std::string& direccion, unsigned numHilos, const ArchivosParque& archivos) {
+    ServidorParque servidor;
+    servidor.archivos = archivos;
+    BucleServidor bucle;
+    bucle.escucha = crearSocketEscucha(direccion);
+    if (bucle.escucha < 0) {
+        std::cerr << "Error: No se pudo escuchar en " << direccion << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    bucle.escuchaTCP = direccion.rfind("unix:", 0) != 0;
+    bucle.epoll = epoll_create1(EPOLL_CLOEXEC);
+    bucle.aviso = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event evento = {};
+    evento.events = EPOLLIN;
+    evento.data.fd = bucle.escucha;
+    epoll_ctl(bucle.epoll, EPOLL_CTL_ADD, bucle.escucha, &evento);
+    evento.data.fd = bucle.aviso;
+    epoll_ctl(bucle.epoll, EPOLL_CTL_ADD, bucle.aviso, &evento);
+
+    detenerServidor = false;
+    std::signal(SIGINT, senalDetenerServidor);
+    std::signal(SIGTERM, senalDetenerServidor);
+    iniciarPlanificador(servidor.planificador, numHilos);
+    std::cout << "Servidor escuchando en " << direccion << " con " << numHilos << " trabajadores." << std::endl;
+
+    epoll_event eventos[256];
+    while (!detenerServidor) {
+        int listos = epoll_wait(bucle.epoll, eventos, 256, 200);
+        atenderVolcadoPedido();
+        for (int i = 0; i < listos; ++i) {
+            int fd = eventos[i].data.fd;
+            if (fd == bucle.escucha) {
+                aceptarConexiones(bucle);
+            } else if (fd == bucle.aviso) {
+                entregarRespuestas(servidor, bucle);
+            } else if (eventos[i].events & (EPOLLERR | EPOLLHUP)) {
+                cerrarConexion(bucle, fd);
+            } else {
+                if (eventos[i].events & EPOLLIN) leerConexion(servidor, bucle, fd);
+                if (eventos[i].events & EPOLLOUT) escribirConexion(servidor, bucle, fd);
+            }
+        }
+    }
+
+    detenerPlanificador(servidor.planificador);
+    for (auto& conexion : bucle.conexiones) {
+        close(conexion.first);
+    }
+    close(bucle.escucha);
+    close(bucle.aviso);
+    close(bucle.epoll);
+    if (!bucle.escuchaTCP) unlink(direccion.substr(5).c_str());
+
+    std::cout << "Servidor detenido: " << servidor.peticiones.load() << " peticiones, latencia p50 "
+              << percentil(servidor.latencia, 0.50) / 1000.0 << " us, p99 " << percentil(servidor.latencia, 0.99) / 1000.0 << " us." << std::endl;
+    return 0;
+}
+
+//--------------------------------------------------------
+
+// Generador de carga: varias conexiones persistentes que piden rutas y miden la latencia de cada respuesta
+
+int conectarServidor(const std::string& direccion) {
+    int fd;
+    if (direccion.rfind("unix:", 0) == 0) {
+        sockaddr_un dir = {};
+        dir.sun_family = AF_UNIX;
+        std::strncpy(dir.sun_path, direccion.c_str() + 5, sizeof(dir.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&dir), sizeof(dir)) < 0) return -1;
+    } else {
+        std::size_t dosPuntos = direccion.rfind(':');
+        int puerto = std::atoi(dosPuntos == std::string::npos ? direccion.c_str() : direccion.c_str() + dosPuntos + 1);
+        sockaddr_in dir = {};
+        dir.sin_family = AF_INET;
+        dir.sin_port = htons(static_cast<std::uint16_t>(puerto));
+        dir.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&dir), sizeof(dir)) < 0) return -1;
+        int uno = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+    }
+    return fd;
+}
+
+// Envía una petición y lee la respuesta completa; devuelve false si la conexión falla
+bool peticionHTTP(int fd, const std::string& peticion, std::string& buffer) {
+    std::size_t enviados = 0;
+    while (enviados < peticion.size()) {
+        ssize_t escritos = send(fd, peticion.data() + enviados, peticion.size() - enviados, MSG_NOSIGNAL);
+        if (escritos <= 0) return false;
+        enviados += static_cast<std::size_t>(escritos);
+    }
+    char datos[16 * 1024];
+    while (true) {
+        std::size_t finCabecera = buffer.find("\r\n\r\n");
+        if (finCabecera != std::string::npos) {
+            std::size_t posicion = buffer.find("Content-Length: ");
+            std::size_t largo = posicion < finCabecera ? std::strtoul(buffer.c_str() + posicion + 16, nullptr, 10) : 0;
+            if (buffer.size() >= finCabecera + 4 + largo) {
+                buffer.erase(0, finCabecera + 4 + largo);
+                return true;
+            }
+        }
+        ssize_t leidos = recv(fd, datos, sizeof(datos), 0);
+        if (leidos <= 0) return false;
+        buffer.append(datos, static_cast<std::size_t>(leidos));
+    }
+}
+
+int ejecutarCarga(const std::string& direccion, int numConexiones, int peticionesPorConexion) {
+    std::vector<Atraccion> atracciones = leerAtracciones(ArchivosParque().atracciones);
+    int numAtracciones = std::max<int>(1, static_cast<int>(atracciones.size()));
+
+    HistogramaLatencia latencia;
+    std::atomic<long long> fallidas{0};
+    auto comienzo = std::chrono::steady_clock::now();
+    std::vector<std::thread> clientes;
+    for (int c = 0; c < numConexiones; ++c) {
+        clientes.emplace_back([&, c]() {
+            int fd = conectarServidor(direccion);
+            if (fd < 0) {
+                fallidas += peticionesPorConexion;
+                return;
+            }
+            std::uint64_t semilla = 0x9E3779B97F4A7C15ULL * (c + 1);
+            auto aleatorio = [&semilla](int limite) {
+                semilla ^= semilla << 13;
+                semilla ^= semilla >> 7;
+                semilla ^= semilla << 17;
+                return static_cast<int>(semilla % static_cast<std::uint64_t>(limite)) + 1;
+            };
+            std::string buffer;
+            for (int i = 0; i < peticionesPorConexion; ++i) {
+                std::string objetivo = "/ruta?inicio=" + std::to_string(aleatorio(numAtracciones)) + "&destinos=";
+                if (aleatorio(5) == 1) {
+                    objetivo += "todos";
+                } else {
+                    int cantidad = aleatorio(3);
+                    for (int k = 0; k < cantidad; ++k) {
+                        objetivo += (k ? "," : "") + std::to_string(aleatorio(numAtracciones));
+                    }
+                }
+                std::string peticion = "GET " + objetivo + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+                auto envio = std::chrono::steady_clock::now();
+                if (!peticionHTTP(fd, peticion, buffer)) {
+                    fallidas += peticionesPorConexion - i;
+                    break;
+                }
+                registrarValor(latencia, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - envio).count());
+            }
+            close(fd);
+        });
+    }
+    for (auto& cliente : clientes) {
+        cliente.join();
+    }
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - comienzo).count();
+    std::uint64_t completadas = latencia.total.load();
+    std::cout << completadas << " peticiones en " << segundos << " s (" << completadas / segundos << " peticiones/s), "
+              << fallidas.load() << " fallidas\n";
+    std::cout << "Latencia: p50 " << percentil(latencia, 0.50) / 1000.0 << " us, p99 " << percentil(latencia, 0.99) / 1000.0
+              << " us, max " << latencia.maximo.load() / 1000.0 << " us" << std::endl;
+    return fallidas.load() == 0 ? 0 : 1;
 }
 
+#endif
+
+//--------------------------------------------------------
+
+void mostrarUso() {
+    std::cout << "Uso: Main [opciones]\n";
+    std::cout << "  (sin opciones)          Menu interactivo\n";
+    std::cout << "  --lote [archivo|-]      Resolver consultas por lotes (una por linea) y responder en JSON\n";
+    std::cout << "                          (\"plan INICIO MINUTOS [PLAZO_MS]\" arma la visita con mas atracciones en ese tiempo)\n";
+    std::cout << "                          (\"pareto INICIO DESTINO [TOLERANCIA%]\" da las rutas que equilibran metros y minutos de fila)\n";
+    std::cout << "                          (\"alternativas INICIO DESTINO [K] [penalizacion]\" da K rutas distintas, Yen por defecto)\n";
+    std::cout << "  --servidor [direccion]  Servidor HTTP en localhost: puerto (8080 por defecto) o unix:/ruta/socket\n";
+    std::cout << "  --carga direccion [conexiones] [peticiones]  Medir la latencia de un servidor en marcha\n";
+    std::cout << "  --mapa ID               Distancias desde ID hacia todo el parque en CSV (delta-stepping en paralelo)\n";
+    std::cout << "  --delta D               Ancho de cubeta de --mapa (por defecto el costo promedio de una arista)\n";
+    std::cout << "  --hilos N               Numero de hilos trabajadores\n";
+    std::cout << "  --plazo-plan MS         Tiempo maximo de busqueda local de cada plan (" << PLAZO_PLAN_MS << " ms por defecto)\n";
+    std::cout << "  --cache N               Respuestas de ruta guardadas en cache (4096 por defecto, 0 la desactiva)\n";
+    std::cout << "  --motor nombre          Busqueda para consultas de un solo destino: bidireccional (por defecto), dijkstra, alt, ch o crp\n";
+    std::cout << "                          (ch y crp tambien resuelven los recorridos con su preproceso)\n";
+    std::cout << "  --hora HH:MM            Salir a esa hora: las rutas de un destino y los recorridos usan la espera prevista al llegar\n";
+    std::cout << "                          a cada atraccion (perfiles_espera.csv: identificador,minuto,espera)\n";
+    std::cout << "  --marcas K              Cantidad de marcas que se calculan al cargar el grafo para --motor alt (por defecto " << MARCAS_POR_DEFECTO << ")\n";
+    std::cout << "  --jerarquia archivo     Con --motor ch, guarda la jerarquia de contraccion y la reutiliza si el parque no cambio\n";
+    std::cout << "  --instrumentar          Medir cada etapa y volcar los histogramas al salir (y con kill -USR1)\n";
+    std::cout << "  --trazar archivo.json   Guardar al salir una traza de eventos para chrome://tracing o Perfetto\n";
+}
 
 //--------------------------------------------------------
-int main() {
-    Grafo grafo;
-    construirGrafo(grafo, "grafo.csv");
-    Nodo* arbolDecisiones = leerArbolDecisiones("decisiones.json");
-    std::vector<Atraccion> atracciones = leerAtracciones("atracciones.json");
+// Benchmark.cpp incluye este archivo con PARQUE_SIN_MAIN definido para medir las funciones sin el programa
+#ifndef PARQUE_SIN_MAIN
+int main(int argc, char* argv[]) {
+    std::string modo = "menu";
+    std::string archivoLote = "-";
+    unsigned numHilos = hilosPorDefecto();
+    std::string direccion = "8080";
+    int numConexiones = 16;
+    int peticionesPorConexion = 10000;
+    int inicioMapa = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string opcion = argv[i];
+        if (opcion == "--lote") {
+            modo = "lote";
+            if (i + 1 < argc && argv[i + 1][0] != '-') archivoLote = argv[++i];
+            else if (i + 1 < argc && std::string(argv[i + 1]) == "-") ++i;
+        } else if (opcion == "--servidor") {
+            modo = "servidor";
+            if (i + 1 < argc && argv[i + 1][0] != '-') direccion = argv[++i];
+        } else if (opcion == "--carga" && i + 1 < argc) {
+            modo = "carga";
+            direccion = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') numConexiones = std::max(1, std::atoi(argv[++i]));
+            if (i + 1 < argc && argv[i + 1][0] != '-') peticionesPorConexion = std::max(1, std::atoi(argv[++i]));
+        } else if (opcion == "--mapa" && i + 1 < argc) {
+            modo = "mapa";
+            inicioMapa = std::atoi(argv[++i]);
+        } else if (opcion == "--delta" && i + 1 < argc) {
+            deltaMapa = std::max(1, std::atoi(argv[++i]));
+        } else if (opcion == "--hilos" && i + 1 < argc) {
+            numHilos = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (opcion == "--trazar" && i + 1 < argc) {
+            activarTraza(argv[++i]);
+        } else if (opcion == "--motor" && i + 1 < argc && interpretarMotor(argv[i + 1])) {
+            ++i;
+        } else if (opcion == "--marcas" && i + 1 < argc) {
+            marcasAlCargar = std::max(0, std::atoi(argv[++i]));
+        } else if (opcion == "--jerarquia" && i + 1 < argc) {
+            archivoJerarquia = argv[++i];
+        } else if (opcion == "--hora" && i + 1 < argc) {
+            int horas = 0, minutos = 0;
+            if (std::sscanf(argv[++i], "%d:%d", &horas, &minutos) != 2 || horas < 0 || horas > 23 || minutos < 0 || minutos > 59) {
+                mostrarUso();
+                return 1;
+            }
+            horaSalidaConsultas = (horas * 60 + minutos) * 60;
+        } else if (opcion == "--instrumentar") {
+            activarInstrumentacion();
+        } else if (opcion == "--plazo-plan" && i + 1 < argc) {
+            plazoPlanMs = std::min(MAX_PLAZO_PLAN_MS, std::max(0, std::atoi(argv[++i])));
+        } else if (opcion == "--cache" && i + 1 < argc) {
+            configurarCache(cacheRutas, static_cast<std::size_t>(std::max(0, std::atoi(argv[++i]))));
+        } else {
+            mostrarUso();
+            return opcion == "--ayuda" ? 0 : 1;
+        }
+    }
+    if (marcasAlCargar < 0) {
+        marcasAlCargar = motorPuntoAPunto == MOTOR_ALT ? MARCAS_POR_DEFECTO : 0;
+    }
+    jerarquiaAlCargar = motorPuntoAPunto == MOTOR_CH;
+    crpAlCargar = motorPuntoAPunto == MOTOR_CRP;
+
+    if (modo == "lote" || modo == "mapa") {
+        std::ios::sync_with_stdio(false);
+        publicarModelo(cargarModelo(ArchivosParque()));
+        if (!modeloValido(*modeloActual())) {
+            std::cerr << "Error: Los archivos del parque no son validos." << std::endl;
+            return 1;
+        }
+        return modo == "mapa" ? ejecutarMapa(inicioMapa, numHilos) : ejecutarLote(archivoLote, numHilos);
+    }
+
+    if (modo == "servidor" || modo == "carga") {
+#ifdef __linux__
+        if (modo == "carga") {
+            return ejecutarCarga(direccion, numConexiones, peticionesPorConexion);
+        }
+        ArchivosParque archivos;
+        publicarModelo(cargarModelo(archivos));
+        if (!modeloValido(*modeloActual())) {
+            std::cerr << "Error: Los archivos del parque no son validos." << std::endl;
+            return 1;
+        }
+        RecargaParque recarga;
+        iniciarRecarga(recarga, archivos);
+        int resultado = ejecutarServidor(direccion, numHilos, archivos);
+        detenerRecarga(recarga);
+        esperarJerarquia();
+        return resultado;
+#else
+        std::cerr << "Error: El modo servidor solo esta disponible en Linux." << std::endl;
+        return 1;
+#endif
+    }
+
+    ArchivosParque archivos;
+    publicarModelo(cargarModelo(archivos));
+
+    RecargaParque recarga;
+    iniciarRecarga(recarga, archivos);
 
     bool salir = false;
     while (!salir) {
+        atenderVolcadoPedido();
         mostrarMenu();
         int opcion;
         std::cin >> opcion;
+        // Cada opción trabaja sobre la versión vigente del parque al momento de elegirla
+        std::shared_ptr<const ModeloParque> modelo = modeloActual();
         switch (opcion) {
             case 1:
-                usarArbolDecisiones(arbolDecisiones, atracciones, grafo);
+#ifdef ARBOL_COMPILADO
+                usarArbolCompilado(*modelo);
+#else
+                usarArbolDecisiones(modelo->arbol.get(), *modelo);
+#endif
                 break;
             case 2:
-                seleccionManualDeAtracciones(grafo, atracciones);
+                seleccionManualDeAtracciones(*modelo->grafo, modelo->atracciones);
                 break;
-            case 3:
-                editarTiempoEspera(atracciones);
-                guardarTiempoEspera("atracciones.json", atracciones);
+            case 3: {
+                int identificador;
+                int nuevoTiempo;
+                if (!editarTiempoEspera(modelo->atracciones, identificador, nuevoTiempo)) break;
+                // Copia y publicación: las consultas en curso no ven el cambio a medias
+                std::lock_guard<std::mutex> bloqueo(mutexEdicionModelo);
+                auto anterior = modeloActual();
+                auto editado = std::make_shared<ModeloParque>(*anterior);
+                // Una recarga pudo quitar la atracción mientras se escribía la entrada
+                if (!actualizarTiempoEspera(editado->atracciones, identificador, nuevoTiempo)) {
+                    std::cout << "Identificador de atraccion no encontrado.\n";
+                    break;
+                }
+                std::cout << "Tiempo de espera actualizado.\n";
+                editado->jerarquia = nullptr;
+                prepararCRP(*editado, anterior.get());
+                publicarModelo(editado);
+                pedirJerarquia();
+                guardarTiempoEspera(archivos.atracciones, editado->atracciones);
                 break;
+            }
             case 4:
                 salir = true;
                 break;
@@ -484,7 +5924,8 @@ int main() {
         }
     }
 
-    liberarArbol(arbolDecisiones);
+    detenerRecarga(recarga);
+    esperarJerarquia();
     return 0;
 }
-
+#endif // PARQUE_SIN_MAIN
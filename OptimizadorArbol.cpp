@@ -0,0 +1,335 @@
+// Optimizador del árbol de decisiones
+//
+// Reordena las preguntas de decisiones.json para minimizar el número esperado de preguntas
+// que responde un visitante, sin cambiar la recomendación final de ningún perfil
+// (un perfil es una combinación de respuestas Si/No a todas las preguntas).
+//
+// Las frecuencias históricas se leen de un JSON con la proporción de respuestas "Si"
+// de cada pregunta, ya sea como número o como conteos:
+//   { "Eres menor de edad?": 0.3, "Vienes en grupo?": { "si": 120, "no": 380 } }
+// Las preguntas sin frecuencia se suponen equiprobables.
+//
+// La búsqueda es exacta: programación dinámica sobre todos los subcubos de respuestas
+// (3^k estados para k preguntas distintas), procesando en paralelo cada capa de estados
+// con el mismo número de preguntas pendientes.
+//
+// Uso:
+//   g++ -std=c++17 -O2 -pthread OptimizadorArbol.cpp -o OptimizadorArbol
+//   ./OptimizadorArbol decisiones.json frecuencias.json decisiones_optimizado.json
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// Máximo de preguntas distintas para la búsqueda exacta (3^14 ≈ 4.8 millones de estados)
+const int MAX_PREGUNTAS = 14;
+const int CLASE_MIXTA = -1;
+
+// Árbol leído del JSON con las preguntas ya numeradas
+struct NodoArbol {
+    int pregunta = -1; // -1 en hojas
+    int clase = -1;    // Solo en hojas
+    int izquierda = -1;
+    int derecha = -1;
+};
+
+struct Problema {
+    std::vector<std::string> preguntas;
+    std::map<std::string, int> indicePregunta;
+    std::vector<double> probabilidadSi;
+    std::vector<NodoArbol> nodos;
+    std::vector<std::vector<int>> representanteClase; // Lista original de identificadores de cada clase
+    std::map<std::vector<int>, int> indiceClase;      // Clave: identificadores ordenados y sin repetir
+};
+
+//-----------------------------------------------------------
+
+// Función para leer el árbol, numerando preguntas y recomendaciones distintas
+int leerNodo(Problema& problema, const json& j) {
+    bool tieneIzquierda = j.contains("izquierda") && j["izquierda"].is_object();
+    bool tieneDerecha = j.contains("derecha") && j["derecha"].is_object();
+    int indice = static_cast<int>(problema.nodos.size());
+    problema.nodos.emplace_back();
+
+    if (!tieneIzquierda && !tieneDerecha) {
+        std::vector<int> identificadores;
+        if (j.contains("identificadores") && j["identificadores"].is_array()) {
+            identificadores = j["identificadores"].get<std::vector<int>>();
+        }
+        std::vector<int> clave = identificadores;
+        std::sort(clave.begin(), clave.end());
+        clave.erase(std::unique(clave.begin(), clave.end()), clave.end());
+        auto it = problema.indiceClase.find(clave);
+        int clase;
+        if (it == problema.indiceClase.end()) {
+            clase = static_cast<int>(problema.representanteClase.size());
+            problema.indiceClase[clave] = clase;
+            problema.representanteClase.push_back(identificadores);
+        } else {
+            clase = it->second;
+        }
+        problema.nodos[indice].clase = clase;
+        return indice;
+    }
+
+    std::string pregunta = j.contains("pregunta") ? j["pregunta"].get<std::string>() : "";
+    auto it = problema.indicePregunta.find(pregunta);
+    int numero;
+    if (it == problema.indicePregunta.end()) {
+        numero = static_cast<int>(problema.preguntas.size());
+        problema.indicePregunta[pregunta] = numero;
+        problema.preguntas.push_back(pregunta);
+    } else {
+        numero = it->second;
+    }
+
+    static const json hojaVacia = json::object();
+    int izquierda = leerNodo(problema, tieneIzquierda ? j["izquierda"] : hojaVacia);
+    int derecha = leerNodo(problema, tieneDerecha ? j["derecha"] : hojaVacia);
+    problema.nodos[indice].pregunta = numero;
+    problema.nodos[indice].izquierda = izquierda;
+    problema.nodos[indice].derecha = derecha;
+    return indice;
+}
+
+//-----------------------------------------------------------
+
+// Función para leer las frecuencias históricas; devuelve false si el archivo es inválido
+bool leerFrecuencias(Problema& problema, const std::string& archivoJSON) {
+    problema.probabilidadSi.assign(problema.preguntas.size(), 0.5);
+    std::ifstream archivo(archivoJSON);
+    if (!archivo.is_open()) {
+        std::cerr << "Aviso: No se pudo abrir el archivo " << archivoJSON << "; se suponen respuestas equiprobables." << std::endl;
+        return true;
+    }
+    try {
+        json j;
+        archivo >> j;
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            auto pregunta = problema.indicePregunta.find(it.key());
+            if (pregunta == problema.indicePregunta.end()) {
+                std::cerr << "Aviso: La pregunta \"" << it.key() << "\" no aparece en el arbol." << std::endl;
+                continue;
+            }
+            double p = 0.5;
+            if (it->is_number()) {
+                p = it->get<double>();
+            } else if (it->is_object()) {
+                double si = it->value("si", 0.0);
+                double no = it->value("no", 0.0);
+                if (si + no > 0) p = si / (si + no);
+            }
+            problema.probabilidadSi[pregunta->second] = std::min(1.0, std::max(0.0, p));
+        }
+    } catch (const json::exception& e) {
+        std::cerr << "Error de parseo en el archivo " << archivoJSON << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------
+
+// Recomendación del árbol original para un perfil completo (bit q = respuesta Si a la pregunta q)
+int clasificarPerfil(const Problema& problema, std::uint32_t perfil) {
+    int nodo = 0;
+    while (problema.nodos[nodo].pregunta != -1) {
+        const NodoArbol& actual = problema.nodos[nodo];
+        nodo = (perfil >> actual.pregunta) & 1 ? actual.izquierda : actual.derecha;
+    }
+    return problema.nodos[nodo].clase;
+}
+
+// Número esperado de preguntas que formula un subárbol
+double preguntasEsperadas(const Problema& problema, int nodo) {
+    const NodoArbol& actual = problema.nodos[nodo];
+    if (actual.pregunta == -1) return 0.0;
+    double p = problema.probabilidadSi[actual.pregunta];
+    return 1.0 + p * preguntasEsperadas(problema, actual.izquierda) + (1.0 - p) * preguntasEsperadas(problema, actual.derecha);
+}
+
+//-----------------------------------------------------------
+
+// Programación dinámica sobre subcubos
+// Cada estado asigna a cada pregunta un dígito en base 3: 0 = pendiente, 1 = No, 2 = Si
+struct Busqueda {
+    int k;
+    std::vector<std::uint32_t> potencia3;
+    std::vector<int> clase;            // Recomendación común del subcubo, o CLASE_MIXTA
+    std::vector<float> costo;          // Preguntas esperadas desde el estado
+    std::vector<std::int8_t> mejor;    // Pregunta elegida en el estado (-1 si es hoja)
+};
+
+void resolverEstado(const Problema& problema, Busqueda& b, std::uint32_t estado) {
+    int primeraPendiente = -1;
+    std::uint32_t perfil = 0;
+    for (int q = 0, resto = estado; q < b.k; ++q, resto /= 3) {
+        int digito = resto % 3;
+        if (digito == 0 && primeraPendiente == -1) primeraPendiente = q;
+        if (digito == 2) perfil |= 1u << q;
+    }
+
+    if (primeraPendiente == -1) {
+        b.clase[estado] = clasificarPerfil(problema, perfil);
+        b.costo[estado] = 0.0f;
+        b.mejor[estado] = -1;
+        return;
+    }
+
+    // El subcubo es homogéneo si sus dos mitades lo son con la misma clase
+    int claseNo = b.clase[estado + b.potencia3[primeraPendiente]];
+    int claseSi = b.clase[estado + 2 * b.potencia3[primeraPendiente]];
+    if (claseNo != CLASE_MIXTA && claseNo == claseSi) {
+        b.clase[estado] = claseNo;
+        b.costo[estado] = 0.0f;
+        b.mejor[estado] = -1;
+        return;
+    }
+
+    b.clase[estado] = CLASE_MIXTA;
+    float mejorCosto = std::numeric_limits<float>::infinity();
+    int mejorPregunta = -1;
+    for (int q = 0, resto = estado; q < b.k; ++q, resto /= 3) {
+        if (resto % 3 != 0) continue;
+        float p = static_cast<float>(problema.probabilidadSi[q]);
+        float costo = 1.0f + p * b.costo[estado + 2 * b.potencia3[q]] + (1.0f - p) * b.costo[estado + b.potencia3[q]];
+        // Se exige una mejora clara para que los empates conserven la pregunta de menor índice
+        if (costo < mejorCosto - 1e-6f) {
+            mejorCosto = costo;
+            mejorPregunta = q;
+        }
+    }
+    b.costo[estado] = mejorCosto;
+    b.mejor[estado] = static_cast<std::int8_t>(mejorPregunta);
+}
+
+void buscarOrdenOptimo(const Problema& problema, Busqueda& b) {
+    b.k = static_cast<int>(problema.preguntas.size());
+    b.potencia3.assign(b.k + 1, 1);
+    for (int q = 1; q <= b.k; ++q) b.potencia3[q] = b.potencia3[q - 1] * 3;
+    std::uint32_t estados = b.potencia3[b.k];
+    b.clase.assign(estados, CLASE_MIXTA);
+    b.costo.assign(estados, 0.0f);
+    b.mejor.assign(estados, -1);
+
+    // Capas por número de preguntas pendientes: cada estado solo depende de la capa anterior
+    std::vector<std::vector<std::uint32_t>> capas(b.k + 1);
+    for (std::uint32_t estado = 0; estado < estados; ++estado) {
+        int pendientes = 0;
+        std::uint32_t resto = estado;
+        for (int q = 0; q < b.k; ++q, resto /= 3) {
+            if (resto % 3 == 0) ++pendientes;
+        }
+        capas[pendientes].push_back(estado);
+    }
+
+    unsigned hilos = std::max(1u, std::thread::hardware_concurrency());
+    for (const auto& capa : capas) {
+        std::vector<std::thread> trabajadores;
+        std::size_t bloque = (capa.size() + hilos - 1) / hilos;
+        for (unsigned h = 0; h < hilos; ++h) {
+            std::size_t desde = h * bloque;
+            std::size_t hasta = std::min(capa.size(), desde + bloque);
+            if (desde >= hasta) break;
+            trabajadores.emplace_back([&problema, &b, &capa, desde, hasta]() {
+                for (std::size_t i = desde; i < hasta; ++i) {
+                    resolverEstado(problema, b, capa[i]);
+                }
+            });
+        }
+        for (auto& trabajador : trabajadores) trabajador.join();
+    }
+}
+
+//-----------------------------------------------------------
+
+// Función para reconstruir el árbol óptimo en el formato de decisiones.json (conservando el orden de las claves)
+nlohmann::ordered_json construirJSON(const Problema& problema, const Busqueda& b, std::uint32_t estado) {
+    int q = b.mejor[estado];
+    if (q == -1) {
+        return nlohmann::ordered_json{{"identificadores", problema.representanteClase[b.clase[estado]]}};
+    }
+    return nlohmann::ordered_json{
+        {"pregunta", problema.preguntas[q]},
+        {"izquierda", construirJSON(problema, b, estado + 2 * b.potencia3[q])},
+        {"derecha", construirJSON(problema, b, estado + b.potencia3[q])}
+    };
+}
+
+// Recomendación del árbol optimizado para un perfil completo
+int clasificarOptimo(const Busqueda& b, std::uint32_t perfil) {
+    std::uint32_t estado = 0;
+    while (b.mejor[estado] != -1) {
+        int q = b.mejor[estado];
+        estado += ((perfil >> q) & 1 ? 2 : 1) * b.potencia3[q];
+    }
+    return b.clase[estado];
+}
+
+//--------------------------------------------------------
+int main(int argc, char* argv[]) {
+    std::string archivoArbol = argc > 1 ? argv[1] : "decisiones.json";
+    std::string archivoFrecuencias = argc > 2 ? argv[2] : "frecuencias.json";
+    std::string archivoSalida = argc > 3 ? argv[3] : "decisiones_optimizado.json";
+
+    std::ifstream archivo(archivoArbol);
+    if (!archivo.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoArbol << std::endl;
+        return 1;
+    }
+    json j;
+    try {
+        archivo >> j;
+    } catch (const json::parse_error& e) {
+        std::cerr << "Error de parseo en el archivo " << archivoArbol << ": " << e.what() << std::endl;
+        return 1;
+    }
+    if (j.is_null() || j.empty() || !j.is_object()) {
+        std::cerr << "Error: El archivo " << archivoArbol << " contiene JSON inválido o vacío." << std::endl;
+        return 1;
+    }
+
+    Problema problema;
+    leerNodo(problema, j);
+    if (problema.preguntas.size() > MAX_PREGUNTAS) {
+        std::cerr << "Error: El arbol tiene " << problema.preguntas.size() << " preguntas distintas; la busqueda exacta admite hasta "
+                  << MAX_PREGUNTAS << "." << std::endl;
+        return 1;
+    }
+    if (!leerFrecuencias(problema, archivoFrecuencias)) {
+        return 1;
+    }
+
+    Busqueda busqueda;
+    buscarOrdenOptimo(problema, busqueda);
+
+    // Verificar que ningún perfil cambie de recomendación
+    std::uint32_t perfiles = 1u << problema.preguntas.size();
+    for (std::uint32_t perfil = 0; perfil < perfiles; ++perfil) {
+        if (clasificarPerfil(problema, perfil) != clasificarOptimo(busqueda, perfil)) {
+            std::cerr << "Error: El arbol optimizado cambia la recomendacion del perfil " << perfil << "." << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream salida(archivoSalida);
+    if (!salida.is_open()) {
+        std::cerr << "Error: No se pudo abrir el archivo " << archivoSalida << " para escribir." << std::endl;
+        return 1;
+    }
+    salida << construirJSON(problema, busqueda, 0).dump(2) << std::endl;
+
+    std::cout << "Preguntas esperadas: " << preguntasEsperadas(problema, 0) << " (original) -> "
+              << busqueda.costo[0] << " (optimizado)." << std::endl;
+    std::cout << "Arbol optimizado guardado en " << archivoSalida << "." << std::endl;
+    return 0;
+}